@@ -2,11 +2,16 @@
 
 import rospy
 import math
+import pymongo
 import operator
 from std_msgs.msg import Time
 import topological_rviz_tools.srv
-from strands_navigation_msgs.msg import TopologicalMap
+from strands_navigation_msgs.msg import TopologicalMap, TopologicalNode
+import strands_navigation_msgs.srv
 from strands_navigation_msgs.srv import *
+from topological_rviz_tools.srv import BatchEditRequest, BatchEditResponse
+from topological_rviz_tools.srv import GetPointsetResponse, ListPointsetsResponse, SwitchPointsetResponse
+from mongodb_store.message_store import MessageStoreProxy
 from geometry_msgs.msg import Pose
 
 class TopmapInterface(object):
@@ -28,8 +33,23 @@ class TopmapInterface(object):
 
         self.topmap_sub = rospy.Subscriber("topological_map", TopologicalMap, self.topmap_cb)
         self.add_edge_srv = rospy.Service("~add_edge", topological_rviz_tools.srv.AddEdge, self.add_edge)
+        self.batch_edit_srv = rospy.Service("~batch_edit", topological_rviz_tools.srv.BatchEdit, self.batch_edit)
+        self.list_pointsets_srv = rospy.Service("~list_pointsets", topological_rviz_tools.srv.ListPointsets, self.list_pointsets)
+        self.switch_pointset_srv = rospy.Service("~switch_pointset", topological_rviz_tools.srv.SwitchPointset, self.switch_pointset)
+        self.get_pointset_srv = rospy.Service("~get_pointset", topological_rviz_tools.srv.GetPointset, self.get_pointset)
+        self.msg_store = MessageStoreProxy(collection='topological_maps')
 
         self.manager_add_edge = rospy.ServiceProxy("/topological_map_manager/add_edges_between_nodes", strands_navigation_msgs.srv.AddEdge)
+        self.manager_rm_edge = rospy.ServiceProxy("/topological_map_manager/remove_edge", strands_navigation_msgs.srv.AddEdge)
+        self.manager_update_edge = rospy.ServiceProxy("/topological_map_manager/update_edge", UpdateEdge)
+        self.manager_add_node = rospy.ServiceProxy("/topological_map_manager/add_topological_node", AddNode)
+        self.manager_rm_node = rospy.ServiceProxy("/topological_map_manager/remove_topological_node", RmvNode)
+        self.manager_update_tolerance = rospy.ServiceProxy("/topological_map_manager/update_node_tolerance", UpdateNodeTolerance)
+        self.manager_add_tag = rospy.ServiceProxy("/topological_map_manager/add_tag_to_node", AddTag)
+        self.manager_rm_tag = rospy.ServiceProxy("/topological_map_manager/rm_tag_from_node", AddTag)
+        self.manager_node_tags = rospy.ServiceProxy("/topological_map_manager/get_node_tags", GetNodeTags)
+        self.manager_tagged_nodes = rospy.ServiceProxy("/topological_map_manager/get_tagged_nodes", GetTaggedNodes)
+        self.manager_switch_map = rospy.ServiceProxy("/topological_map_manager/switch_topological_map", GetTopologicalMap)
 
         rospy.spin()
     
@@ -64,6 +84,184 @@ class TopmapInterface(object):
 
         return topological_rviz_tools.srv.AddEdgeResponse(True, message)
 
+    def batch_edit(self, req):
+        """Make all of the edits in the request, or none of them. The edits are
+        checked against the current map before anything is changed, and if
+        the map manager rejects one of them, the edits already made are
+        undone in reverse order.
+
+        """
+        count = len(req.operations)
+        if len(req.targets) != count or len(req.tags) != count:
+            return BatchEditResponse(False, "operations, targets and tags must have the same length", 0)
+        if self.topmap is None:
+            return BatchEditResponse(False, "No topological map has been received yet", 0)
+
+        nodes = dict((node.name, node) for node in self.topmap.nodes)
+        edges = dict((edge.edge_id, node.name) for node in self.topmap.nodes for edge in node.edges)
+        # node name -> (origin, edge) for every edge leading to it
+        incoming = {}
+        for node in self.topmap.nodes:
+            for edge in node.edges:
+                incoming.setdefault(edge.node, []).append((node.name, edge))
+
+        for i, (operation, target) in enumerate(zip(req.operations, req.targets)):
+            if operation == BatchEditRequest.REMOVE_EDGE:
+                if target not in edges:
+                    return BatchEditResponse(False, "There is no edge {0}".format(target), i)
+            elif operation in (BatchEditRequest.REMOVE_NODE, BatchEditRequest.ADD_TAG, BatchEditRequest.REMOVE_TAG):
+                if target not in nodes:
+                    return BatchEditResponse(False, "There is no node {0}".format(target), i)
+            else:
+                return BatchEditResponse(False, "Unknown operation {0}".format(operation), i)
+
+        # What has gone so far. Removing a node also removes the edges to and
+        # from it, so each undo only puts back what its own edit took away.
+        removed_nodes = set()
+        removed_edges = set()
+        # nodes with each tag touched so far, fetched on first use
+        tagged = {}
+        undo = []
+        i = 0
+        while i < count:
+            operation, target, tag = req.operations[i], req.targets[i], req.tags[i]
+            # The map manager tags a list of nodes in one call, so a run of
+            # edits of the same tag is made at once.
+            end = i + 1
+            if operation in (BatchEditRequest.ADD_TAG, BatchEditRequest.REMOVE_TAG):
+                while end < count and req.operations[end] == operation and req.tags[end] == tag:
+                    end += 1
+            try:
+                if operation == BatchEditRequest.REMOVE_EDGE:
+                    success = True
+                    if target not in removed_edges:
+                        node = nodes[edges[target]]
+                        edge = next(edge for edge in node.edges if edge.edge_id == target)
+                        success = self.manager_rm_edge(edge_id=target).success
+                        if success:
+                            removed_edges.add(target)
+                            undo.append(lambda node=node, edge=edge: self.restore_edge(node.name, edge))
+                elif operation == BatchEditRequest.REMOVE_NODE:
+                    success = True
+                    if target not in removed_nodes:
+                        node = nodes[target]
+                        tags = self.manager_node_tags(node_name=target).tags
+                        lost = [(node.name, edge) for edge in node.edges
+                                if edge.node not in removed_nodes and edge.edge_id not in removed_edges]
+                        lost += [(origin, edge) for origin, edge in incoming.get(target, [])
+                                 if origin != target and origin not in removed_nodes
+                                 and edge.edge_id not in removed_edges]
+                        success = self.manager_rm_node(name=target).success
+                        if success:
+                            removed_nodes.add(target)
+                            removed_edges.update(edge.edge_id for _, edge in lost)
+                            undo.append(lambda node=node, tags=tags, lost=lost: self.restore_node(node, tags, lost))
+                else:
+                    if tag not in tagged:
+                        tagged[tag] = set(self.manager_tagged_nodes(tag=tag).nodes)
+                    targets = sorted(set(req.targets[i:end]))
+                    if operation == BatchEditRequest.ADD_TAG:
+                        success = self.manager_add_tag(tag=tag, node=targets).success
+                        # nodes which had the tag before must keep it if the
+                        # batch is undone
+                        changed = [node for node in targets if node not in tagged[tag]]
+                        if success and changed:
+                            tagged[tag].update(changed)
+                            undo.append(lambda tag=tag, changed=changed: self.manager_rm_tag(tag=tag, node=changed))
+                    else:
+                        success = self.manager_rm_tag(tag=tag, node=targets).success
+                        # and nodes which never had it must not gain it
+                        changed = [node for node in targets if node in tagged[tag]]
+                        if success and changed:
+                            tagged[tag].difference_update(changed)
+                            undo.append(lambda tag=tag, changed=changed: self.manager_add_tag(tag=tag, node=changed))
+            except rospy.ServiceException as e:
+                rospy.logwarn("Edit {0} of the batch failed: {1}".format(i, e))
+                success = False
+
+            if not success:
+                message = "Map manager could not make edit {0} on {1}".format(i, target)
+                if not self.undo(undo):
+                    message += ", and some of the earlier edits could not be undone"
+                return BatchEditResponse(False, message, i)
+            i = end
+
+        return BatchEditResponse(True, "Made {0} edits".format(count), -1)
+
+    def undo(self, undo):
+        """Call the undo functions in reverse order. Returns false if any of
+        them failed.
+
+        """
+        success = True
+        for function in reversed(undo):
+            try:
+                function()
+            except rospy.ServiceException as e:
+                rospy.logerr("Failed to undo an edit: {0}".format(e))
+                success = False
+        return success
+
+    def restore_edge(self, origin, edge):
+        self.manager_add_edge(origin=origin, destination=edge.node, action=edge.action, edge_id=edge.edge_id)
+        self.manager_update_edge(edge_id=edge.edge_id, action=edge.action, top_vel=edge.top_vel)
+
+    def restore_node(self, node, tags, edges):
+        self.manager_add_node(name=node.name, pose=node.pose, add_close_nodes=False)
+        self.manager_update_tolerance(node_name=node.name, xy_tolerance=node.xy_goal_tolerance,
+                                      yaw_tolerance=node.yaw_goal_tolerance)
+        for tag in tags:
+            self.manager_add_tag(tag=tag, node=[node.name])
+        for origin, edge in edges:
+            self.restore_edge(origin, edge)
+
+    def list_pointsets(self, req):
+        """Names of the maps in the database, found the same way as
+        topological_utils/list_maps does.
+
+        """
+        host = rospy.get_param("mongodb_host")
+        port = rospy.get_param("mongodb_port")
+        client = pymongo.MongoClient(host, port)
+        try:
+            # Only the names are wanted, so let the database find them rather
+            # than loading every node of every map
+            collection = client.message_store.topological_maps
+            pointsets = collection.distinct("_meta.pointset")
+        finally:
+            client.close()
+        return ListPointsetsResponse(sorted(pointsets))
+
+    def switch_pointset(self, req):
+        """Ask the map manager to load another map. It publishes the map once it
+        is loaded, which is when the rviz side finds out what is actually in it.
+
+        """
+        try:
+            self.manager_switch_map(pointset=req.pointset)
+        except rospy.ServiceException as e:
+            return SwitchPointsetResponse(False, "Map manager could not switch to {0}: {1}".format(req.pointset, e))
+
+        self.name = req.pointset
+        return SwitchPointsetResponse(True, "Switched to {0}".format(req.pointset))
+
+    def get_pointset(self, req):
+        """The map and tags of a pointset as stored in the database, whichever
+        one the map manager has loaded.
+
+        """
+        resp = GetPointsetResponse()
+        resp.map.name = req.pointset
+        resp.map.pointset = req.pointset
+        for node, meta in self.msg_store.query(TopologicalNode._type, {}, {'pointset': req.pointset}):
+            resp.map.nodes.append(node)
+            for tag in meta.get('tag', []):
+                resp.tagged_nodes.append(node.name)
+                resp.tags.append(tag)
+        if resp.map.nodes:
+            resp.map.map = resp.map.nodes[0].map
+        return resp
+
     def topmap_cb(self, msg):
         rospy.loginfo("Topological map was updated via callback.")
         self.topmap = msg
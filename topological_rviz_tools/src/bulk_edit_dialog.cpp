@@ -0,0 +1,86 @@
+#include "bulk_edit_dialog.h"
+
+#include <QCheckBox>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QVBoxLayout>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+QDoubleSpinBox* makeSpinBox(double value, QCheckBox* check)
+{
+  QDoubleSpinBox* spin = new QDoubleSpinBox();
+  spin->setRange(0, 1000);
+  spin->setDecimals(3);
+  spin->setSingleStep(0.05);
+  spin->setValue(value);
+  spin->setEnabled(false);
+  QObject::connect(check, SIGNAL(toggled(bool)), spin, SLOT(setEnabled(bool)));
+  return spin;
+}
+
+} // end anonymous namespace
+
+BulkEditDialog::BulkEditDialog(const BulkEdit& initial, int num_nodes, int num_edges, QWidget* parent)
+  : QDialog(parent)
+{
+  setWindowTitle("Edit selection");
+
+  yaw_check_ = new QCheckBox("Yaw tolerance");
+  yaw_spin_ = makeSpinBox(initial.yaw_tolerance, yaw_check_);
+  xy_check_ = new QCheckBox("XY tolerance");
+  xy_spin_ = makeSpinBox(initial.xy_tolerance, xy_check_);
+  top_vel_check_ = new QCheckBox("Top vel");
+  top_vel_spin_ = makeSpinBox(initial.top_vel, top_vel_check_);
+  action_check_ = new QCheckBox("Action");
+  action_edit_ = new QLineEdit();
+  action_edit_->setText(QString::fromStdString(initial.action));
+  action_edit_->setEnabled(false);
+  connect(action_check_, SIGNAL(toggled(bool)), action_edit_, SLOT(setEnabled(bool)));
+
+  // edge settings apply to the selected edges and to all edges of the
+  // selected nodes
+  yaw_check_->setEnabled(num_nodes > 0);
+  xy_check_->setEnabled(num_nodes > 0);
+  top_vel_check_->setEnabled(num_edges > 0);
+  action_check_->setEnabled(num_edges > 0);
+
+  QFormLayout* form = new QFormLayout;
+  form->addRow(yaw_check_, yaw_spin_);
+  form->addRow(xy_check_, xy_spin_);
+  form->addRow(top_vel_check_, top_vel_spin_);
+  form->addRow(action_check_, action_edit_);
+
+  QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+  connect(buttons, SIGNAL(accepted()), this, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), this, SLOT(reject()));
+
+  QVBoxLayout* main_layout = new QVBoxLayout;
+  main_layout->addWidget(new QLabel(QString("Change %1 nodes and %2 edges:").arg(num_nodes).arg(num_edges)));
+  main_layout->addLayout(form);
+  main_layout->addWidget(buttons);
+  setLayout(main_layout);
+}
+
+BulkEdit BulkEditDialog::getEdit() const
+{
+  BulkEdit edit;
+  edit.set_yaw_tolerance = yaw_check_->isChecked();
+  edit.yaw_tolerance = yaw_spin_->value();
+  edit.set_xy_tolerance = xy_check_->isChecked();
+  edit.xy_tolerance = xy_spin_->value();
+  edit.set_top_vel = top_vel_check_->isChecked();
+  edit.top_vel = top_vel_spin_->value();
+  edit.set_action = action_check_->isChecked() && !action_edit_->text().isEmpty();
+  edit.action = action_edit_->text().toStdString();
+  return edit;
+}
+
+} // end namespace topological_rviz_tools
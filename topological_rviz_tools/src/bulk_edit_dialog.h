@@ -0,0 +1,65 @@
+#ifndef BULK_EDIT_DIALOG_H
+#define BULK_EDIT_DIALOG_H
+
+#include <string>
+
+#include <QDialog>
+
+class QCheckBox;
+class QDoubleSpinBox;
+class QLineEdit;
+
+namespace topological_rviz_tools
+{
+
+/** @brief Values to write to every node and edge in a selection. Only the
+ * fields whose set_ flag is true are changed. */
+struct BulkEdit
+{
+  BulkEdit()
+    : set_yaw_tolerance(false), yaw_tolerance(0)
+    , set_xy_tolerance(false), xy_tolerance(0)
+    , set_top_vel(false), top_vel(0)
+    , set_action(false)
+  {}
+
+  bool setsNodes() const { return set_yaw_tolerance || set_xy_tolerance; }
+  bool setsEdges() const { return set_top_vel || set_action; }
+
+  bool set_yaw_tolerance;
+  float yaw_tolerance;
+  bool set_xy_tolerance;
+  float xy_tolerance;
+  bool set_top_vel;
+  float top_vel;
+  bool set_action;
+  std::string action;
+};
+
+/** @brief Dialog asking which node tolerances and edge settings to change
+ * across a selection, and to what. */
+class BulkEditDialog: public QDialog
+{
+Q_OBJECT
+public:
+  /** @brief @a initial gives the values shown at first, its set_ flags are
+   * ignored. The counts are only used to describe the selection. */
+  BulkEditDialog(const BulkEdit& initial, int num_nodes, int num_edges, QWidget* parent = 0);
+
+  /** @brief The edit chosen by the user. */
+  BulkEdit getEdit() const;
+
+private:
+  QCheckBox* yaw_check_;
+  QDoubleSpinBox* yaw_spin_;
+  QCheckBox* xy_check_;
+  QDoubleSpinBox* xy_spin_;
+  QCheckBox* top_vel_check_;
+  QDoubleSpinBox* top_vel_spin_;
+  QCheckBox* action_check_;
+  QLineEdit* action_edit_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // BULK_EDIT_DIALOG_H
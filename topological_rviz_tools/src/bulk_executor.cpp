@@ -0,0 +1,175 @@
+#include "bulk_executor.h"
+
+#include <algorithm>
+
+namespace topological_rviz_tools
+{
+
+BulkExecutor::BulkExecutor(int in_flight)
+  : in_flight_(std::max(1, in_flight))
+  , stage_(0)
+  , first_result_(0)
+  , next_job_(0)
+  , done_(0)
+  , running_(0)
+  , cancelled_(false)
+{
+}
+
+BulkExecutor::~BulkExecutor()
+{
+  cancel();
+  wait();
+}
+
+void BulkExecutor::setInFlight(int in_flight)
+{
+  in_flight_ = std::max(1, in_flight);
+}
+
+void BulkExecutor::barrier()
+{
+  if (!jobs_.empty() && jobs_.back().stage == stage_) {
+    stage_++;
+  }
+}
+
+void BulkExecutor::start()
+{
+  Result cancelled;
+  cancelled.outcome = CANCELLED;
+  first_result_ = results_.size();
+  results_.resize(first_result_ + jobs_.size(), cancelled);
+  for (int i = 0; i < jobs_.size(); i++) {
+    results_[first_result_ + i].description = jobs_[i].description;
+  }
+
+  next_job_ = 0;
+  done_ = 0;
+  cancelled_ = false;
+  int workers = std::min<int>(in_flight_, jobs_.size());
+  if (connections_.size() < workers) {
+    connections_.resize(workers);
+  }
+  running_ = workers;
+  for (int w = 0; w < workers; w++) {
+    workers_.create_thread(boost::bind(&BulkExecutor::work, this, w));
+  }
+}
+
+bool BulkExecutor::wait(int milliseconds)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (milliseconds < 0) {
+      while (running_ > 0) {
+	finished_.wait(lock);
+      }
+    } else {
+      boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(milliseconds);
+      while (running_ > 0) {
+	if (!finished_.timed_wait(lock, deadline)) {
+	  break;
+	}
+      }
+      if (running_ > 0) {
+	return false;
+      }
+    }
+  }
+  finish();
+  return true;
+}
+
+void BulkExecutor::finish()
+{
+  workers_.join_all();
+  jobs_.clear();
+  stage_ = 0;
+}
+
+void BulkExecutor::cancel()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  cancelled_ = true;
+  // wake up workers waiting at a barrier
+  finished_.notify_all();
+}
+
+int BulkExecutor::numDone() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return done_;
+}
+
+void BulkExecutor::work(int worker)
+{
+  std::map<std::string, ServiceConnection>& connections = connections_[worker];
+  for (;;) {
+    size_t index;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      // the first call after a barrier waits for everything before it
+      while (!cancelled_ && next_job_ < jobs_.size() && next_job_ > done_
+	     && jobs_[next_job_].stage != jobs_[next_job_ - 1].stage) {
+	finished_.wait(lock);
+      }
+      if (cancelled_ || next_job_ == jobs_.size()) {
+	if (--running_ == 0) {
+	  finished_.notify_all();
+	}
+	return;
+      }
+      index = next_job_++;
+    }
+
+    // Each result is only written by the worker which took the job, so the
+    // results need no locking.
+    const Job& job = jobs_[index];
+    std::map<std::string, ServiceConnection>::iterator it = connections.find(job.service);
+    if (it == connections.end()) {
+      it = connections.insert(std::make_pair(job.service, job.connect(job.service))).first;
+    }
+    results_[first_result_ + index].outcome = job.call(it->second);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    done_++;
+    finished_.notify_all();
+  }
+}
+
+int BulkExecutor::numFailed() const
+{
+  int failed = 0;
+  for (int i = 0; i < results_.size(); i++) {
+    if (results_[i].outcome != SUCCEEDED) {
+      failed++;
+    }
+  }
+  return failed;
+}
+
+void BulkExecutor::clear()
+{
+  jobs_.clear();
+  results_.clear();
+  stage_ = 0;
+}
+
+const char* BulkExecutor::outcomeName(Outcome outcome)
+{
+  switch (outcome) {
+  case SUCCEEDED:
+    return "succeeded";
+  case REJECTED:
+    return "rejected by the map manager";
+  case NO_RESPONSE:
+    return "no response";
+  case TIMED_OUT:
+    return "timed out";
+  default:
+    return "cancelled";
+  }
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,150 @@
+#ifndef BULK_EXECUTOR_H
+#define BULK_EXECUTOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+#include "service_connection.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Makes many independent service calls with several of them in
+ * flight at once.
+ *
+ * Each worker thread has its own connection to every service, so requests
+ * go out over separate connections and the server can work on them at the
+ * same time, rather than each one waiting for the previous response. Calls
+ * are made in the order they were added, but may finish in any order, so
+ * calls which depend on earlier ones go after a barrier().
+ *
+ * The calls are made at bulk priority, so edits made by hand while a run is
+ * going get through first, see RequestScheduler. */
+class BulkExecutor
+{
+public:
+  enum Outcome {
+    SUCCEEDED,
+    REJECTED,
+    NO_RESPONSE,
+    TIMED_OUT,
+    CANCELLED
+  };
+
+  struct Result
+  {
+    std::string description;
+    Outcome outcome;
+  };
+
+  /** @brief Keep up to @a in_flight requests going at once. */
+  BulkExecutor(int in_flight = 8);
+  ~BulkExecutor();
+
+  void setInFlight(int in_flight);
+  int getInFlight() const { return in_flight_; }
+
+  /** @brief Queue a call of @a service with the request in @a srv. The
+   * response is taken to be a success if its success field is set.
+   * @a description identifies the call in the results. */
+  template <class Service>
+  void add(const std::string& service, const Service& srv, const std::string& description)
+  {
+    Job job;
+    job.service = service;
+    job.description = description;
+    job.stage = stage_;
+    job.connect = boost::bind(&ServiceConnection::create<Service>, _1, ServiceConnection::BULK,
+			      ServiceConnection::NO_RETRY);
+    job.call = boost::bind(&BulkExecutor::call<Service>, _1, srv);
+    jobs_.push_back(job);
+  }
+
+  /** @brief Calls added after this are only started once all calls added
+   * before it have finished. */
+  void barrier();
+
+  /** @brief Start making the queued calls in the background. */
+  void start();
+
+  /** @brief Wait up to @a milliseconds for the calls to finish, or forever
+   * if it is negative. Returns true once they have. */
+  bool wait(int milliseconds = -1);
+
+  /** @brief Make all queued calls, and return once they are done. */
+  void run() { start(); wait(); }
+
+  /** @brief Don't start any more of the calls of the current run. Calls
+   * already sent still finish. */
+  void cancel();
+
+  /** @brief Number of calls of the current run which have finished. */
+  int numDone() const;
+  int numQueued() const { return jobs_.size(); }
+
+  /** @brief Results of all runs since the last clear(), in the order the
+   * calls were added. */
+  const std::vector<Result>& getResults() const { return results_; }
+
+  int numFailed() const;
+
+  /** @brief Drop the results and any calls which were not run. The
+   * connections are kept. */
+  void clear();
+
+  static const char* outcomeName(Outcome outcome);
+
+private:
+  struct Job
+  {
+    std::string service;
+    std::string description;
+    int stage;
+    boost::function<ServiceConnection (const std::string&)> connect;
+    boost::function<Outcome (ServiceConnection&)> call;
+  };
+
+  template <class Service>
+  static Outcome call(ServiceConnection& connection, Service srv)
+  {
+    switch (connection.call(srv, ServiceConnection::getDefaultTimeout())) {
+    case ServiceConnection::OK:
+      return srv.response.success ? SUCCEEDED : REJECTED;
+    case ServiceConnection::TIMED_OUT:
+      return TIMED_OUT;
+    default:
+      return NO_RESPONSE;
+    }
+  }
+
+  /** @brief Take jobs off the queue until it is empty or cancelled. */
+  void work(int worker);
+  /** @brief Wait for the workers of a finished run and drop its jobs. */
+  void finish();
+
+  int in_flight_;
+  std::vector<Job> jobs_;
+  // stage of the calls being added, one more for every barrier
+  int stage_;
+  // index in results_ of the first job of the current run
+  size_t first_result_;
+  size_t next_job_;
+  int done_;
+  int running_;
+  bool cancelled_;
+  mutable boost::mutex mutex_;
+  boost::condition_variable finished_;
+  boost::thread_group workers_;
+  // connections of each worker by service name
+  std::vector<std::map<std::string, ServiceConnection> > connections_;
+  std::vector<Result> results_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // BULK_EXECUTOR_H
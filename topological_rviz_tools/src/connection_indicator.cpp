@@ -0,0 +1,65 @@
+#include "connection_indicator.h"
+
+#include <QTimer>
+
+#include "strands_navigation_msgs/GetTags.h"
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+const char* MANAGER = "/topological_map_manager/";
+// seconds without calls before the manager is checked
+const double PROBE_INTERVAL = 3.0;
+// shorter than the interval, so only one check is waiting at a time
+const double PROBE_TIMEOUT = 2.0;
+}
+
+ConnectionIndicator::ConnectionIndicator(QWidget* parent)
+  : QLabel(QString(), parent)
+{
+  // checking in the background shouldn't hold anything else up
+  probe_ = ServiceConnection::create<strands_navigation_msgs::GetTags>(std::string(MANAGER) + "get_tags",
+								      ServiceConnection::BULK, ServiceConnection::RETRY);
+
+  timer_ = new QTimer(this);
+  connect(timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+  timer_->start(1000);
+  refresh();
+}
+
+void ConnectionIndicator::refresh()
+{
+  ConnectionHealth::Summary summary = ConnectionHealth::instance().getSummary(MANAGER);
+  ros::WallTime now = ros::WallTime::now();
+  if ((summary.calls == 0 || (now - summary.last_call).toSec() > PROBE_INTERVAL)
+      && (now - last_probe_).toSec() > PROBE_INTERVAL) {
+    last_probe_ = now;
+    boost::thread(boost::bind(&ConnectionIndicator::probe, probe_)).detach();
+  }
+
+  if (summary.calls == 0) {
+    setText("Map manager: waiting");
+    setStyleSheet("color: gray");
+    setToolTip("No calls to the map manager have finished yet");
+  } else if (summary.available) {
+    setText(QString("Map manager: %1 ms").arg(int(summary.latency * 1000 + 0.5)));
+    setStyleSheet("color: green");
+    setToolTip(QString("The map manager is answering, calls time out after %1 s")
+	       .arg(ServiceConnection::getDefaultTimeout()));
+  } else {
+    setText(QString("Map manager: %1").arg(ServiceConnection::statusName(summary.failed_status)));
+    setStyleSheet("color: red");
+    setToolTip(QString("Last call to %1 failed, reconnecting on the next call")
+	       .arg(QString::fromStdString(summary.failed_service)));
+  }
+}
+
+void ConnectionIndicator::probe(ServiceConnection connection)
+{
+  strands_navigation_msgs::GetTags srv;
+  connection.call(srv, PROBE_TIMEOUT);
+}
+
+} // end namespace topological_rviz_tools
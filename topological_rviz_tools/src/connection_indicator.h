@@ -0,0 +1,35 @@
+#ifndef CONNECTION_INDICATOR_H
+#define CONNECTION_INDICATOR_H
+
+#include <QLabel>
+
+#include "service_connection.h"
+
+class QTimer;
+
+namespace topological_rviz_tools
+{
+
+/** @brief Shows whether the map manager is answering and how long it takes,
+ * from the calls made through ServiceConnection. When nothing has been
+ * called for a while, a cheap query is sent in the background to check. */
+class ConnectionIndicator: public QLabel
+{
+Q_OBJECT
+public:
+  ConnectionIndicator(QWidget* parent = 0);
+
+private Q_SLOTS:
+  void refresh();
+
+private:
+  static void probe(ServiceConnection connection);
+
+  QTimer* timer_;
+  ServiceConnection probe_;
+  ros::WallTime last_probe_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // CONNECTION_INDICATOR_H
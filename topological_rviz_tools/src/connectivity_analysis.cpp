@@ -0,0 +1,200 @@
+#include "connectivity_analysis.h"
+
+#include <algorithm>
+
+namespace topological_rviz_tools
+{
+
+ConnectivityAnalysis::ConnectivityAnalysis()
+  : num_components_(0)
+  , main_component_(-1)
+{
+}
+
+bool ConnectivityAnalysis::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  bool changed = !snapshot_ || !snapshot || topologyChanged(*snapshot, delta);
+  snapshot_ = snapshot;
+  if (changed) {
+    recompute();
+  }
+  return changed;
+}
+
+bool ConnectivityAnalysis::topologyChanged(const TopmapSnapshot& snapshot, const TopmapDelta& delta) const
+{
+  if (delta.from_revision != snapshot_->getRevision() || delta.to_revision != snapshot.getRevision()
+      || !delta.added.empty() || !delta.removed.empty()) {
+    return true;
+  }
+
+  // edge changes only matter if they change where the edges go
+  for (int i = 0; i < delta.modified.size(); i++) {
+    if (!(delta.modified[i].fields & TopmapDelta::EDGES)) {
+      continue;
+    }
+    const std::vector<strands_navigation_msgs::Edge>& before = snapshot_->nodeAt(delta.modified[i].before).edges;
+    const std::vector<strands_navigation_msgs::Edge>& after = snapshot.nodeAt(delta.modified[i].after).edges;
+    if (before.size() != after.size()) {
+      return true;
+    }
+    for (int j = 0; j < before.size(); j++) {
+      if (before[j].node != after[j].node) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ConnectivityAnalysis::recompute()
+{
+  component_.clear();
+  flags_.clear();
+  problems_.clear();
+  num_components_ = 0;
+  main_component_ = -1;
+  if (!snapshot_ || snapshot_->numNodes() == 0) {
+    return;
+  }
+
+  // Adjacency in compressed rows, forwards and backwards. Edges to nodes not
+  // in the map are left out.
+  int n = snapshot_->numNodes();
+  std::vector<int> offsets(n + 1, 0);
+  std::vector<int> targets;
+  std::vector<int> in_degree(n, 0);
+  for (int i = 0; i < n; i++) {
+    const std::vector<strands_navigation_msgs::Edge>& edges = snapshot_->nodeAt(i).edges;
+    for (int j = 0; j < edges.size(); j++) {
+      int target = snapshot_->findNode(edges[j].node);
+      if (target >= 0) {
+	targets.push_back(target);
+	in_degree[target]++;
+      }
+    }
+    offsets[i + 1] = targets.size();
+  }
+
+  std::vector<int> reverse_offsets(n + 1, 0);
+  for (int i = 0; i < n; i++) {
+    reverse_offsets[i + 1] = reverse_offsets[i] + in_degree[i];
+  }
+  std::vector<int> sources(targets.size());
+  std::vector<int> fill(reverse_offsets.begin(), reverse_offsets.end() - 1);
+  for (int i = 0; i < n; i++) {
+    for (int e = offsets[i]; e < offsets[i + 1]; e++) {
+      sources[fill[targets[e]]++] = i;
+    }
+  }
+
+  findComponents(offsets, targets);
+
+  std::vector<bool> reachable = reachFromMain(offsets, targets);
+  std::vector<bool> returns = reachFromMain(reverse_offsets, sources);
+  flags_.resize(n, 0);
+  for (int i = 0; i < n; i++) {
+    if (!reachable[i]) {
+      flags_[i] |= UNREACHABLE;
+    }
+    if (!returns[i]) {
+      flags_[i] |= DEAD_END;
+    }
+    if (flags_[i]) {
+      problems_.push_back(i);
+    }
+  }
+}
+
+void ConnectivityAnalysis::findComponents(const std::vector<int>& offsets, const std::vector<int>& targets)
+{
+  // Tarjan's algorithm with an explicit stack, as paths through a large map
+  // can be far longer than the call stack allows.
+  int n = offsets.size() - 1;
+  std::vector<int> index(n, -1);
+  std::vector<int> low(n, 0);
+  std::vector<bool> on_stack(n, false);
+  std::vector<int> stack;
+  // node and the next of its edges to look at
+  std::vector<std::pair<int, int> > calls;
+  component_.assign(n, -1);
+  std::vector<int> sizes;
+  int next_index = 0;
+
+  for (int root = 0; root < n; root++) {
+    if (index[root] >= 0) {
+      continue;
+    }
+    calls.push_back(std::make_pair(root, offsets[root]));
+    index[root] = low[root] = next_index++;
+    stack.push_back(root);
+    on_stack[root] = true;
+
+    while (!calls.empty()) {
+      int node = calls.back().first;
+      int& edge = calls.back().second;
+      if (edge < offsets[node + 1]) {
+	int target = targets[edge++];
+	if (index[target] < 0) {
+	  index[target] = low[target] = next_index++;
+	  stack.push_back(target);
+	  on_stack[target] = true;
+	  calls.push_back(std::make_pair(target, offsets[target]));
+	} else if (on_stack[target]) {
+	  low[node] = std::min(low[node], index[target]);
+	}
+	continue;
+      }
+
+      calls.pop_back();
+      if (!calls.empty()) {
+	int parent = calls.back().first;
+	low[parent] = std::min(low[parent], low[node]);
+      }
+      if (low[node] != index[node]) {
+	continue;
+      }
+
+      // node is the root of a component, which is everything above it
+      int size = 0;
+      int member;
+      do {
+	member = stack.back();
+	stack.pop_back();
+	on_stack[member] = false;
+	component_[member] = num_components_;
+	size++;
+      } while (member != node);
+      sizes.push_back(size);
+      num_components_++;
+    }
+  }
+
+  main_component_ = std::max_element(sizes.begin(), sizes.end()) - sizes.begin();
+}
+
+std::vector<bool> ConnectivityAnalysis::reachFromMain(const std::vector<int>& offsets, const std::vector<int>& targets) const
+{
+  int n = offsets.size() - 1;
+  std::vector<bool> reached(n, false);
+  std::vector<int> queue;
+  for (int i = 0; i < n; i++) {
+    if (component_[i] == main_component_) {
+      reached[i] = true;
+      queue.push_back(i);
+    }
+  }
+
+  for (int q = 0; q < queue.size(); q++) {
+    int node = queue[q];
+    for (int e = offsets[node]; e < offsets[node + 1]; e++) {
+      if (!reached[targets[e]]) {
+	reached[targets[e]] = true;
+	queue.push_back(targets[e]);
+      }
+    }
+  }
+  return reached;
+}
+
+} // end namespace topological_rviz_tools
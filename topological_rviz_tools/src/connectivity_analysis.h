@@ -0,0 +1,66 @@
+#ifndef CONNECTIVITY_ANALYSIS_H
+#define CONNECTIVITY_ANALYSIS_H
+
+#include <vector>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Strongly connected components of the directed edge graph, and the
+ * nodes a robot can't get to or can't get back from.
+ *
+ * The largest component is taken to be the map proper. Nodes it can't reach
+ * are unreachable, and nodes from which it can't be reached are dead ends.
+ * The analysis is linear in the size of the map, and is only redone when a
+ * delta adds or removes nodes or changes where edges go. */
+class ConnectivityAnalysis
+{
+public:
+  enum Flag {
+    UNREACHABLE = 1,
+    DEAD_END = 2
+  };
+
+  ConnectivityAnalysis();
+
+  /** @brief Bring the analysis in line with @a snapshot. Returns true if it
+   * was redone, in which case the results may have changed. */
+  bool update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  int numComponents() const { return num_components_; }
+
+  /** @brief Component of the node at @a node in display order. */
+  int componentOf(int node) const { return component_[node]; }
+
+  /** @brief The largest component, or -1 if the map is empty. */
+  int mainComponent() const { return main_component_; }
+
+  /** @brief Flag bits for the node at @a node in display order. */
+  unsigned int flags(int node) const { return flags_[node]; }
+
+  /** @brief Display indices of the nodes with any flag set, ascending. */
+  const std::vector<int>& problemNodes() const { return problems_; }
+
+private:
+  /** @brief True if going from the analysed snapshot to @a snapshot with
+   * @a delta may change the graph. */
+  bool topologyChanged(const TopmapSnapshot& snapshot, const TopmapDelta& delta) const;
+  void recompute();
+  void findComponents(const std::vector<int>& offsets, const std::vector<int>& targets);
+  /** @brief Mark everything reachable from the main component in the graph
+   * given by @a offsets and @a targets. */
+  std::vector<bool> reachFromMain(const std::vector<int>& offsets, const std::vector<int>& targets) const;
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  std::vector<int> component_;
+  std::vector<unsigned char> flags_;
+  std::vector<int> problems_;
+  int num_components_;
+  int main_component_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // CONNECTIVITY_ANALYSIS_H
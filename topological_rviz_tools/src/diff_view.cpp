@@ -0,0 +1,438 @@
+#include "diff_view.h"
+
+#include <set>
+
+#include <boost/bind.hpp>
+
+#include <QBrush>
+#include <QColor>
+#include <QComboBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QInputDialog>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+
+#include <yaml-cpp/yaml.h>
+
+#include "map_file.h"
+#include "topmap_manager.h"
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+// seconds to wait for a pointset, reading a large map from the database
+// takes a while
+const double POINTSET_TIMEOUT = 30.0;
+
+// the colours of the markers in the 3D view
+QBrush kindBrush(MapDiff::Kind kind)
+{
+  switch (kind) {
+  case MapDiff::ADDED:
+    return QBrush(QColor(0, 160, 0));
+  case MapDiff::REMOVED:
+    return QBrush(QColor(Qt::red));
+  default:
+    return QBrush(QColor(230, 140, 0));
+  }
+}
+
+QString kindName(MapDiff::Kind kind)
+{
+  switch (kind) {
+  case MapDiff::ADDED:
+    return "added";
+  case MapDiff::REMOVED:
+    return "removed";
+  default:
+    return "changed";
+  }
+}
+
+QString edgeFields(unsigned int fields)
+{
+  QStringList names;
+  if (fields & MapDiff::EDGE_TARGET) {
+    names << "target";
+  }
+  if (fields & MapDiff::EDGE_ACTION) {
+    names << "action";
+  }
+  if (fields & MapDiff::EDGE_SPEED) {
+    names << "speed";
+  }
+  if (fields & MapDiff::EDGE_OTHER) {
+    names << "map or inflation";
+  }
+  return names.join(", ");
+}
+
+QString position(const strands_navigation_msgs::TopologicalNode& node)
+{
+  return QString("(%1, %2)").arg(node.pose.position.x, 0, 'f', 2).arg(node.pose.position.y, 0, 'f', 2);
+}
+
+QString joinTags(const std::vector<std::string>& tags)
+{
+  QStringList list;
+  for (int i = 0; i < tags.size(); i++) {
+    list << QString::fromStdString(tags[i]);
+  }
+  return list.join(", ");
+}
+
+} // end anonymous namespace
+
+DiffView::DiffView(QWidget* parent)
+  : QWidget(parent)
+  , manager_(NULL)
+{
+  before_box_ = new QComboBox();
+  after_box_ = new QComboBox();
+  summary_ = new QLabel();
+  summary_->setWordWrap(true);
+
+  tree_ = new QTreeWidget();
+  tree_->setColumnCount(3);
+  tree_->setHeaderLabels(QStringList() << "Node" << "Change" << "Detail");
+  tree_->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  tree_->setUniformRowHeights(true);
+
+  listPointsetsSrv_ = ServiceConnection::create<topological_rviz_tools::ListPointsets>("/topmap_interface/list_pointsets",
+										  ServiceConnection::INTERACTIVE, ServiceConnection::RETRY);
+  getPointsetSrv_ = ServiceConnection::create<topological_rviz_tools::GetPointset>("/topmap_interface/get_pointset",
+										ServiceConnection::INTERACTIVE, ServiceConnection::RETRY);
+
+  MapDiff::Source live;
+  live.label = "Live map";
+  sources_.push_back(live);
+  before_box_->addItem(QString::fromStdString(live.label));
+  after_box_->addItem(QString::fromStdString(live.label));
+
+  QPushButton* compare_button = new QPushButton("Compare");
+  QPushButton* clear_button = new QPushButton("Clear");
+  QHBoxLayout* source_layout = new QHBoxLayout;
+  source_layout->addWidget(new QLabel("From"));
+  source_layout->addWidget(before_box_);
+  source_layout->addWidget(new QLabel("to"));
+  source_layout->addWidget(after_box_);
+  source_layout->addWidget(compare_button);
+  source_layout->addWidget(clear_button);
+  source_layout->setContentsMargins(2, 2, 2, 0);
+
+  QPushButton* keep_button = new QPushButton("Keep live map");
+  keep_button->setToolTip("Remember the live map as it is now, to compare with later");
+  QPushButton* open_button = new QPushButton("Open file...");
+  pointset_button_ = new QPushButton("Pointset...");
+  pointset_button_->setToolTip("Read another pointset from the database, without loading it");
+  QPushButton* save_button = new QPushButton("Save live map...");
+  QHBoxLayout* button_layout = new QHBoxLayout;
+  button_layout->addWidget(keep_button);
+  button_layout->addWidget(open_button);
+  button_layout->addWidget(pointset_button_);
+  button_layout->addWidget(save_button);
+  button_layout->setContentsMargins(2, 0, 2, 0);
+
+  QVBoxLayout* main_layout = new QVBoxLayout;
+  main_layout->setContentsMargins(0,0,0,0);
+  main_layout->addLayout(source_layout);
+  main_layout->addLayout(button_layout);
+  main_layout->addWidget(summary_);
+  main_layout->addWidget(tree_);
+  setLayout(main_layout);
+
+  connect(compare_button, SIGNAL(clicked()), this, SLOT(onCompareClicked()));
+  connect(clear_button, SIGNAL(clicked()), this, SLOT(onClearClicked()));
+  connect(keep_button, SIGNAL(clicked()), this, SLOT(onKeepClicked()));
+  connect(open_button, SIGNAL(clicked()), this, SLOT(onOpenClicked()));
+  connect(pointset_button_, SIGNAL(clicked()), this, SLOT(onPointsetClicked()));
+  connect(this, SIGNAL(pointsetRead(bool)), this, SLOT(onPointsetRead(bool)), Qt::QueuedConnection);
+  connect(save_button, SIGNAL(clicked()), this, SLOT(onSaveClicked()));
+  connect(tree_, SIGNAL(itemActivated(QTreeWidgetItem*, int)), this, SLOT(onItemActivated(QTreeWidgetItem*)));
+}
+
+DiffView::~DiffView()
+{
+  // the read thread uses the service connection and the request
+  if (pointset_thread_.joinable()) {
+    pointset_thread_.join();
+  }
+}
+
+void DiffView::setManager(TopmapManager* manager)
+{
+  manager_ = manager;
+  refresh();
+}
+
+int DiffView::numChanges() const
+{
+  if (!manager_ || !manager_->getDiff().isActive()) {
+    return 0;
+  }
+  MapDiff::Summary summary = manager_->getDiff().getSummary();
+  return summary.nodes[MapDiff::ADDED] + summary.nodes[MapDiff::REMOVED] + summary.nodes[MapDiff::MODIFIED];
+}
+
+void DiffView::addSource(const MapDiff::Source& source)
+{
+  sources_.push_back(source);
+  before_box_->addItem(QString::fromStdString(source.label));
+  after_box_->addItem(QString::fromStdString(source.label));
+  before_box_->setCurrentIndex(sources_.size() - 1);
+  after_box_->setCurrentIndex(0);
+}
+
+void DiffView::onCompareClicked()
+{
+  if (!manager_) {
+    return;
+  }
+  int before = before_box_->currentIndex();
+  int after = after_box_->currentIndex();
+  if (before == after) {
+    QMessageBox::information(this, "Compare maps", "Pick two different maps to compare.");
+    return;
+  }
+  manager_->setDiff(sources_[before], sources_[after]);
+  refresh();
+}
+
+void DiffView::onClearClicked()
+{
+  if (manager_) {
+    manager_->clearDiff();
+  }
+  refresh();
+}
+
+void DiffView::onKeepClicked()
+{
+  if (!manager_ || !manager_->getController()->getSnapshot()) {
+    return;
+  }
+  MapDiff::Source source = manager_->getLiveSource();
+  source.label = QString("Live map at revision %1").arg(source.snapshot->getRevision()).toStdString();
+  addSource(source);
+}
+
+void DiffView::onOpenClicked()
+{
+  QString file = QFileDialog::getOpenFileName(this, "Open map file", "", "Topological maps (*.tmap *.yaml);;All files (*)");
+  if (file.isEmpty()) {
+    return;
+  }
+
+  MapDiff::Source source;
+  strands_navigation_msgs::TopologicalMap::Ptr map;
+  try {
+    map = readMapFile(file.toStdString(), &source.tags, &source.has_tags);
+  } catch (const YAML::Exception& e) {
+    QMessageBox::warning(this, "Open map file", QString("Could not read %1: %2").arg(file).arg(e.what()));
+    return;
+  }
+  source.snapshot.reset(new TopmapSnapshot(map, 1));
+  std::string path = file.toStdString();
+  source.label = "File " + path.substr(path.find_last_of('/') + 1);
+  addSource(source);
+}
+
+void DiffView::onPointsetClicked()
+{
+  if (pointset_thread_.joinable()) {
+    return;
+  }
+  topological_rviz_tools::ListPointsets list;
+  if (listPointsetsSrv_.call(list, 2.0) != ServiceConnection::OK || list.response.pointsets.empty()) {
+    QMessageBox::warning(this, "Compare with pointset", "Could not list the pointsets in the database.");
+    return;
+  }
+  QStringList names;
+  for (int i = 0; i < list.response.pointsets.size(); i++) {
+    names << QString::fromStdString(list.response.pointsets[i]);
+  }
+  bool ok = false;
+  QString name = QInputDialog::getItem(this, "Compare with pointset", "Pointset:", names, 0, false, &ok);
+  if (!ok) {
+    return;
+  }
+
+  // Reading a large map from the database takes a while, so it is done on
+  // a thread, and the button stays disabled until it is back.
+  pointset_srv_ = topological_rviz_tools::GetPointset();
+  pointset_srv_.request.pointset = name.toStdString();
+  pointset_button_->setEnabled(false);
+  pointset_button_->setText("Reading...");
+  pointset_thread_ = boost::thread(boost::bind(&DiffView::readPointset, this));
+}
+
+void DiffView::readPointset()
+{
+  Q_EMIT pointsetRead(getPointsetSrv_.call(pointset_srv_, POINTSET_TIMEOUT) == ServiceConnection::OK);
+}
+
+void DiffView::onPointsetRead(bool ok)
+{
+  pointset_thread_.join();
+  pointset_button_->setEnabled(true);
+  pointset_button_->setText("Pointset...");
+  const std::string& name = pointset_srv_.request.pointset;
+  if (!ok) {
+    QMessageBox::warning(this, "Compare with pointset",
+			 QString("Could not read pointset %1.").arg(QString::fromStdString(name)));
+    return;
+  }
+
+  const topological_rviz_tools::GetPointset::Response& response = pointset_srv_.response;
+  MapDiff::Source source;
+  source.snapshot.reset(new TopmapSnapshot(strands_navigation_msgs::TopologicalMap::ConstPtr(
+					     new strands_navigation_msgs::TopologicalMap(response.map)), 1));
+  for (int i = 0; i < response.tagged_nodes.size() && i < response.tags.size(); i++) {
+    source.tags[response.tagged_nodes[i]].push_back(response.tags[i]);
+  }
+  source.has_tags = true;
+  source.label = "Pointset " + name;
+  addSource(source);
+}
+
+void DiffView::onSaveClicked()
+{
+  if (!manager_ || !manager_->getController()->getSnapshot()) {
+    return;
+  }
+  QString file = QFileDialog::getSaveFileName(this, "Save live map", "", "Topological maps (*.tmap *.yaml)");
+  if (file.isEmpty()) {
+    return;
+  }
+
+  MapDiff::Source source = manager_->getLiveSource();
+  if (!writeMapFile(file.toStdString(), source.snapshot->getMap(), source.tags)) {
+    QMessageBox::warning(this, "Save live map", QString("Could not write %1.").arg(file));
+    return;
+  }
+  // what was saved is what later edits are compared with
+  std::string path = file.toStdString();
+  source.label = "File " + path.substr(path.find_last_of('/') + 1);
+  addSource(source);
+}
+
+void DiffView::refresh()
+{
+  std::set<QString> expanded;
+  std::set<QString> selected;
+  for (int i = 0; i < tree_->topLevelItemCount(); i++) {
+    QTreeWidgetItem* item = tree_->topLevelItem(i);
+    if (item->isExpanded()) {
+      expanded.insert(item->text(0));
+    }
+    if (item->isSelected()) {
+      selected.insert(item->text(0));
+    }
+  }
+  tree_->clear();
+
+  if (!manager_ || !manager_->getDiff().isActive()) {
+    summary_->setText("Pick two maps and press Compare.");
+    return;
+  }
+
+  const MapDiff& diff = manager_->getDiff();
+  MapDiff::Summary summary = diff.getSummary();
+  QString text = QString("%1 to %2: %3 nodes added, %4 removed, %5 changed; %6 edges added, %7 removed, %8 changed")
+    .arg(QString::fromStdString(diff.getBefore().label)).arg(QString::fromStdString(diff.getAfter().label))
+    .arg(summary.nodes[MapDiff::ADDED]).arg(summary.nodes[MapDiff::REMOVED]).arg(summary.nodes[MapDiff::MODIFIED])
+    .arg(summary.edges[MapDiff::ADDED]).arg(summary.edges[MapDiff::REMOVED]).arg(summary.edges[MapDiff::MODIFIED]);
+  if (diff.comparesTags()) {
+    text += QString("; %1 tags added, %2 removed").arg(summary.added_tags).arg(summary.removed_tags);
+  } else {
+    text += "; tags not compared";
+  }
+  summary_->setText(text);
+
+  const TopmapSnapshot& before = *diff.getBefore().snapshot;
+  const TopmapSnapshot& after = *diff.getAfter().snapshot;
+  std::vector<MapDiff::NodeChange> changes = diff.getChanges();
+  for (int i = 0; i < changes.size() && i < MAX_ROWS; i++) {
+    const MapDiff::NodeChange& change = changes[i];
+    QString name = QString::fromStdString(change.name);
+    QString detail;
+    if (change.kind != MapDiff::MODIFIED) {
+      detail = QString("%1 edges").arg(change.edges.size());
+    }
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << name << kindName(change.kind) << detail);
+    for (int column = 0; column < 3; column++) {
+      item->setForeground(column, kindBrush(change.kind));
+    }
+
+    if (change.kind == MapDiff::MODIFIED) {
+      const strands_navigation_msgs::TopologicalNode& old_node = before.nodeAt(before.findNode(change.name));
+      const strands_navigation_msgs::TopologicalNode& new_node = after.nodeAt(after.findNode(change.name));
+      if (change.fields & TopmapDelta::POSE) {
+	new QTreeWidgetItem(item, QStringList() << "" << "pose"
+			    << QString("%1 to %2").arg(position(old_node)).arg(position(new_node)));
+      }
+      if (change.fields & TopmapDelta::TOLERANCE) {
+	new QTreeWidgetItem(item, QStringList() << "" << "tolerance"
+			    << QString("xy %1 to %2, yaw %3 to %4")
+			    .arg(old_node.xy_goal_tolerance).arg(new_node.xy_goal_tolerance)
+			    .arg(old_node.yaw_goal_tolerance).arg(new_node.yaw_goal_tolerance));
+      }
+      if (change.fields & TopmapDelta::INFO) {
+	new QTreeWidgetItem(item, QStringList() << "" << "info" << "map or localisation");
+      }
+      for (int j = 0; j < change.edges.size(); j++) {
+	const MapDiff::EdgeChange& edge = change.edges[j];
+	QTreeWidgetItem* edge_item = new QTreeWidgetItem(item, QStringList() << ""
+							 << "edge " + kindName(edge.kind)
+							 << QString::fromStdString(edge.edge_id)
+							 + (edge.fields ? " (" + edgeFields(edge.fields) + ")" : QString()));
+	edge_item->setForeground(1, kindBrush(edge.kind));
+      }
+    }
+    if (!change.added_tags.empty()) {
+      new QTreeWidgetItem(item, QStringList() << "" << "tags added" << joinTags(change.added_tags));
+    }
+    if (!change.removed_tags.empty()) {
+      new QTreeWidgetItem(item, QStringList() << "" << "tags removed" << joinTags(change.removed_tags));
+    }
+
+    // items have to be in the tree before they can be expanded or selected
+    tree_->addTopLevelItem(item);
+    item->setExpanded(expanded.count(name));
+    item->setSelected(selected.count(name));
+  }
+  if (changes.size() > MAX_ROWS) {
+    tree_->addTopLevelItem(new QTreeWidgetItem(QStringList() << QString("%1 more").arg(changes.size() - MAX_ROWS)));
+  }
+}
+
+void DiffView::onItemActivated(QTreeWidgetItem* item)
+{
+  QTreeWidgetItem* node_item = item->parent() ? item->parent() : item;
+  // removed nodes can't be selected, and the last row may be the summary
+  if (node_item->text(1) == kindName(MapDiff::REMOVED) || node_item->text(1).isEmpty()) {
+    return;
+  }
+  QStringList nodes;
+  QList<QTreeWidgetItem*> items = tree_->selectedItems();
+  for (int i = 0; i < items.size(); i++) {
+    QTreeWidgetItem* selected = items[i]->parent() ? items[i]->parent() : items[i];
+    if (selected->text(1) != kindName(MapDiff::REMOVED) && !selected->text(1).isEmpty() && !nodes.contains(selected->text(0))) {
+      nodes << selected->text(0);
+    }
+  }
+  if (nodes.isEmpty()) {
+    nodes << node_item->text(0);
+  }
+  Q_EMIT selectNodes(nodes);
+}
+
+} // end namespace topological_rviz_tools
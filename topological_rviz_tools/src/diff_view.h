@@ -0,0 +1,99 @@
+#ifndef DIFF_VIEW_H
+#define DIFF_VIEW_H
+
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <QStringList>
+#include <QWidget>
+
+#include "topological_rviz_tools/GetPointset.h"
+#include "topological_rviz_tools/ListPointsets.h"
+
+#include "map_diff.h"
+#include "service_connection.h"
+
+class QComboBox;
+class QLabel;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace topological_rviz_tools
+{
+
+class TopmapManager;
+
+/** @brief Compares two maps, each of which can be the live map, a revision
+ * of it kept earlier, a map file or a pointset in the database, and lists
+ * what changed between them.
+ *
+ * Each changed node is a top level row, coloured like the markers the
+ * TopmapManager shows in the 3D view, with the details of the change as
+ * children. Activating a row asks for the node to be selected. */
+class DiffView: public QWidget
+{
+Q_OBJECT
+public:
+  DiffView(QWidget* parent = 0);
+  ~DiffView();
+
+  /** @brief Set the manager which compares the maps. It must outlive the
+   * view. */
+  void setManager(TopmapManager* manager);
+
+  /** @brief Number of nodes which differ, 0 if nothing is compared. */
+  int numChanges() const;
+
+  // rows beyond this are summed up in one, the 3D view still shows them all
+  static const int MAX_ROWS = 2000;
+
+public Q_SLOTS:
+  /** @brief Rebuild the list from the manager's diff. */
+  void refresh();
+
+Q_SIGNALS:
+  /** @brief Emitted when the user asks to select the nodes in @a nodes. */
+  void selectNodes(const QStringList& nodes);
+  /** @brief Emitted from the thread reading a pointset once the call
+   * returns. */
+  void pointsetRead(bool ok);
+
+private Q_SLOTS:
+  void onCompareClicked();
+  void onClearClicked();
+  /** @brief Keep the live map as it is now, to compare later revisions
+   * with. */
+  void onKeepClicked();
+  void onOpenClicked();
+  void onPointsetClicked();
+  void onPointsetRead(bool ok);
+  /** @brief Write the live map and its tags to a file. */
+  void onSaveClicked();
+  void onItemActivated(QTreeWidgetItem* item);
+
+private:
+  /** @brief Add @a source to both source boxes and pick it as the first
+   * map, comparing it with the live map. */
+  void addSource(const MapDiff::Source& source);
+  void readPointset();
+
+  TopmapManager* manager_;
+  // what can be compared, with the live map first
+  std::vector<MapDiff::Source> sources_;
+  QComboBox* before_box_;
+  QComboBox* after_box_;
+  QLabel* summary_;
+  QTreeWidget* tree_;
+  QPushButton* pointset_button_;
+  ServiceConnection listPointsetsSrv_;
+  ServiceConnection getPointsetSrv_;
+  // the pointset being read, and the thread reading it
+  topological_rviz_tools::GetPointset pointset_srv_;
+  boost::thread pointset_thread_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // DIFF_VIEW_H
@@ -1,21 +1,148 @@
 #include "edge_controller.h"
 
+#include <set>
+
 
 namespace topological_rviz_tools
 {
 EdgeController::EdgeController(const QString& name,
-			       const std::vector<strands_navigation_msgs::Edge>& default_values,
+			       const TopmapSnapshot::NodeConstPtr& node,
+			       StringTable* strings,
 			       const QString& description,
 			       rviz::Property* parent,
 			       const char *changed_slot,
 			       QObject* receiver)
   : rviz::Property(name, "", description, parent, changed_slot, receiver)
+  , strings_(strings)
+{
+  for (int i = 0; i < node->edges.size(); i++) {
+    // ROS_INFO("ADDING EDGE %s", node->edges[i].edge_id.c_str());
+    addEdge(TopmapSnapshot::edge(node, i));
+  }
+}
+
+void EdgeController::addEdge(const TopmapSnapshot::EdgeConstPtr& edge, int index)
+{
+  EdgeProperty* newEdge = new EdgeProperty("Edge", edge, strings_, "");
+  addChild(newEdge, index);
+  edges_[edge->edge_id] = newEdge;
+  connect(newEdge, SIGNAL(edgeModified()), getParent(), SLOT(nodePropertyUpdated()));
+}
+
+EdgeProperty* EdgeController::takeEdgeAt(int index)
+{
+  EdgeProperty* edge = edgeAt(index);
+  boost::unordered_map<std::string, EdgeProperty*>::iterator it = edges_.find(edge->getEdgeId());
+  if (it != edges_.end() && it->second == edge) {
+    edges_.erase(it);
+  }
+  takeChildAt(index);
+  return edge;
+}
+
+void EdgeController::renameEdge(EdgeProperty* edge, const std::string& edge_id, const std::string& node)
+{
+  boost::unordered_map<std::string, EdgeProperty*>::iterator it = edges_.find(edge->getEdgeId());
+  if (it != edges_.end() && it->second == edge) {
+    edges_.erase(it);
+  }
+  edge->rename(edge_id, node);
+  edges_[edge_id] = edge;
+}
+
+EdgeProperty* EdgeController::findEdge(const std::string& edge_id) const
+{
+  boost::unordered_map<std::string, EdgeProperty*>::const_iterator it = edges_.find(edge_id);
+  return it == edges_.end() ? NULL : it->second;
+}
+
+void EdgeController::updateFromMap(const TopmapSnapshot::NodeConstPtr& node, bool changed)
+{
+  const std::vector<strands_navigation_msgs::Edge>& edges = node->edges;
+  if (!changed && numChildren() == edges.size()) {
+    for (int i = 0; i < edges.size(); i++) {
+      edgeAt(i)->updateFromMap(TopmapSnapshot::edge(node, i));
+    }
+    return;
+  }
+
+  std::set<std::string> ids;
+  for (int i = 0; i < edges.size(); i++) {
+    ids.insert(edges[i].edge_id);
+  }
+
+  // Take out edges which no longer exist. New edges reuse them rather than
+  // allocating a whole subtree of properties each.
+  std::vector<EdgeProperty*> spare;
+  for (int i = numChildren() - 1; i >= 0; i--) {
+    if (ids.find(edgeAt(i)->getEdgeId()) == ids.end()) {
+      spare.push_back(takeEdgeAt(i));
+    }
+  }
+
+  // Walk the new list in order. Existing edges are updated in place; if one
+  // is further down the list it is moved up, and new edges are inserted.
+  for (int i = 0; i < edges.size(); i++) {
+    TopmapSnapshot::EdgeConstPtr edge = TopmapSnapshot::edge(node, i);
+    if (i < numChildren() && edgeAt(i)->getEdgeId() == edge->edge_id) {
+      edgeAt(i)->updateFromMap(edge);
+      continue;
+    }
+
+    // rows before i are already done, so an edge found there has a
+    // duplicate ID and this one is new
+    EdgeProperty* moved = findEdge(edge->edge_id);
+    int found = moved ? moved->rowNumberInParent() : -1;
+
+    if (found <= i && !spare.empty()) {
+      EdgeProperty* reused = spare.back();
+      spare.pop_back();
+      reused->updateFromMap(edge);
+      reused->collapse();
+      addChild(reused, i);
+      edges_[edge->edge_id] = reused;
+    } else if (found <= i) {
+      addEdge(edge, i);
+    } else {
+      takeChildAt(found);
+      addChild(moved, i);
+      moved->updateFromMap(edge);
+    }
+  }
+
+  for (int i = 0; i < spare.size(); i++) {
+    delete spare[i];
+  }
+}
+
+bool EdgeController::renameTarget(const std::string& edge_id, const std::string& old_name,
+				  const std::string& new_name)
+{
+  EdgeProperty* edge = findEdge(edge_id);
+  if (!edge || edge->getTargetName() != old_name) {
+    return false;
+  }
+
+  // edge IDs are made up as origin_destination
+  std::string new_id = edge_id;
+  std::string suffix = "_" + old_name;
+  if (new_id.size() > suffix.size() &&
+      new_id.compare(new_id.size() - suffix.size(), suffix.size(), suffix) == 0) {
+    new_id = new_id.substr(0, new_id.size() - old_name.size()) + new_name;
+  }
+  renameEdge(edge, new_id, new_name);
+  return true;
+}
+
+void EdgeController::renameSource(const std::string& old_name, const std::string& new_name)
 {
-  for (int i = 0; i < default_values.size(); i++) {
-    // ROS_INFO("ADDING EDGE %s", default_values[i].edge_id.c_str());
-    EdgeProperty* newEdge = new EdgeProperty("Edge", default_values[i], "");
-    addChild(newEdge);
-    connect(newEdge, SIGNAL(edgeModified()), parent, SLOT(nodePropertyUpdated()));
+  std::string prefix = old_name + "_";
+  for (int i = 0; i < numChildren(); i++) {
+    EdgeProperty* edge = edgeAt(i);
+    std::string edge_id = edge->getEdgeId();
+    if (edge_id.size() > prefix.size() && edge_id.compare(0, prefix.size(), prefix) == 0) {
+      renameEdge(edge, new_name + edge_id.substr(old_name.size()), edge->getTargetName());
+    }
   }
 }
 
@@ -32,6 +159,7 @@ void EdgeController::initialize()
 
 EdgeController::~EdgeController()
 {
+  edges_.clear();
   for (;numChildren() != 0;) {
     delete takeChildAt(0);
   }
@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include <boost/unordered_map.hpp>
+
 #include <QCursor>
 #include <QColor>
 #include <QFont>
@@ -26,6 +28,8 @@
 #include "geometry_msgs/Pose.h"
 
 #include "edge_property.h"
+#include "topmap_snapshot.h"
+#include "string_table.h"
 
 class QKeyEvent;
 
@@ -34,8 +38,9 @@ class EdgeController: public rviz::Property
 {
 Q_OBJECT
 public:
-  EdgeController(const QString& name = QString(),
-		 const std::vector<strands_navigation_msgs::Edge>& default_values = std::vector<strands_navigation_msgs::Edge>(),
+  EdgeController(const QString& name,
+		 const TopmapSnapshot::NodeConstPtr& node,
+		 StringTable* strings,
 		 const QString& description = QString(),
 		 rviz::Property* parent = 0,
 		 const char *changed_slot = 0,
@@ -61,7 +66,25 @@ public:
 
   virtual void load(const rviz::Config& config);
   virtual void save(rviz::Config config) const;
-  bool addEdge(const strands_navigation_msgs::Edge& edge);
+  /** @brief Update the edge list to match the edges of @a node.
+   *
+   * If @a changed is false the edges are assumed to be the same and are only
+   * pointed at the new revision. Otherwise edges are matched by ID, and
+   * only the edges which were added, removed or reordered are inserted into
+   * or taken out of the list. */
+  void updateFromMap(const TopmapSnapshot::NodeConstPtr& node, bool changed);
+
+  /** @brief Patch the edge @a edge_id, which leads to @a old_name, after that
+   * node was renamed to @a new_name. Returns false if there is no such edge. */
+  bool renameTarget(const std::string& edge_id, const std::string& old_name, const std::string& new_name);
+
+  /** @brief Patch the IDs of the edges of this node after it was renamed
+   * from @a old_name to @a new_name. */
+  void renameSource(const std::string& old_name, const std::string& new_name);
+
+  /** @brief The edge with ID @a edge_id, or null if this node has none. */
+  EdgeProperty* findEdge(const std::string& edge_id) const;
+
 Q_SIGNALS:
   void configChanged();
 
@@ -71,8 +94,17 @@ protected:
    * Default implementation does nothing. */
   virtual void onInitialize() {}
 private:
+  void addEdge(const TopmapSnapshot::EdgeConstPtr& edge, int index = -1);
+  /** @brief Remove the edge at @a index from the list and return it. */
+  EdgeProperty* takeEdgeAt(int index);
+  /** @brief Change the displayed names of @a edge and keep edges_ in step. */
+  void renameEdge(EdgeProperty* edge, const std::string& edge_id, const std::string& node);
+  EdgeProperty* edgeAt(int index) const { return static_cast<EdgeProperty*>(childAt(index)); }
+
   QString class_id_;
-  std::vector<EdgeProperty*> edges_;
+  StringTable* strings_;
+  // children by edge ID
+  boost::unordered_map<std::string, EdgeProperty*> edges_;
 };
 
 } // end namespace topological_rviz_tools
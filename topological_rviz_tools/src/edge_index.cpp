@@ -0,0 +1,101 @@
+#include "edge_index.h"
+
+#include <algorithm>
+
+namespace topological_rviz_tools
+{
+
+void EdgeIndex::update(const TopmapSnapshot* previous, const TopmapSnapshot& snapshot, const TopmapDelta& delta)
+{
+  if (!previous) {
+    clear();
+    for (int i = 0; i < snapshot.numNodes(); i++) {
+      add(snapshot.nodeAt(i));
+    }
+    return;
+  }
+
+  for (int i = 0; i < delta.removed.size(); i++) {
+    remove(previous->nodeAt(delta.removed[i]));
+  }
+  for (int i = 0; i < delta.modified.size(); i++) {
+    if (delta.modified[i].fields & TopmapDelta::EDGES) {
+      remove(previous->nodeAt(delta.modified[i].before));
+      add(snapshot.nodeAt(delta.modified[i].after));
+    }
+  }
+  for (int i = 0; i < delta.added.size(); i++) {
+    add(snapshot.nodeAt(delta.added[i]));
+  }
+}
+
+bool EdgeIndex::find(const std::string& edge_id, std::string* node, int* position) const
+{
+  boost::unordered_map<std::string, std::vector<Location> >::const_iterator it = edges_.find(edge_id);
+  if (it == edges_.end()) {
+    return false;
+  }
+  const Location& location = it->second.back();
+  if (node) {
+    *node = location.node;
+  }
+  if (position) {
+    *position = location.position;
+  }
+  return true;
+}
+
+const std::vector<EdgeIndex::IncomingEdge>& EdgeIndex::incoming(const std::string& node) const
+{
+  static const std::vector<IncomingEdge> none;
+  boost::unordered_map<std::string, std::vector<IncomingEdge> >::const_iterator it = incoming_.find(node);
+  return it == incoming_.end() ? none : it->second;
+}
+
+void EdgeIndex::clear()
+{
+  edges_.clear();
+  incoming_.clear();
+}
+
+void EdgeIndex::add(const strands_navigation_msgs::TopologicalNode& node)
+{
+  for (int i = 0; i < node.edges.size(); i++) {
+    edges_[node.edges[i].edge_id].push_back(Location(node.name, i));
+    incoming_[node.edges[i].node].push_back(IncomingEdge(node.name, node.edges[i].edge_id));
+  }
+}
+
+void EdgeIndex::remove(const strands_navigation_msgs::TopologicalNode& node)
+{
+  for (int i = 0; i < node.edges.size(); i++) {
+    const std::string& edge_id = node.edges[i].edge_id;
+    // other edges with the same ID stay indexed
+    boost::unordered_map<std::string, std::vector<Location> >::iterator it = edges_.find(edge_id);
+    if (it != edges_.end()) {
+      std::vector<Location>& locations = it->second;
+      std::vector<Location>::iterator found = std::find(locations.begin(), locations.end(), Location(node.name, i));
+      if (found != locations.end()) {
+	locations.erase(found);
+      }
+      if (locations.empty()) {
+	edges_.erase(it);
+      }
+    }
+
+    boost::unordered_map<std::string, std::vector<IncomingEdge> >::iterator in = incoming_.find(node.edges[i].node);
+    if (in == incoming_.end()) {
+      continue;
+    }
+    std::vector<IncomingEdge>& edges = in->second;
+    std::vector<IncomingEdge>::iterator found = std::find(edges.begin(), edges.end(), IncomingEdge(node.name, edge_id));
+    if (found != edges.end()) {
+      edges.erase(found);
+    }
+    if (edges.empty()) {
+      incoming_.erase(in);
+    }
+  }
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,65 @@
+#ifndef EDGE_INDEX_H
+#define EDGE_INDEX_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Map-wide index of the edges by ID, and of the edges leading to
+ * each node.
+ *
+ * Edges are located by the name of the node they belong to and their
+ * position in its edge list, which is also their row under the node in the
+ * views. Names don't move when other nodes are added or removed, so only the
+ * nodes in a delta are touched by an update. */
+class EdgeIndex
+{
+public:
+  // (source node, edge ID)
+  typedef std::pair<std::string, std::string> IncomingEdge;
+
+  /** @brief Bring the index from @a previous in line with @a snapshot, by
+   * reindexing the nodes in @a delta. If @a previous is null the index is
+   * rebuilt. */
+  void update(const TopmapSnapshot* previous, const TopmapSnapshot& snapshot, const TopmapDelta& delta);
+
+  /** @brief Find the edge @a edge_id. If an ID is used more than once, the
+   * edge indexed last of those still in the map is found.
+   * @return false if there is no such edge. */
+  bool find(const std::string& edge_id, std::string* node, int* position) const;
+
+  /** @brief Edges leading to the node called @a node. */
+  const std::vector<IncomingEdge>& incoming(const std::string& node) const;
+
+  /** @brief Number of distinct edge IDs. */
+  size_t size() const { return edges_.size(); }
+
+  void clear();
+
+private:
+  struct Location
+  {
+    Location(const std::string& node, int position) : node(node), position(position) {}
+    bool operator==(const Location& other) const { return node == other.node && position == other.position; }
+    std::string node;
+    int position;
+  };
+
+  void add(const strands_navigation_msgs::TopologicalNode& node);
+  void remove(const strands_navigation_msgs::TopologicalNode& node);
+
+  // every edge with the ID, in the order they were indexed
+  boost::unordered_map<std::string, std::vector<Location> > edges_;
+  boost::unordered_map<std::string, std::vector<IncomingEdge> > incoming_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // EDGE_INDEX_H
@@ -4,33 +4,67 @@ namespace topological_rviz_tools
 {
 
 EdgeProperty::EdgeProperty(const QString& name,
-			   const strands_navigation_msgs::Edge& default_value,
+			   const TopmapSnapshot::EdgeConstPtr& default_value,
+			   StringTable* strings,
 			   const QString& description,
 			   Property* parent,
 			   const char *changed_slot,
 			   QObject* receiver)
-  : rviz::Property(name, default_value.edge_id.c_str(), description, parent, changed_slot, receiver)
+  : rviz::Property(name, default_value->edge_id.c_str(), description, parent, changed_slot, receiver)
   , edge_(default_value)
-  , action_value_(default_value.action)
-  , topvel_value_(default_value.top_vel)
+  , strings_(strings)
+  , action_value_(strings->intern(default_value->action))
+  , topvel_value_(default_value->top_vel)
   , reset_value_(false)
+  , updating_(false)
 {
-  ros::NodeHandle nh;
-  edgeUpdate_ = nh.serviceClient<strands_navigation_msgs::UpdateEdge>("/topological_map_manager/update_edge", true);
+  edgeUpdate_ = ServiceConnection::create<strands_navigation_msgs::UpdateEdge>("/topological_map_manager/update_edge");
   setReadOnly(true);
-  edge_id_ = new rviz::StringProperty("Edge ID", edge_.edge_id.c_str(), "", this);
+  edge_id_ = new rviz::StringProperty("Edge ID", edge_->edge_id.c_str(), "", this);
   edge_id_->setReadOnly(true);
-  node_ = new rviz::StringProperty("Node", edge_.node.c_str(), "", this);
+  node_ = new rviz::StringProperty("Node", edge_->node.c_str(), "", this);
   node_->setReadOnly(true);
-  action_ = new rviz::StringProperty("Action", edge_.action.c_str(), "", this, SLOT(updateAction()), this);
-  map_2d_ = new rviz::StringProperty("Map 2D", edge_.map_2d.c_str(), "", this);
+  action_ = new rviz::StringProperty("Action", action_value_, "", this, SLOT(updateAction()), this);
+  map_2d_ = new rviz::StringProperty("Map 2D", strings_->intern(edge_->map_2d), "", this);
   map_2d_->setReadOnly(true);
-  top_vel_ = new rviz::FloatProperty("Top vel", edge_.top_vel, "", this, SLOT(updateTopvel()), this);
-  inflation_radius_ = new rviz::FloatProperty("Inflation radius", edge_.inflation_radius, "", this);
+  top_vel_ = new rviz::FloatProperty("Top vel", edge_->top_vel, "", this, SLOT(updateTopvel()), this);
+  inflation_radius_ = new rviz::FloatProperty("Inflation radius", edge_->inflation_radius, "", this);
   inflation_radius_->setReadOnly(true);
 }
 
+void EdgeProperty::updateFromMap(const TopmapSnapshot::EdgeConstPtr& edge)
+{
+  edge_ = edge;
+
+  // setValue does nothing if the value is the same, so only the rows which
+  // actually changed are touched in the view
+  updating_ = true;
+  setValue(QString::fromStdString(edge_->edge_id));
+  edge_id_->setValue(QString::fromStdString(edge_->edge_id));
+  node_->setValue(QString::fromStdString(edge_->node));
+  action_->setValue(strings_->intern(edge_->action));
+  map_2d_->setValue(strings_->intern(edge_->map_2d));
+  top_vel_->setValue(edge_->top_vel);
+  inflation_radius_->setValue(edge_->inflation_radius);
+  updating_ = false;
+
+  action_value_ = strings_->intern(edge_->action);
+  topvel_value_ = edge_->top_vel;
+}
+
+void EdgeProperty::rename(const std::string& edge_id, const std::string& node)
+{
+  updating_ = true;
+  setValue(QString::fromStdString(edge_id));
+  edge_id_->setValue(QString::fromStdString(edge_id));
+  node_->setValue(QString::fromStdString(node));
+  updating_ = false;
+}
+
 void EdgeProperty::updateTopvel(){
+  if (updating_) {
+    return;
+  }
   if (reset_value_){ // this function gets called when we reset a value when the service call fails, so ignore that.
     reset_value_ = false;
     return;
@@ -60,6 +94,9 @@ void EdgeProperty::updateTopvel(){
 }
 
 void EdgeProperty::updateAction(){
+  if (updating_) {
+    return;
+  }
   if (reset_value_){ // this function gets called when we reset a value when the service call fails, so ignore that.
     reset_value_ = false;
     return;
@@ -74,16 +111,16 @@ void EdgeProperty::updateAction(){
     if (srv.response.success) {
       ROS_INFO("Successfully updated edge %s action to %s", edge_id_->getStdString().c_str(), srv.request.action.c_str());
       Q_EMIT edgeModified();
-      action_value_ = action_->getStdString();
+      action_value_ = strings_->intern(action_->getStdString());
     } else {
       ROS_INFO("Failed to update edge action of %s: %s", edge_id_->getStdString().c_str(), srv.response.message.c_str());
       reset_value_ = true;
-      action_->setValue(QString::fromStdString(action_value_));
+      action_->setValue(action_value_);
     }
   } else {
     ROS_WARN("Failed to get response from service to update action for edge %s", edge_id_->getStdString().c_str());
     reset_value_ = true;
-    action_->setValue(QString::fromStdString(action_value_));
+    action_->setValue(action_value_);
   }
 }
   
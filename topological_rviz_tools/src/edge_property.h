@@ -7,6 +7,9 @@
 #include "rviz/properties/float_property.h"
 #include "strands_navigation_msgs/Edge.h"
 #include "strands_navigation_msgs/UpdateEdge.h"
+#include "service_connection.h"
+#include "topmap_snapshot.h"
+#include "string_table.h"
 
 namespace topological_rviz_tools
 {
@@ -16,8 +19,9 @@ class EdgeProperty: public rviz::Property
 {
 Q_OBJECT
 public:
-  EdgeProperty(const QString& name = QString(),
-               const strands_navigation_msgs::Edge& default_value = strands_navigation_msgs::Edge(),
+  EdgeProperty(const QString& name,
+               const TopmapSnapshot::EdgeConstPtr& default_value,
+               StringTable* strings,
                const QString& description = QString(),
                Property* parent = 0,
                const char *changed_slot = 0,
@@ -26,6 +30,17 @@ public:
   virtual ~EdgeProperty();
 
   std::string getEdgeId() { return edge_id_->getString().toStdString(); }
+
+  /** @brief Point the property at @a edge from a newer map revision, and
+   * update any displayed values which differ from it in place. */
+  void updateFromMap(const TopmapSnapshot::EdgeConstPtr& edge);
+
+  std::string getTargetName() { return node_->getStdString(); }
+
+  /** @brief Display @a edge_id and @a node after one of the nodes this edge
+   * refers to was renamed. The map data is left as it is until the next
+   * revision arrives, which should then match what is displayed. */
+  void rename(const std::string& edge_id, const std::string& node);
 public Q_SLOTS:
   void updateAction();
   void updateTopvel();
@@ -34,15 +49,18 @@ Q_SIGNALS:
   void edgeModified();
 
 private:
-  const strands_navigation_msgs::Edge& edge_;
+  TopmapSnapshot::EdgeConstPtr edge_;
+  StringTable* strings_;
   
   // keep track of changing values to ensure that they are redisplayed correctly
   // when we fail to update.
-  std::string action_value_;
+  QString action_value_;
   float topvel_value_;
 
   bool reset_value_;
-  ros::ServiceClient edgeUpdate_;
+  // set while values are written from the map, so we don't send them back
+  bool updating_;
+  ServiceConnection edgeUpdate_;
 
   rviz::StringProperty* edge_id_;
   rviz::StringProperty* node_;
@@ -0,0 +1,77 @@
+#include "map_cache.h"
+
+#include <algorithm>
+
+namespace topological_rviz_tools
+{
+
+MapCache::MapCache(int capacity)
+  : capacity_(std::max(1, capacity))
+{
+}
+
+void MapCache::setCapacity(int capacity)
+{
+  capacity_ = std::max(1, capacity);
+  trim();
+}
+
+void MapCache::put(const TopmapSnapshot::ConstPtr& snapshot)
+{
+  std::list<Entry>::iterator it = find(snapshot->getMap().pointset);
+  if (it == entries_.end()) {
+    entries_.push_front(Entry());
+  } else {
+    entries_.splice(entries_.begin(), entries_, it);
+  }
+  entries_.front().snapshot = snapshot;
+  trim();
+}
+
+void MapCache::setTags(const std::string& pointset, const NodeTags& tags)
+{
+  std::list<Entry>::iterator it = find(pointset);
+  if (it != entries_.end()) {
+    it->tags = tags;
+  }
+}
+
+TopmapSnapshot::ConstPtr MapCache::get(const std::string& pointset, NodeTags* tags)
+{
+  std::list<Entry>::iterator it = find(pointset);
+  if (it == entries_.end()) {
+    return TopmapSnapshot::ConstPtr();
+  }
+  entries_.splice(entries_.begin(), entries_, it);
+  if (tags) {
+    *tags = entries_.front().tags;
+  }
+  return entries_.front().snapshot;
+}
+
+std::vector<std::string> MapCache::getPointsets() const
+{
+  std::vector<std::string> pointsets;
+  for (std::list<Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    pointsets.push_back(it->snapshot->getMap().pointset);
+  }
+  return pointsets;
+}
+
+std::list<MapCache::Entry>::iterator MapCache::find(const std::string& pointset)
+{
+  std::list<Entry>::iterator it = entries_.begin();
+  while (it != entries_.end() && it->snapshot->getMap().pointset != pointset) {
+    ++it;
+  }
+  return it;
+}
+
+void MapCache::trim()
+{
+  while (entries_.size() > capacity_) {
+    entries_.pop_back();
+  }
+}
+
+} // end namespace topological_rviz_tools
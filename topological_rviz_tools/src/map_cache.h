@@ -0,0 +1,66 @@
+#ifndef MAP_CACHE_H
+#define MAP_CACHE_H
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "tag_index.h"
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief The latest snapshots of the last few pointsets which were shown,
+ * so that switching back to one of them needs no loading.
+ *
+ * Tags are not part of the map message, so the tags a pointset had when it
+ * was last shown are kept along with its snapshot.
+ *
+ * Snapshots share the map message, so an entry costs about as much as the
+ * message. Only a handful of pointsets are kept, so they are looked up by
+ * going through the list. */
+class MapCache
+{
+public:
+  MapCache(int capacity = 3);
+
+  /** @brief Keep up to @a capacity pointsets, dropping the ones used longest
+   * ago if there are more. */
+  void setCapacity(int capacity);
+  int getCapacity() const { return capacity_; }
+
+  /** @brief Remember @a snapshot as the latest one of its pointset, and
+   * count the pointset as just used. Tags already kept for the pointset
+   * stay. */
+  void put(const TopmapSnapshot::ConstPtr& snapshot);
+
+  /** @brief Keep @a tags as the tags of @a pointset, if it is cached. */
+  void setTags(const std::string& pointset, const NodeTags& tags);
+
+  /** @brief Latest snapshot of @a pointset, or null if it is not cached.
+   * Counts the pointset as just used. If @a tags is given it is set to the
+   * tags kept for the pointset, which are none if they were never set. */
+  TopmapSnapshot::ConstPtr get(const std::string& pointset, NodeTags* tags = NULL);
+
+  /** @brief Names of the cached pointsets, most recently used first. */
+  std::vector<std::string> getPointsets() const;
+
+private:
+  struct Entry
+  {
+    TopmapSnapshot::ConstPtr snapshot;
+    NodeTags tags;
+  };
+
+  std::list<Entry>::iterator find(const std::string& pointset);
+  void trim();
+
+  int capacity_;
+  // most recently used first
+  std::list<Entry> entries_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // MAP_CACHE_H
@@ -0,0 +1,291 @@
+#include "map_diff.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+#include <boost/functional/hash.hpp>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+const std::vector<std::string> no_tags;
+
+// Edges are matched by ID, or by the node they lead to if they have none.
+const std::string& edgeKey(const strands_navigation_msgs::Edge& edge)
+{
+  return edge.edge_id.empty() ? edge.node : edge.edge_id;
+}
+
+unsigned int compareEdge(const strands_navigation_msgs::Edge& a, const strands_navigation_msgs::Edge& b)
+{
+  unsigned int fields = 0;
+  if (a.node != b.node) {
+    fields |= MapDiff::EDGE_TARGET;
+  }
+  if (a.action != b.action) {
+    fields |= MapDiff::EDGE_ACTION;
+  }
+  if (a.top_vel != b.top_vel) {
+    fields |= MapDiff::EDGE_SPEED;
+  }
+  if (a.map_2d != b.map_2d || a.inflation_radius != b.inflation_radius) {
+    fields |= MapDiff::EDGE_OTHER;
+  }
+  return fields;
+}
+
+void sortTags(NodeTags* tags)
+{
+  for (NodeTags::iterator it = tags->begin(); it != tags->end(); ++it) {
+    std::sort(it->second.begin(), it->second.end());
+  }
+}
+
+struct ChangeLess {
+  bool operator() (const MapDiff::NodeChange& a, const MapDiff::NodeChange& b) const {
+    return TopmapSnapshot::nameLess(a.name, b.name);
+  }
+};
+
+} // end anonymous namespace
+
+const unsigned int MapDiff::TAGS;
+
+MapDiff::Summary::Summary()
+  : added_tags(0)
+  , removed_tags(0)
+{
+  std::fill(nodes, nodes + 3, 0);
+  std::fill(edges, edges + 3, 0);
+}
+
+size_t MapDiff::fingerprint(const strands_navigation_msgs::TopologicalNode& node)
+{
+  size_t seed = 0;
+  boost::hash_combine(seed, node.pose.position.x);
+  boost::hash_combine(seed, node.pose.position.y);
+  boost::hash_combine(seed, node.pose.position.z);
+  boost::hash_combine(seed, node.pose.orientation.x);
+  boost::hash_combine(seed, node.pose.orientation.y);
+  boost::hash_combine(seed, node.pose.orientation.z);
+  boost::hash_combine(seed, node.pose.orientation.w);
+  boost::hash_combine(seed, node.xy_goal_tolerance);
+  boost::hash_combine(seed, node.yaw_goal_tolerance);
+  boost::hash_combine(seed, node.map);
+  boost::hash_combine(seed, node.localise_by_topic);
+  for (int i = 0; i < node.edges.size(); i++) {
+    const strands_navigation_msgs::Edge& edge = node.edges[i];
+    boost::hash_combine(seed, edge.edge_id);
+    boost::hash_combine(seed, edge.node);
+    boost::hash_combine(seed, edge.action);
+    boost::hash_combine(seed, edge.top_vel);
+    boost::hash_combine(seed, edge.map_2d);
+    boost::hash_combine(seed, edge.inflation_radius);
+  }
+  return seed;
+}
+
+void MapDiff::compare(const Source& before, const Source& after)
+{
+  // the fingerprints only need redoing if the first map is another one
+  if (before.snapshot != before_.snapshot || fingerprints_.size() != before.snapshot->numNodes()) {
+    fingerprints_.resize(before.snapshot->numNodes());
+    for (int i = 0; i < before.snapshot->numNodes(); i++) {
+      fingerprints_[i] = fingerprint(before.snapshot->nodeAt(i));
+    }
+  }
+
+  before_ = before;
+  after_ = after;
+  sortTags(&before_.tags);
+  sortTags(&after_.tags);
+  changes_.clear();
+
+  // every node in either map once: the ones in the second map, then the
+  // ones which are only in the first
+  for (int i = 0; i < after_.snapshot->numNodes(); i++) {
+    compareNodeAt(before_.snapshot->findNode(after_.snapshot->nodeAt(i).name), i);
+  }
+  for (int i = 0; i < before_.snapshot->numNodes(); i++) {
+    if (after_.snapshot->findNode(before_.snapshot->nodeAt(i).name) < 0) {
+      compareNodeAt(i, -1);
+    }
+  }
+}
+
+void MapDiff::update(const TopmapSnapshot::ConstPtr& after, const TopmapDelta& delta, const TagChanges& tag_changes)
+{
+  if (!isActive()) {
+    return;
+  }
+
+  TopmapSnapshot::ConstPtr previous = after_.snapshot;
+  after_.snapshot = after;
+  for (int i = 0; i < tag_changes.size(); i++) {
+    std::vector<std::string>& tags = after_.tags[tag_changes[i].first];
+    tags = tag_changes[i].second;
+    std::sort(tags.begin(), tags.end());
+  }
+
+  if (delta.from_revision != previous->getRevision()) {
+    compare(before_, after_);
+    return;
+  }
+
+  for (int i = 0; i < delta.added.size(); i++) {
+    compareNode(after->nodeAt(delta.added[i]).name);
+  }
+  for (int i = 0; i < delta.modified.size(); i++) {
+    compareNode(after->nodeAt(delta.modified[i].after).name);
+  }
+  for (int i = 0; i < delta.removed.size(); i++) {
+    compareNode(previous->nodeAt(delta.removed[i]).name);
+  }
+  for (int i = 0; i < tag_changes.size(); i++) {
+    compareNode(tag_changes[i].first);
+  }
+}
+
+void MapDiff::clear()
+{
+  before_ = Source();
+  after_ = Source();
+  fingerprints_.clear();
+  changes_.clear();
+}
+
+const std::vector<std::string>& MapDiff::tagsOf(const Source& source, const std::string& name) const
+{
+  NodeTags::const_iterator it = source.tags.find(name);
+  return it == source.tags.end() ? no_tags : it->second;
+}
+
+void MapDiff::compareNode(const std::string& name)
+{
+  changes_.erase(name);
+  compareNodeAt(before_.snapshot->findNode(name), after_.snapshot->findNode(name));
+}
+
+void MapDiff::compareNodeAt(int before_ind, int after_ind)
+{
+  if (before_ind < 0 && after_ind < 0) {
+    return;
+  }
+
+  NodeChange change;
+  change.name = after_ind < 0 ? before_.snapshot->nodeAt(before_ind).name : after_.snapshot->nodeAt(after_ind).name;
+  change.fields = 0;
+  if (before_ind < 0 || after_ind < 0) {
+    // everything about a node comes and goes with it
+    bool added = before_ind < 0;
+    const strands_navigation_msgs::TopologicalNode& node = added
+      ? after_.snapshot->nodeAt(after_ind) : before_.snapshot->nodeAt(before_ind);
+    change.kind = added ? ADDED : REMOVED;
+    change.fields = TopmapDelta::ALL;
+    for (int i = 0; i < node.edges.size(); i++) {
+      change.edges.push_back(EdgeChange(change.kind, node.edges[i].edge_id, 0));
+    }
+    if (comparesTags()) {
+      (added ? change.added_tags : change.removed_tags) = tagsOf(added ? after_ : before_, change.name);
+    }
+    changes_[change.name] = change;
+    return;
+  }
+
+  const strands_navigation_msgs::TopologicalNode& before = before_.snapshot->nodeAt(before_ind);
+  const strands_navigation_msgs::TopologicalNode& after = after_.snapshot->nodeAt(after_ind);
+  if (fingerprints_[before_ind] != fingerprint(after)) {
+    change.fields = TopmapSnapshot::compareNodes(before, after);
+    // the pointset differs whenever two pointsets are compared
+    if (before.map == after.map && before.localise_by_topic == after.localise_by_topic) {
+      change.fields &= ~TopmapDelta::INFO;
+    }
+    if (change.fields & TopmapDelta::EDGES) {
+      compareEdges(before, after, &change.edges);
+    }
+  }
+
+  if (comparesTags()) {
+    const std::vector<std::string>& before_tags = tagsOf(before_, change.name);
+    const std::vector<std::string>& after_tags = tagsOf(after_, change.name);
+    if (before_tags != after_tags) {
+      std::set_difference(after_tags.begin(), after_tags.end(), before_tags.begin(), before_tags.end(),
+			  std::back_inserter(change.added_tags));
+      std::set_difference(before_tags.begin(), before_tags.end(), after_tags.begin(), after_tags.end(),
+			  std::back_inserter(change.removed_tags));
+      change.fields |= TAGS;
+    }
+  }
+
+  if (change.fields) {
+    change.kind = MODIFIED;
+    changes_[change.name] = change;
+  }
+}
+
+void MapDiff::compareEdges(const strands_navigation_msgs::TopologicalNode& before,
+			   const strands_navigation_msgs::TopologicalNode& after,
+			   std::vector<EdgeChange>* changes) const
+{
+  std::map<std::string, const strands_navigation_msgs::Edge*> before_edges;
+  for (int i = 0; i < before.edges.size(); i++) {
+    before_edges[edgeKey(before.edges[i])] = &before.edges[i];
+  }
+
+  for (int i = 0; i < after.edges.size(); i++) {
+    const strands_navigation_msgs::Edge& edge = after.edges[i];
+    std::map<std::string, const strands_navigation_msgs::Edge*>::iterator it = before_edges.find(edgeKey(edge));
+    if (it == before_edges.end()) {
+      changes->push_back(EdgeChange(ADDED, edge.edge_id, 0));
+      continue;
+    }
+    unsigned int fields = compareEdge(*it->second, edge);
+    if (fields) {
+      changes->push_back(EdgeChange(MODIFIED, edge.edge_id, fields));
+    }
+    before_edges.erase(it);
+  }
+
+  for (std::map<std::string, const strands_navigation_msgs::Edge*>::iterator it = before_edges.begin();
+       it != before_edges.end(); ++it) {
+    changes->push_back(EdgeChange(REMOVED, it->second->edge_id, 0));
+  }
+}
+
+std::vector<MapDiff::NodeChange> MapDiff::getChanges() const
+{
+  std::vector<NodeChange> changes;
+  changes.reserve(changes_.size());
+  for (boost::unordered_map<std::string, NodeChange>::const_iterator it = changes_.begin(); it != changes_.end(); ++it) {
+    changes.push_back(it->second);
+  }
+  std::sort(changes.begin(), changes.end(), ChangeLess());
+  return changes;
+}
+
+const MapDiff::NodeChange* MapDiff::findChange(const std::string& name) const
+{
+  boost::unordered_map<std::string, NodeChange>::const_iterator it = changes_.find(name);
+  return it == changes_.end() ? NULL : &it->second;
+}
+
+MapDiff::Summary MapDiff::getSummary() const
+{
+  Summary summary;
+  for (boost::unordered_map<std::string, NodeChange>::const_iterator it = changes_.begin(); it != changes_.end(); ++it) {
+    const NodeChange& change = it->second;
+    summary.nodes[change.kind]++;
+    for (int i = 0; i < change.edges.size(); i++) {
+      summary.edges[change.edges[i].kind]++;
+    }
+    summary.added_tags += change.added_tags.size();
+    summary.removed_tags += change.removed_tags.size();
+  }
+  return summary;
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,146 @@
+#ifndef MAP_DIFF_H
+#define MAP_DIFF_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "tag_index.h"
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Nodes, edges and tags which differ between two maps, e.g. the live
+ * map and a file saved before editing, or two pointsets.
+ *
+ * Nodes are matched by name through the name tables of the snapshots, and
+ * each node of the first map gets a fingerprint of its content, so most
+ * unchanged nodes cost one lookup and one hash. Only nodes whose
+ * fingerprints differ are compared field by field, which keeps the whole
+ * comparison linear in the size of the maps. When the second map is the
+ * live one, later revisions only redo the nodes in their delta.
+ *
+ * The pointset of the nodes is not compared, since it always differs
+ * between pointsets. */
+class MapDiff
+{
+public:
+  enum Kind {
+    ADDED,
+    REMOVED,
+    MODIFIED
+  };
+
+  // in addition to the TopmapDelta::Field bits of a modified node
+  static const unsigned int TAGS = 32;
+
+  /** @brief Bits describing which parts of an edge changed. */
+  enum EdgeField {
+    EDGE_TARGET = 1,
+    EDGE_ACTION = 2,
+    EDGE_SPEED = 4,
+    EDGE_OTHER = 8 // map_2d and inflation_radius
+  };
+
+  /** @brief One side of the comparison. */
+  struct Source
+  {
+    Source() : has_tags(false) {}
+
+    TopmapSnapshot::ConstPtr snapshot;
+    NodeTags tags;
+    // tags are only compared if both sides have them
+    bool has_tags;
+    // shown to the user, e.g. the file name
+    std::string label;
+  };
+
+  struct EdgeChange
+  {
+    EdgeChange(Kind kind, const std::string& edge_id, unsigned int fields)
+      : kind(kind), edge_id(edge_id), fields(fields) {}
+    Kind kind;
+    std::string edge_id;
+    // EdgeField bits, for modified edges
+    unsigned int fields;
+  };
+
+  struct NodeChange
+  {
+    std::string name;
+    Kind kind;
+    // TopmapDelta::Field bits and TAGS, for modified nodes
+    unsigned int fields;
+    std::vector<EdgeChange> edges;
+    std::vector<std::string> added_tags;
+    std::vector<std::string> removed_tags;
+  };
+
+  struct Summary
+  {
+    Summary();
+    int nodes[3];
+    int edges[3];
+    int added_tags;
+    int removed_tags;
+  };
+
+  typedef std::vector<std::pair<std::string, std::vector<std::string> > > TagChanges;
+
+  /** @brief Compare @a before with @a after from scratch. */
+  void compare(const Source& before, const Source& after);
+
+  /** @brief Move the second map on to @a after, which is @a delta and
+   * @a tag_changes away from the current one. Only the nodes which changed
+   * are compared again, unless @a delta does not start at the current
+   * revision. */
+  void update(const TopmapSnapshot::ConstPtr& after, const TopmapDelta& delta, const TagChanges& tag_changes);
+
+  void clear();
+
+  bool isActive() const { return before_.snapshot && after_.snapshot; }
+
+  const Source& getBefore() const { return before_; }
+  const Source& getAfter() const { return after_; }
+
+  bool comparesTags() const { return before_.has_tags && after_.has_tags; }
+
+  /** @brief All changes, in display order of the node names. */
+  std::vector<NodeChange> getChanges() const;
+
+  /** @brief Change of the node called @a name, or null if it is the same in
+   * both maps. */
+  const NodeChange* findChange(const std::string& name) const;
+
+  Summary getSummary() const;
+
+  /** @brief Hash of everything compared about @a node except its name and
+   * tags. */
+  static size_t fingerprint(const strands_navigation_msgs::TopologicalNode& node);
+
+private:
+  /** @brief Compare the node called @a name in both maps, replacing what
+   * was known about it. */
+  void compareNode(const std::string& name);
+  /** @brief Compare the nodes at the given display indices, either of
+   * which is -1 if the node is only in the other map. */
+  void compareNodeAt(int before_ind, int after_ind);
+  void compareEdges(const strands_navigation_msgs::TopologicalNode& before,
+		    const strands_navigation_msgs::TopologicalNode& after,
+		    std::vector<EdgeChange>* changes) const;
+  /** @brief Tags of @a name on one side, sorted. */
+  const std::vector<std::string>& tagsOf(const Source& source, const std::string& name) const;
+
+  Source before_;
+  Source after_;
+  // fingerprints of the nodes of the first map, in display order
+  std::vector<size_t> fingerprints_;
+  boost::unordered_map<std::string, NodeChange> changes_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // MAP_DIFF_H
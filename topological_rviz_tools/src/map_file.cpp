@@ -0,0 +1,153 @@
+#include "map_file.h"
+
+#include <fstream>
+
+#include <yaml-cpp/yaml.h>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+template <typename T>
+void read(const YAML::Node& yaml, const char* key, T* value)
+{
+  if (yaml[key]) {
+    *value = yaml[key].as<T>();
+  }
+}
+
+strands_navigation_msgs::TopologicalNode readNode(const YAML::Node& yaml)
+{
+  strands_navigation_msgs::TopologicalNode node;
+  read(yaml, "name", &node.name);
+  read(yaml, "map", &node.map);
+  read(yaml, "pointset", &node.pointset);
+  read(yaml, "localise_by_topic", &node.localise_by_topic);
+  read(yaml, "xy_goal_tolerance", &node.xy_goal_tolerance);
+  read(yaml, "yaw_goal_tolerance", &node.yaw_goal_tolerance);
+
+  const YAML::Node& position = yaml["pose"]["position"];
+  read(position, "x", &node.pose.position.x);
+  read(position, "y", &node.pose.position.y);
+  read(position, "z", &node.pose.position.z);
+  const YAML::Node& orientation = yaml["pose"]["orientation"];
+  read(orientation, "x", &node.pose.orientation.x);
+  read(orientation, "y", &node.pose.orientation.y);
+  read(orientation, "z", &node.pose.orientation.z);
+  read(orientation, "w", &node.pose.orientation.w);
+
+  const YAML::Node& edges = yaml["edges"];
+  for (YAML::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+    strands_navigation_msgs::Edge edge;
+    read(*it, "edge_id", &edge.edge_id);
+    read(*it, "node", &edge.node);
+    read(*it, "action", &edge.action);
+    read(*it, "top_vel", &edge.top_vel);
+    read(*it, "map_2d", &edge.map_2d);
+    read(*it, "inflation_radius", &edge.inflation_radius);
+    read(*it, "recovery_behaviours_config", &edge.recovery_behaviours_config);
+    node.edges.push_back(edge);
+  }
+  return node;
+}
+
+void writeNode(YAML::Emitter& out, const strands_navigation_msgs::TopologicalNode& node)
+{
+  out << YAML::BeginMap;
+  out << YAML::Key << "name" << YAML::Value << node.name;
+  out << YAML::Key << "map" << YAML::Value << node.map;
+  out << YAML::Key << "pointset" << YAML::Value << node.pointset;
+  out << YAML::Key << "localise_by_topic" << YAML::Value << node.localise_by_topic;
+  out << YAML::Key << "xy_goal_tolerance" << YAML::Value << node.xy_goal_tolerance;
+  out << YAML::Key << "yaw_goal_tolerance" << YAML::Value << node.yaw_goal_tolerance;
+
+  out << YAML::Key << "pose" << YAML::Value << YAML::BeginMap;
+  out << YAML::Key << "position" << YAML::Value << YAML::BeginMap
+      << YAML::Key << "x" << YAML::Value << node.pose.position.x
+      << YAML::Key << "y" << YAML::Value << node.pose.position.y
+      << YAML::Key << "z" << YAML::Value << node.pose.position.z
+      << YAML::EndMap;
+  out << YAML::Key << "orientation" << YAML::Value << YAML::BeginMap
+      << YAML::Key << "x" << YAML::Value << node.pose.orientation.x
+      << YAML::Key << "y" << YAML::Value << node.pose.orientation.y
+      << YAML::Key << "z" << YAML::Value << node.pose.orientation.z
+      << YAML::Key << "w" << YAML::Value << node.pose.orientation.w
+      << YAML::EndMap;
+  out << YAML::EndMap;
+
+  out << YAML::Key << "edges" << YAML::Value << YAML::BeginSeq;
+  for (int i = 0; i < node.edges.size(); i++) {
+    const strands_navigation_msgs::Edge& edge = node.edges[i];
+    out << YAML::BeginMap;
+    out << YAML::Key << "edge_id" << YAML::Value << edge.edge_id;
+    out << YAML::Key << "node" << YAML::Value << edge.node;
+    out << YAML::Key << "action" << YAML::Value << edge.action;
+    out << YAML::Key << "top_vel" << YAML::Value << edge.top_vel;
+    out << YAML::Key << "map_2d" << YAML::Value << edge.map_2d;
+    out << YAML::Key << "inflation_radius" << YAML::Value << edge.inflation_radius;
+    out << YAML::Key << "recovery_behaviours_config" << YAML::Value << edge.recovery_behaviours_config;
+    out << YAML::EndMap;
+  }
+  out << YAML::EndSeq;
+  out << YAML::EndMap;
+}
+
+} // end anonymous namespace
+
+strands_navigation_msgs::TopologicalMap::Ptr readMapFile(const std::string& file, NodeTags* tags,
+							 bool* has_meta)
+{
+  strands_navigation_msgs::TopologicalMap::Ptr map(new strands_navigation_msgs::TopologicalMap);
+  YAML::Node entries = YAML::LoadFile(file);
+  if (has_meta) {
+    *has_meta = false;
+  }
+  for (YAML::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+    bool entry_meta = (*it)["node"].IsMap();
+    map->nodes.push_back(readNode(entry_meta ? (*it)["node"] : *it));
+    if (entry_meta && has_meta) {
+      *has_meta = true;
+    }
+    if (tags && entry_meta && (*it)["meta"]["tag"]) {
+      (*tags)[map->nodes.back().name] = (*it)["meta"]["tag"].as<std::vector<std::string> >();
+    }
+  }
+  if (!map->nodes.empty()) {
+    map->name = map->nodes[0].pointset;
+    map->map = map->nodes[0].map;
+    map->pointset = map->nodes[0].pointset;
+  }
+  return map;
+}
+
+bool writeMapFile(const std::string& file, const strands_navigation_msgs::TopologicalMap& map,
+		  const NodeTags& tags)
+{
+  YAML::Emitter out;
+  out << YAML::BeginSeq;
+  for (int i = 0; i < map.nodes.size(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = map.nodes[i];
+    out << YAML::BeginMap;
+    out << YAML::Key << "meta" << YAML::Value << YAML::BeginMap;
+    out << YAML::Key << "map" << YAML::Value << node.map;
+    out << YAML::Key << "node" << YAML::Value << node.name;
+    out << YAML::Key << "pointset" << YAML::Value << node.pointset;
+    NodeTags::const_iterator node_tags = tags.find(node.name);
+    if (node_tags != tags.end() && !node_tags->second.empty()) {
+      out << YAML::Key << "tag" << YAML::Value << YAML::Flow << node_tags->second;
+    }
+    out << YAML::EndMap;
+    out << YAML::Key << "node" << YAML::Value;
+    writeNode(out, node);
+    out << YAML::EndMap;
+  }
+  out << YAML::EndSeq;
+
+  std::ofstream stream(file.c_str());
+  stream << out.c_str() << std::endl;
+  return stream.good();
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,31 @@
+#ifndef MAP_FILE_H
+#define MAP_FILE_H
+
+#include <string>
+#include <vector>
+
+#include "strands_navigation_msgs/TopologicalMap.h"
+
+#include "tag_index.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Read a map file as written by the topological map manager: a list
+ * of entries with the node under "node" and its metadata under "meta". Plain
+ * lists of nodes are accepted too. The tags in the metadata are put into
+ * @a tags if it is not null. @a has_meta, if not null, is set to whether the
+ * entries had metadata, which is where the tags would be.
+ *
+ * Throws YAML::Exception if the file can't be read or parsed. */
+strands_navigation_msgs::TopologicalMap::Ptr readMapFile(const std::string& file, NodeTags* tags = NULL,
+							 bool* has_meta = NULL);
+
+/** @brief Write @a map and the @a tags of its nodes in the format read by
+ * readMapFile(). Returns false if the file could not be written. */
+bool writeMapFile(const std::string& file, const strands_navigation_msgs::TopologicalMap& map,
+		  const NodeTags& tags);
+
+} // end namespace topological_rviz_tools
+
+#endif // MAP_FILE_H
@@ -0,0 +1,225 @@
+#include "map_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace topological_rviz_tools
+{
+
+const double MapStatistics::LENGTH_BIN = 1.0;
+const int MapStatistics::NUM_LENGTH_BINS = 10;
+
+MapStatistics::MapStatistics()
+{
+  clear();
+}
+
+void MapStatistics::clear()
+{
+  snapshot_.reset();
+  nodes_.clear();
+  pairs_.clear();
+  incoming_.clear();
+  degrees_.clear();
+  lengths_.clear();
+  num_edges_ = 0;
+  num_unidirectional_ = 0;
+  num_dangling_ = 0;
+  num_measured_ = 0;
+  total_length_ = 0;
+  // tags come separately and are kept
+}
+
+double MapStatistics::meanLength() const
+{
+  return num_measured_ ? total_length_ / num_measured_ : 0;
+}
+
+void MapStatistics::add(Histogram* histogram, int key, int count)
+{
+  int& value = (*histogram)[key];
+  value += count;
+  if (value == 0) {
+    histogram->erase(key);
+  }
+}
+
+MapStatistics::Histogram MapStatistics::getTagCounts() const
+{
+  Histogram counts = tag_counts_;
+  int tagged = 0;
+  for (Histogram::const_iterator it = tag_counts_.begin(); it != tag_counts_.end(); ++it) {
+    tagged += it->second;
+  }
+  if (numNodes() > tagged) {
+    counts[0] = numNodes() - tagged;
+  }
+  return counts;
+}
+
+void MapStatistics::setTags(const std::string& node, int num_tags)
+{
+  int& current = tags_[node];
+  if (current > 0) {
+    add(&tag_counts_, current, -1);
+  }
+  current = num_tags;
+  if (current > 0) {
+    add(&tag_counts_, current, 1);
+  } else {
+    tags_.erase(node);
+  }
+}
+
+void MapStatistics::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  TopmapSnapshot::ConstPtr previous = snapshot_;
+  if (!previous || !snapshot || delta.from_revision != previous->getRevision()
+      || delta.to_revision != snapshot->getRevision()) {
+    clear();
+    snapshot_ = snapshot;
+    for (int i = 0; snapshot && i < snapshot->numNodes(); i++) {
+      addNode(snapshot->nodeAt(i));
+    }
+    return;
+  }
+  snapshot_ = snapshot;
+
+  // nodes whose position changed, or which appeared or disappeared, change
+  // the length of the edges leading to them
+  std::set<std::string> moved;
+  std::set<std::string> redone;
+  for (int i = 0; i < delta.removed.size(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = previous->nodeAt(delta.removed[i]);
+    removeNode(node);
+    moved.insert(node.name);
+  }
+  for (int i = 0; i < delta.modified.size(); i++) {
+    const TopmapDelta::Change& change = delta.modified[i];
+    removeNode(previous->nodeAt(change.before));
+    addNode(snapshot->nodeAt(change.after));
+    redone.insert(snapshot->nodeAt(change.after).name);
+    if (change.fields & TopmapDelta::POSE) {
+      moved.insert(snapshot->nodeAt(change.after).name);
+    }
+  }
+  for (int i = 0; i < delta.added.size(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = snapshot->nodeAt(delta.added[i]);
+    addNode(node);
+    redone.insert(node.name);
+    moved.insert(node.name);
+  }
+
+  std::set<std::string> sources;
+  for (std::set<std::string>::const_iterator it = moved.begin(); it != moved.end(); ++it) {
+    boost::unordered_map<std::string, std::vector<std::string> >::const_iterator in = incoming_.find(*it);
+    if (in != incoming_.end()) {
+      sources.insert(in->second.begin(), in->second.end());
+    }
+  }
+  for (std::set<std::string>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+    int index = snapshot->findNode(*it);
+    if (index < 0 || redone.count(*it)) {
+      continue;
+    }
+    NodeStats& stats = nodes_[*it];
+    countLengths(stats, -1);
+    measure(snapshot->nodeAt(index), &stats);
+    countLengths(stats, 1);
+  }
+}
+
+void MapStatistics::addNode(const strands_navigation_msgs::TopologicalNode& node)
+{
+  NodeStats& stats = nodes_[node.name];
+  stats.degree = node.edges.size();
+  add(&degrees_, stats.degree, 1);
+  num_edges_ += stats.degree;
+
+  for (int i = 0; i < node.edges.size(); i++) {
+    countPair(node.name, node.edges[i].node, 1);
+    incoming_[node.edges[i].node].push_back(node.name);
+  }
+  measure(node, &stats);
+  countLengths(stats, 1);
+}
+
+void MapStatistics::removeNode(const strands_navigation_msgs::TopologicalNode& node)
+{
+  boost::unordered_map<std::string, NodeStats>::iterator it = nodes_.find(node.name);
+  if (it == nodes_.end()) {
+    return;
+  }
+  add(&degrees_, it->second.degree, -1);
+  num_edges_ -= it->second.degree;
+  countLengths(it->second, -1);
+  nodes_.erase(it);
+
+  for (int i = 0; i < node.edges.size(); i++) {
+    countPair(node.name, node.edges[i].node, -1);
+    std::vector<std::string>& sources = incoming_[node.edges[i].node];
+    std::vector<std::string>::iterator source = std::find(sources.begin(), sources.end(), node.name);
+    if (source != sources.end()) {
+      sources.erase(source);
+    }
+    if (sources.empty()) {
+      incoming_.erase(node.edges[i].node);
+    }
+  }
+}
+
+void MapStatistics::measure(const strands_navigation_msgs::TopologicalNode& node, NodeStats* stats)
+{
+  stats->bins.assign(node.edges.size(), -1);
+  stats->lengths.assign(node.edges.size(), 0);
+  for (int i = 0; i < node.edges.size(); i++) {
+    int target = snapshot_->findNode(node.edges[i].node);
+    if (target < 0) {
+      continue;
+    }
+    const geometry_msgs::Point& to = snapshot_->nodeAt(target).pose.position;
+    double length = std::sqrt(std::pow(to.x - node.pose.position.x, 2) + std::pow(to.y - node.pose.position.y, 2));
+    if (std::isnan(length) || std::isinf(length)) {
+      continue;
+    }
+    stats->lengths[i] = length;
+    stats->bins[i] = std::min<int>(length / LENGTH_BIN, NUM_LENGTH_BINS);
+  }
+}
+
+void MapStatistics::countLengths(const NodeStats& stats, int sign)
+{
+  for (int i = 0; i < stats.bins.size(); i++) {
+    if (stats.bins[i] < 0) {
+      num_dangling_ += sign;
+      continue;
+    }
+    add(&lengths_, stats.bins[i], sign);
+    num_measured_ += sign;
+    total_length_ += sign * stats.lengths[i];
+  }
+}
+
+void MapStatistics::countPair(const std::string& from, const std::string& to, int sign)
+{
+  int& forward = pairs_[NodePair(from, to)];
+  if (from == to) {
+    // an edge to itself is its own way back
+    forward += sign;
+  } else {
+    int& backward = pairs_[NodePair(to, from)];
+    int before = (backward == 0 ? forward : 0) + (forward == 0 ? backward : 0);
+    forward += sign;
+    int after = (backward == 0 ? forward : 0) + (forward == 0 ? backward : 0);
+    num_unidirectional_ += after - before;
+    if (backward == 0) {
+      pairs_.erase(NodePair(to, from));
+    }
+  }
+  if (pairs_[NodePair(from, to)] == 0) {
+    pairs_.erase(NodePair(from, to));
+  }
+}
+
+} // end namespace topological_rviz_tools
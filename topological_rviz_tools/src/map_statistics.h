@@ -0,0 +1,103 @@
+#ifndef MAP_STATISTICS_H
+#define MAP_STATISTICS_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Aggregate numbers describing the map, kept up to date from deltas.
+ *
+ * Every node contributes its out-degree, the lengths of its edges and its
+ * number of tags, and what each node contributed is remembered, so a change
+ * only takes out the old contribution of the nodes involved and adds the new
+ * one. Moving a node changes the length of the edges leading to it as well,
+ * so those are found through an index of incoming edges. An edge counts as
+ * unidirectional if there is no edge back, which is tracked by counting the
+ * edges between each ordered pair of nodes. */
+class MapStatistics
+{
+public:
+  typedef std::map<int, int> Histogram;
+
+  /** @brief Width of the bins of the edge length histogram, in metres. */
+  static const double LENGTH_BIN;
+  /** @brief Edges at least this many bins long share the last bin. */
+  static const int NUM_LENGTH_BINS;
+
+  MapStatistics();
+
+  /** @brief Bring the numbers in line with @a snapshot. If @a delta does
+   * not start from the snapshot seen last, everything is counted again. */
+  void update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  /** @brief Set the number of tags of the node called @a node. Tags of
+   * removed nodes should be set to none. */
+  void setTags(const std::string& node, int num_tags);
+
+  int numNodes() const { return snapshot_ ? snapshot_->numNodes() : 0; }
+  int numEdges() const { return num_edges_; }
+  /** @brief Number of edges without an edge in the opposite direction. */
+  int numUnidirectional() const { return num_unidirectional_; }
+  /** @brief Number of edges leading to nodes which don't exist. */
+  int numDangling() const { return num_dangling_; }
+  /** @brief Mean length of the edges between existing nodes, in metres. */
+  double meanLength() const;
+
+  /** @brief Number of nodes by number of outgoing edges. */
+  const Histogram& getDegrees() const { return degrees_; }
+  /** @brief Number of edges by length bin, see LENGTH_BIN. */
+  const Histogram& getLengths() const { return lengths_; }
+  /** @brief Number of nodes by number of tags, including nodes without. */
+  Histogram getTagCounts() const;
+
+  void clear();
+
+private:
+  struct NodeStats
+  {
+    int degree;
+    // length bin of each edge, -1 if the target does not exist
+    std::vector<int> bins;
+    std::vector<double> lengths;
+  };
+
+  typedef std::pair<std::string, std::string> NodePair;
+
+  void addNode(const strands_navigation_msgs::TopologicalNode& node);
+  void removeNode(const strands_navigation_msgs::TopologicalNode& node);
+  /** @brief Work out the edge lengths of @a node from scratch. */
+  void measure(const strands_navigation_msgs::TopologicalNode& node, NodeStats* stats);
+  void countLengths(const NodeStats& stats, int sign);
+  /** @brief Add @a sign edges from @a from to @a to. */
+  void countPair(const std::string& from, const std::string& to, int sign);
+
+  static void add(Histogram* histogram, int key, int count);
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  boost::unordered_map<std::string, NodeStats> nodes_;
+  // (from, to) -> number of edges
+  boost::unordered_map<NodePair, int> pairs_;
+  // node name -> names of the nodes with an edge to it, once per edge
+  boost::unordered_map<std::string, std::vector<std::string> > incoming_;
+  boost::unordered_map<std::string, int> tags_;
+  Histogram degrees_;
+  Histogram lengths_;
+  Histogram tag_counts_; // only nodes with tags
+  int num_edges_;
+  int num_unidirectional_;
+  int num_dangling_;
+  int num_measured_;
+  double total_length_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // MAP_STATISTICS_H
@@ -0,0 +1,269 @@
+#include "map_validator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+// below this many nodes, starting threads costs more than it saves
+const int MIN_PARALLEL_NODES = 2000;
+
+bool finite(double value)
+{
+  return !std::isnan(value) && !std::isinf(value);
+}
+
+void eraseOne(std::vector<std::string>* names, const std::string& name)
+{
+  std::vector<std::string>::iterator it = std::find(names->begin(), names->end(), name);
+  if (it != names->end()) {
+    names->erase(it);
+  }
+}
+}
+
+bool MapValidator::Issue::operator<(const Issue& other) const
+{
+  if (node != other.node) {
+    return node < other.node;
+  }
+  if (rule != other.rule) {
+    return rule < other.rule;
+  }
+  return edge_id < other.edge_id;
+}
+
+bool MapValidator::Issue::operator==(const Issue& other) const
+{
+  return rule == other.rule && node == other.node && edge_id == other.edge_id && message == other.message;
+}
+
+MapValidator::MapValidator(int threads)
+  : threads_(threads > 0 ? threads : std::max(1u, boost::thread::hardware_concurrency()))
+{
+}
+
+const char* MapValidator::ruleName(Rule rule)
+{
+  switch (rule) {
+  case DANGLING_EDGE:
+    return "Dangling edge";
+  case DUPLICATE_EDGE_ID:
+    return "Duplicate edge ID";
+  case SELF_LOOP:
+    return "Self loop";
+  case INVALID_POSE:
+    return "Invalid pose";
+  case DUPLICATE_NODE_NAME:
+    return "Duplicate node name";
+  }
+  return "";
+}
+
+void MapValidator::clear()
+{
+  snapshot_.reset();
+  issues_.clear();
+  edge_owners_.clear();
+  incoming_.clear();
+  duplicates_.clear();
+}
+
+int MapValidator::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  TopmapSnapshot::ConstPtr previous = snapshot_;
+  if (!previous || !snapshot || delta.from_revision != previous->getRevision()
+      || delta.to_revision != snapshot->getRevision()) {
+    clear();
+    previous.reset();
+  }
+  snapshot_ = snapshot;
+  if (!snapshot) {
+    return 0;
+  }
+
+  std::vector<int> dirty;
+  std::set<std::string> edge_ids;
+  if (!previous) {
+    for (int i = 0; i < snapshot->numNodes(); i++) {
+      indexEdges(snapshot->nodeAt(i), true, &edge_ids);
+      dirty.push_back(i);
+    }
+  } else {
+    // names which appeared or disappeared, which may fix or break edges of
+    // nodes which did not change themselves
+    std::vector<std::string> names;
+    for (int i = 0; i < delta.removed.size(); i++) {
+      const strands_navigation_msgs::TopologicalNode& node = previous->nodeAt(delta.removed[i]);
+      indexEdges(node, false, &edge_ids);
+      issues_.erase(node.name);
+      names.push_back(node.name);
+    }
+    for (int i = 0; i < delta.modified.size(); i++) {
+      indexEdges(previous->nodeAt(delta.modified[i].before), false, &edge_ids);
+      indexEdges(snapshot->nodeAt(delta.modified[i].after), true, &edge_ids);
+      dirty.push_back(delta.modified[i].after);
+    }
+    for (int i = 0; i < delta.added.size(); i++) {
+      const strands_navigation_msgs::TopologicalNode& node = snapshot->nodeAt(delta.added[i]);
+      indexEdges(node, true, &edge_ids);
+      dirty.push_back(delta.added[i]);
+      names.push_back(node.name);
+    }
+
+    for (int i = 0; i < names.size(); i++) {
+      // another node with the same name is now or no longer a duplicate
+      int same = snapshot->findNode(names[i]);
+      if (same >= 0) {
+	dirty.push_back(same);
+      }
+      NameMap::const_iterator it = incoming_.find(names[i]);
+      if (it == incoming_.end()) {
+	continue;
+      }
+      for (int j = 0; j < it->second.size(); j++) {
+	int source = snapshot->findNode(it->second[j]);
+	if (source >= 0) {
+	  dirty.push_back(source);
+	}
+      }
+    }
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+  }
+
+  checkNodes(dirty);
+
+  for (std::set<std::string>::const_iterator it = edge_ids.begin(); it != edge_ids.end(); ++it) {
+    NameMap::const_iterator owners = edge_owners_.find(*it);
+    if (owners != edge_owners_.end() && owners->second.size() > 1) {
+      duplicates_.insert(*it);
+    } else {
+      duplicates_.erase(*it);
+    }
+  }
+  return dirty.size();
+}
+
+void MapValidator::indexEdges(const strands_navigation_msgs::TopologicalNode& node, bool add,
+			      std::set<std::string>* edge_ids)
+{
+  for (int i = 0; i < node.edges.size(); i++) {
+    const strands_navigation_msgs::Edge& edge = node.edges[i];
+    edge_ids->insert(edge.edge_id);
+    if (add) {
+      edge_owners_[edge.edge_id].push_back(node.name);
+      incoming_[edge.node].push_back(node.name);
+      continue;
+    }
+
+    NameMap::iterator it = edge_owners_.find(edge.edge_id);
+    if (it != edge_owners_.end()) {
+      eraseOne(&it->second, node.name);
+      if (it->second.empty()) {
+	edge_owners_.erase(it);
+      }
+    }
+    it = incoming_.find(edge.node);
+    if (it != incoming_.end()) {
+      eraseOne(&it->second, node.name);
+      if (it->second.empty()) {
+	incoming_.erase(it);
+      }
+    }
+  }
+}
+
+void MapValidator::checkNodes(const std::vector<int>& nodes)
+{
+  std::vector<std::vector<Issue> > results(nodes.size());
+  int threads = nodes.size() < MIN_PARALLEL_NODES ? 1 : threads_;
+
+  // Each thread takes its own contiguous share of the nodes and writes only
+  // to its own results, and the snapshot is never written, so no locking is
+  // needed.
+  int share = (nodes.size() + threads - 1) / threads;
+  boost::thread_group group;
+  for (int t = 1; t < threads; t++) {
+    int begin = std::min<int>(t * share, nodes.size());
+    int end = std::min<int>(begin + share, nodes.size());
+    group.create_thread(boost::bind(&MapValidator::checkRange, this, boost::cref(nodes), &results, begin, end));
+  }
+  checkRange(nodes, &results, 0, std::min<int>(share, nodes.size()));
+  group.join_all();
+
+  for (int i = 0; i < nodes.size(); i++) {
+    const std::string& name = snapshot_->nodeAt(nodes[i]).name;
+    if (results[i].empty()) {
+      issues_.erase(name);
+    } else {
+      issues_[name].swap(results[i]);
+    }
+  }
+}
+
+void MapValidator::checkRange(const std::vector<int>& nodes, std::vector<std::vector<Issue> >* results,
+			      int begin, int end) const
+{
+  for (int i = begin; i < end; i++) {
+    checkNode(snapshot_->nodeAt(nodes[i]), &(*results)[i]);
+  }
+}
+
+void MapValidator::checkNode(const strands_navigation_msgs::TopologicalNode& node, std::vector<Issue>* issues) const
+{
+  const geometry_msgs::Pose& pose = node.pose;
+  if (!finite(pose.position.x) || !finite(pose.position.y) || !finite(pose.position.z)
+      || !finite(pose.orientation.x) || !finite(pose.orientation.y) || !finite(pose.orientation.z)
+      || !finite(pose.orientation.w)) {
+    issues->push_back(Issue(INVALID_POSE, node.name, "", "pose has a NaN or infinite value"));
+  }
+
+  int copies = snapshot_->countNode(node.name);
+  if (copies > 1) {
+    std::ostringstream message;
+    message << "name is used by " << copies << " nodes";
+    issues->push_back(Issue(DUPLICATE_NODE_NAME, node.name, "", message.str()));
+  }
+
+  for (int i = 0; i < node.edges.size(); i++) {
+    const strands_navigation_msgs::Edge& edge = node.edges[i];
+    if (edge.node == node.name) {
+      issues->push_back(Issue(SELF_LOOP, node.name, edge.edge_id, "edge leads back to the node"));
+    } else if (snapshot_->findNode(edge.node) < 0) {
+      issues->push_back(Issue(DANGLING_EDGE, node.name, edge.edge_id, "edge leads to missing node " + edge.node));
+    }
+  }
+}
+
+std::vector<MapValidator::Issue> MapValidator::getIssues() const
+{
+  std::vector<Issue> issues;
+  for (boost::unordered_map<std::string, std::vector<Issue> >::const_iterator it = issues_.begin();
+       it != issues_.end(); ++it) {
+    issues.insert(issues.end(), it->second.begin(), it->second.end());
+  }
+
+  for (std::set<std::string>::const_iterator it = duplicates_.begin(); it != duplicates_.end(); ++it) {
+    std::vector<std::string> owners = edge_owners_.find(*it)->second;
+    std::sort(owners.begin(), owners.end());
+    std::ostringstream message;
+    message << "ID is used by " << owners.size() << " edges";
+    owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+    for (int i = 0; i < owners.size(); i++) {
+      issues.push_back(Issue(DUPLICATE_EDGE_ID, owners[i], *it, message.str()));
+    }
+  }
+
+  std::sort(issues.begin(), issues.end());
+  return issues;
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,93 @@
+#ifndef MAP_VALIDATOR_H
+#define MAP_VALIDATOR_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Checks the map for mistakes which the map manager lets through.
+ *
+ * Every node is checked for edges to nodes which don't exist, edges back to
+ * itself, poses which aren't finite and names shared with other nodes. Edge IDs are checked for duplicates
+ * across the whole map. After the first check only the nodes in a delta are
+ * checked again, along with the nodes whose edges point at nodes which
+ * appeared or disappeared, which is what a rename does. Large batches of
+ * nodes are split between several threads. */
+class MapValidator
+{
+public:
+  enum Rule {
+    DANGLING_EDGE,
+    DUPLICATE_EDGE_ID,
+    SELF_LOOP,
+    INVALID_POSE,
+    DUPLICATE_NODE_NAME
+  };
+
+  struct Issue
+  {
+    Issue(Rule rule, const std::string& node, const std::string& edge_id, const std::string& message)
+      : rule(rule), node(node), edge_id(edge_id), message(message) {}
+    Rule rule;
+    std::string node;
+    // empty for problems with the node itself
+    std::string edge_id;
+    std::string message;
+
+    bool operator<(const Issue& other) const;
+    bool operator==(const Issue& other) const;
+  };
+
+  /** @param threads number of threads to check with, or 0 for one per
+   * core. */
+  MapValidator(int threads = 0);
+
+  /** @brief Bring the findings in line with @a snapshot, checking again
+   * only what @a delta may have affected. If @a delta does not start from
+   * the snapshot checked last, everything is checked.
+   * @return the number of nodes checked. */
+  int update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  /** @brief All current findings, sorted by node, rule and edge. */
+  std::vector<Issue> getIssues() const;
+
+  static const char* ruleName(Rule rule);
+
+  void clear();
+
+private:
+  typedef boost::unordered_map<std::string, std::vector<std::string> > NameMap;
+
+  /** @brief Check the nodes at the display indices in @a nodes against the
+   * per node rules. */
+  void checkNodes(const std::vector<int>& nodes);
+  /** @brief Check nodes[begin] to nodes[end - 1] into the same positions of
+   * @a results. */
+  void checkRange(const std::vector<int>& nodes, std::vector<std::vector<Issue> >* results, int begin, int end) const;
+  void checkNode(const strands_navigation_msgs::TopologicalNode& node, std::vector<Issue>* issues) const;
+  /** @brief Add or remove the edges of @a node in the edge indices,
+   * collecting the edge IDs touched in @a edge_ids. */
+  void indexEdges(const strands_navigation_msgs::TopologicalNode& node, bool add, std::set<std::string>* edge_ids);
+
+  int threads_;
+  TopmapSnapshot::ConstPtr snapshot_;
+  // node name -> its findings for the per node rules
+  boost::unordered_map<std::string, std::vector<Issue> > issues_;
+  // edge ID -> names of the nodes with an edge with that ID, once per edge
+  NameMap edge_owners_;
+  // node name -> names of the nodes with an edge to it, once per edge
+  NameMap incoming_;
+  // edge IDs used more than once
+  std::set<std::string> duplicates_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // MAP_VALIDATOR_H
@@ -1,13 +1,32 @@
 #include "node_controller.h"
 
+#include <map>
+#include <set>
+
+#include <boost/bind.hpp>
+
+#include "shared_map.h"
 
 namespace topological_rviz_tools
 {
+const double NodeController::SWITCH_TIMEOUT = 30.0;
+
 NodeController::NodeController()
   : rviz::Property()
+  , memory_budget_(0)
+  , revision_(0)
 {
   ros::NodeHandle nh_;
   top_sub_ = nh_.subscribe("/topological_map", 1, &NodeController::topmapCallback, this);
+  getTagsSrv_ = ServiceConnection::create<strands_navigation_msgs::GetTags>("/topological_map_manager/get_tags",
+									    ServiceConnection::INTERACTIVE, ServiceConnection::RETRY);
+  getTaggedNodesSrv_ = ServiceConnection::create<strands_navigation_msgs::GetTaggedNodes>("/topological_map_manager/get_tagged_nodes",
+										   ServiceConnection::INTERACTIVE, ServiceConnection::RETRY);
+  switchSrv_ = ServiceConnection::create<topological_rviz_tools::SwitchPointset>("/topmap_interface/switch_pointset");
+  // the result comes back on the service call thread
+  connect(this, SIGNAL(switchSent(bool, const QString&)), this, SLOT(onSwitchSent(bool, const QString&)),
+	  Qt::QueuedConnection);
+  connect(this, SIGNAL(tagsFetched(bool)), this, SLOT(onTagsFetched(bool)), Qt::QueuedConnection);
 }
 
 void NodeController::initialize()
@@ -23,54 +42,499 @@ void NodeController::initialize()
 
 NodeController::~NodeController()
 {
+  // the call thread uses the service client, so wait for it
+  if (switch_thread_.joinable()) {
+    switch_thread_.join();
+  }
+  if (tags_thread_.joinable()) {
+    tags_thread_.join();
+  }
+  if (snapshot_ && SharedMap::instance().getSnapshot() == snapshot_) {
+    SharedMap::instance().publish(TopmapSnapshot::ConstPtr(), TopmapDelta());
+  }
 }
 
 void NodeController::topmapCallback(const strands_navigation_msgs::TopologicalMap::ConstPtr& msg){
-  ROS_INFO("Updating topological map");
-  
-  // deep copy (because of const), and then sort the array so we display in
-  // alphabetical order of node names
-  std::vector<strands_navigation_msgs::TopologicalNode> nodes = msg->nodes;
-  std::sort(nodes.begin(), nodes.end(), nodeSort);
-
-  ROS_INFO("%s", nodes[nodes.size()-1].name.c_str());
-
-  // If we're the ones who made the change, then we only replace the property
-  // for the specific nodes that we changed, otherwise replace everything.
-  if (modifiedChildren_.size() == 0) {
-    // Use takechildat to remove, because removeChildren doesn't change the
-    // child states, and can cause issues when the new properties are added.
-    for (;numChildren() != 0;) {
-      delete takeChildAt(0);
-    }
-    
-    for (int i = 0; i < nodes.size(); i++) {
-      NodeProperty* newProp = new NodeProperty("Node", nodes[i], "");
-      addChild(newProp);
-      connect(newProp, SIGNAL(nodeModified(Property*)), this, SLOT(updateModifiedNode(Property*)));
+  // The snapshot shares the message and sorts an index into it, so we display
+  // in alphabetical order of node names without copying any nodes. The
+  // properties hold handles into it, which keep it alive after we drop it.
+  TopmapSnapshot::ConstPtr snapshot(new TopmapSnapshot(msg, ++revision_));
+  served_ = msg->pointset;
+  cache_.put(snapshot);
+
+  // While switching, the map manager may still publish the old pointset. Keep
+  // showing the cached copy of the new one until it has loaded it, and then
+  // replace that copy with what was actually loaded.
+  if (!switching_to_.empty()) {
+    if (msg->pointset != switching_to_) {
+      ROS_INFO("Cached pointset %s, still waiting for %s", msg->pointset.c_str(), switching_to_.c_str());
+      return;
     }
+    switching_to_.clear();
+  }
+
+  ROS_INFO("Updating topological map");
+  loadSnapshot(snapshot);
+}
+
+void NodeController::loadSnapshot(const TopmapSnapshot::ConstPtr& snapshot)
+{
+  if (!modifiedChildren_.empty()) {
+    showSnapshot(snapshot);
+    return;
+  }
+  // Fetching the tags of the whole map takes a call per tag, so it is done
+  // in the background and the map shown once they are in. A map which comes
+  // in meanwhile replaces the one waiting.
+  pending_ = snapshot;
+  if (!tags_thread_.joinable()) {
+    startTagFetch();
+  }
+}
+
+void NodeController::startTagFetch()
+{
+  tags_for_ = pending_;
+  fetched_tags_.clear();
+  tags_thread_ = boost::thread(boost::bind(&NodeController::callFetchTags, this));
+}
+
+void NodeController::callFetchTags()
+{
+  Q_EMIT tagsFetched(fetchAllTags(&fetched_tags_));
+}
+
+void NodeController::onTagsFetched(bool success)
+{
+  tags_thread_.join();
+  TopmapSnapshot::ConstPtr snapshot = pending_;
+  if (!snapshot) {
+    // something was shown directly in the meantime
+    return;
+  }
+  if (!success) {
+    ROS_WARN("Failed to get the tags of the map, only looking up the tags of nodes which were added");
+  }
+  showSnapshot(snapshot, success ? &fetched_tags_ : NULL);
+  // the tags may have changed along with a map which came in during the
+  // fetch, so fetch them again for that one
+  if (success && snapshot != tags_for_) {
+    pending_ = snapshot;
+    startTagFetch();
+  }
+}
+
+void NodeController::showSnapshot(const TopmapSnapshot::ConstPtr& snapshot, const NodeTags* tags)
+{
+  pending_.reset();
+  TopmapSnapshot::ConstPtr previous = snapshot_;
+  snapshot_ = snapshot;
+  if (previous && previous->getMap().pointset != snapshot_->getMap().pointset) {
+    // keep the tags of the pointset we leave, to show if we come back to it
+    cache_.setTags(previous->getMap().pointset, tag_index_.getNodeTags());
+  }
+
+  last_delta_ = TopmapSnapshot::diff(previous.get(), *snapshot_);
+  last_tag_changes_.clear();
+  applyDelta(previous.get(), last_delta_, tags);
+  modifiedChildren_.clear();
+
+  Q_EMIT mapUpdated();
+  SharedMap::instance().publish(snapshot_, last_delta_);
+}
+
+std::vector<std::string> NodeController::getCachedPointsets() const
+{
+  return cache_.getPointsets();
+}
+
+void NodeController::setCacheSize(int pointsets)
+{
+  cache_.setCapacity(pointsets);
+}
+
+bool NodeController::switchPointset(const std::string& pointset)
+{
+  if (!switching_to_.empty()) {
+    ROS_WARN("Still switching to pointset %s", switching_to_.c_str());
+    return false;
+  }
+  if (snapshot_ && pointset == snapshot_->getMap().pointset) {
+    return false;
+  }
+
+  switching_to_ = pointset;
+  NodeTags cached_tags;
+  TopmapSnapshot::ConstPtr cached = cache_.get(pointset, &cached_tags);
+  if (cached) {
+    // Shown under a new revision so that the change is an ordinary delta.
+    // The map manager would answer for the old pointset until it has
+    // switched, so show the tags it had when we left it until the new map
+    // arrives with the current ones.
+    ROS_INFO("Showing cached pointset %s", pointset.c_str());
+    showSnapshot(TopmapSnapshot::ConstPtr(new TopmapSnapshot(*cached, ++revision_)), &cached_tags);
+  }
+
+  topological_rviz_tools::SwitchPointset srv;
+  srv.request.pointset = pointset;
+  if (switch_thread_.joinable()) {
+    switch_thread_.join();
+  }
+  switch_thread_ = boost::thread(boost::bind(&NodeController::callSwitch, this, srv));
+  return true;
+}
+
+void NodeController::callSwitch(topological_rviz_tools::SwitchPointset srv)
+{
+  // loading a pointset from the database can take a while
+  ServiceConnection::Status status = switchSrv_.call(srv, SWITCH_TIMEOUT);
+  if (status != ServiceConnection::OK) {
+    Q_EMIT switchSent(false, "No response from the topological map manager");
   } else {
-    std::vector<std::pair<int, int> > toDelete;
-    for (int msg_ind = 0; msg_ind < nodes.size(); msg_ind++) {
-      // could reduce checks here by removing children, but probably not worth the trouble
-      for (int mod_ind = 0; mod_ind < modifiedChildren_.size(); mod_ind++) {
-	if (std::string(nodes[msg_ind].name).compare(modifiedChildren_[mod_ind]->getValue().toString().toStdString().c_str()) == 0) {
-	  toDelete.push_back(std::make_pair(mod_ind, msg_ind));
-	}
+    Q_EMIT switchSent(srv.response.success, QString::fromStdString(srv.response.message));
+  }
+}
+
+void NodeController::onSwitchSent(bool success, const QString& message)
+{
+  switch_thread_.join();
+  std::string pointset = switching_to_;
+  if (success) {
+    // the new map is normally on its way, or has already arrived
+    ROS_INFO("Map manager switched to pointset %s", pointset.c_str());
+    switching_to_.clear();
+  } else if (!switching_to_.empty()) {
+    ROS_WARN("Failed to switch to pointset %s: %s", pointset.c_str(), message.toStdString().c_str());
+    switching_to_.clear();
+    // go back to what the map manager is serving
+    TopmapSnapshot::ConstPtr served = cache_.get(served_);
+    if (served && snapshot_ && snapshot_->getMap().pointset != served_) {
+      loadSnapshot(TopmapSnapshot::ConstPtr(new TopmapSnapshot(*served, ++revision_)));
+    }
+  }
+  Q_EMIT pointsetSwitched(success, message);
+}
+
+void NodeController::applyDelta(const TopmapSnapshot* previous, const TopmapDelta& delta, const NodeTags* tags)
+{
+  // A node renamed through its property disappears under the old name and
+  // appears under the new one. The property already has the new name, so
+  // move it rather than deleting it and building a new one.
+  std::map<int, NodeProperty*> renamed;
+  std::set<int> added(delta.added.begin(), delta.added.end());
+  // Properties of removed nodes are reused for added ones, rather than
+  // freeing one subtree of some twenty properties and allocating another.
+  std::vector<NodeProperty*> spare;
+
+  edge_index_.update(previous, *snapshot_, delta);
+
+  // Remove from the back so that the indices of the remaining children, which
+  // match the previous snapshot, stay valid. Use takechildat to remove,
+  // because removeChildren doesn't change the child states, and can cause
+  // issues when the new properties are added.
+  for (int i = delta.removed.size() - 1; i >= 0; i--) {
+    NodeProperty* prop = nodeAt(delta.removed[i]);
+    takeChildAt(delta.removed[i]);
+    // If the new name is used more than once, the node is whichever copy of
+    // it was added, which need not be the first.
+    int new_ind = -1;
+    int first = snapshot_->findNode(prop->getNodeName());
+    int copies = snapshot_->countNode(prop->getNodeName());
+    for (int copy = 0; first >= 0 && copy < copies && new_ind < 0; copy++) {
+      if (added.erase(first + copy)) {
+	new_ind = first + copy;
       }
     }
+    if (new_ind >= 0) {
+      renamed[new_ind] = prop;
+    } else if (prop->canReuse()) {
+      forget(prop);
+      spare.push_back(prop);
+    } else {
+      forget(prop);
+      delete prop;
+    }
+  }
 
-    for (int i = 0; i < toDelete.size(); i++) {
-      // remove only the modified child from the child list
-      delete takeChild(modifiedChildren_[toDelete[i].first]);
+  // Tags are kept by name, so they stay while another node has the name.
+  for (int i = 0; i < delta.removed.size(); i++) {
+    const std::string& name = previous->nodeAt(delta.removed[i]).name;
+    if (snapshot_->countNode(name) == 0) {
+      recordTags(name, std::vector<std::string>());
+    }
+  }
+
+  // The remaining children are in the same relative order as in the new
+  // snapshot, so inserting in ascending order puts everything in place.
+  std::vector<int> inserted(added.begin(), added.end());
+  for (std::map<int, NodeProperty*>::iterator it = renamed.begin(); it != renamed.end(); ++it) {
+    inserted.push_back(it->first);
+  }
+  std::sort(inserted.begin(), inserted.end());
 
-      // ROS_INFO("Adding node with name %s, which matches %s", msg->nodes[i].name.c_str(), nodeName.c_str());
-      NodeProperty* newProp = new NodeProperty("Node", nodes[toDelete[i].second], "");
-      addChild(newProp, toDelete[i].second);
+  std::vector<bool> fresh(snapshot_->numNodes(), false);
+  for (int i = 0; i < inserted.size(); i++) {
+    int ind = inserted[i];
+    std::map<int, NodeProperty*>::iterator it = renamed.find(ind);
+    if (it != renamed.end()) {
+      addChild(it->second, ind);
+      it->second->updateFromMap(snapshot_->node(ind), TopmapDelta::ALL);
+    } else if (!spare.empty()) {
+      NodeProperty* prop = spare.back();
+      spare.pop_back();
+      prop->reuse(snapshot_->node(ind));
+      addChild(prop, ind);
+      markUsed(prop);
+    } else {
+      NodeProperty* newProp = new NodeProperty("Node", snapshot_->node(ind), &strings_, "");
+      if (memory_budget_ == 0) {
+	newProp->materialize();
+      } else {
+	newProp->dematerialize();
+      }
+      addChild(newProp, ind);
       connect(newProp, SIGNAL(nodeModified(Property*)), this, SLOT(updateModifiedNode(Property*)));
+      connect(newProp, SIGNAL(nodeRenamed(NodeProperty*, const QString&)),
+	      this, SLOT(propagateRename(NodeProperty*, const QString&)));
+    }
+    fresh[ind] = true;
+  }
+  for (int i = 0; i < spare.size(); i++) {
+    delete spare[i];
+  }
+
+  std::vector<unsigned int> fields(snapshot_->numNodes(), 0);
+  for (int i = 0; i < delta.modified.size(); i++) {
+    fields[delta.modified[i].after] = delta.modified[i].fields;
+  }
+
+  // Tags are not part of the map message. Unless they were fetched for the
+  // whole map, only look up the nodes which are new or were edited through
+  // their properties.
+  std::set<rviz::Property*> modified(modifiedChildren_.begin(), modifiedChildren_.end());
+
+  for (int i = 0; i < numChildren(); i++) {
+    NodeProperty* prop = nodeAt(i);
+    if (!fresh[i]) {
+      // Unchanged nodes are still moved onto the new revision, so the old one
+      // can be freed.
+      prop->updateFromMap(snapshot_->node(i), fields[i]);
+    }
+
+    bool changed;
+    if (tags) {
+      // every node, since reused properties still have the tags of the
+      // nodes they showed before
+      NodeTags::const_iterator found = tags->find(prop->getNodeName());
+      changed = prop->setTags(found == tags->end() ? std::vector<std::string>() : found->second);
+    } else if (fresh[i] || modified.count(prop)) {
+      changed = prop->refreshTags();
+    } else {
+      continue;
+    }
+    // renamed nodes keep their tags, but are now known under another name
+    if (changed || fresh[i]) {
+      recordTags(prop->getNodeName(), prop->getTags());
+    }
+  }
+
+  trimWorkingSet();
+
+  // forget strings only the old revision used, such as the name of a map
+  // which was replaced
+  strings_.prune();
+}
+
+void NodeController::setMemoryBudget(size_t bytes)
+{
+  if (bytes == memory_budget_) {
+    return;
+  }
+  if (bytes == 0) {
+    ROS_INFO("Building the properties of all nodes");
+    for (int i = 0; i < numChildren(); i++) {
+      nodeAt(i)->materialize();
+    }
+    recent_.clear();
+    recent_index_.clear();
+    memory_budget_ = 0;
+    return;
+  }
+
+  bool was_unbounded = memory_budget_ == 0;
+  memory_budget_ = bytes;
+  if (was_unbounded) {
+    // everything is built, so start off with all of it in the working set
+    for (int i = 0; i < numChildren(); i++) {
+      markUsed(nodeAt(i));
+    }
+  }
+  trimWorkingSet();
+}
+
+size_t NodeController::getPropertyMemory() const
+{
+  size_t properties = 0;
+  for (int i = 0; i < numChildren(); i++) {
+    properties += nodeAt(i)->numProperties();
+  }
+  return properties * NodeProperty::BYTES_PER_PROPERTY;
+}
+
+int NodeController::numMaterialized() const
+{
+  int count = 0;
+  for (int i = 0; i < numChildren(); i++) {
+    if (nodeAt(i)->isMaterialized()) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void NodeController::useNode(NodeProperty* node)
+{
+  node->materialize();
+  markUsed(node);
+  trimWorkingSet();
+}
+
+void NodeController::setExpanded(NodeProperty* node, bool expanded)
+{
+  if (expanded) {
+    expanded_.insert(node);
+    useNode(node);
+  } else {
+    expanded_.erase(node);
+  }
+}
+
+void NodeController::setSelected(const std::vector<NodeProperty*>& nodes)
+{
+  selected_.clear();
+  selected_.insert(nodes.begin(), nodes.end());
+  for (int i = 0; i < nodes.size(); i++) {
+    nodes[i]->materialize();
+    markUsed(nodes[i]);
+  }
+  trimWorkingSet();
+}
+
+void NodeController::markUsed(NodeProperty* node)
+{
+  if (memory_budget_ == 0) {
+    return;
+  }
+  boost::unordered_map<NodeProperty*, std::list<NodeProperty*>::iterator>::iterator it = recent_index_.find(node);
+  if (it != recent_index_.end()) {
+    recent_.splice(recent_.begin(), recent_, it->second);
+  } else if (node->isMaterialized()) {
+    recent_.push_front(node);
+    recent_index_[node] = recent_.begin();
+  }
+}
+
+void NodeController::forget(NodeProperty* node)
+{
+  boost::unordered_map<NodeProperty*, std::list<NodeProperty*>::iterator>::iterator it = recent_index_.find(node);
+  if (it != recent_index_.end()) {
+    recent_.erase(it->second);
+    recent_index_.erase(it);
+  }
+  expanded_.erase(node);
+  selected_.erase(node);
+}
+
+void NodeController::trimWorkingSet()
+{
+  if (memory_budget_ == 0) {
+    return;
+  }
+
+  size_t used = getPropertyMemory();
+  // Free the details of the nodes used longest ago first. Nodes which are
+  // expanded or selected are on screen, so they stay whatever the budget.
+  std::list<NodeProperty*>::iterator it = recent_.end();
+  while (used > memory_budget_ && it != recent_.begin()) {
+    --it;
+    NodeProperty* node = *it;
+    if (expanded_.count(node) || selected_.count(node)) {
+      continue;
+    }
+    size_t before = node->numProperties();
+    if (!node->dematerialize()) {
+      continue;
+    }
+    used -= (before - node->numProperties()) * NodeProperty::BYTES_PER_PROPERTY;
+    recent_index_.erase(node);
+    it = recent_.erase(it);
+  }
+}
+
+bool NodeController::fetchAllTags(NodeTags* node_tags)
+{
+  strands_navigation_msgs::GetTags tags_srv;
+  if (!getTagsSrv_.call(tags_srv)) {
+    ROS_WARN("Failed to get response from service to get tags");
+    return false;
+  }
+
+  for (int i = 0; i < tags_srv.response.tags.size(); i++) {
+    strands_navigation_msgs::GetTaggedNodes srv;
+    srv.request.tag = tags_srv.response.tags[i];
+    if (!getTaggedNodesSrv_.call(srv)) {
+      ROS_WARN("Failed to get response from service to get nodes with tag %s",
+	       srv.request.tag.c_str());
+      return false;
+    }
+    for (int j = 0; j < srv.response.nodes.size(); j++) {
+      (*node_tags)[srv.response.nodes[j]].push_back(srv.request.tag);
     }
-    modifiedChildren_.clear();
   }
+  return true;
+}
+
+void NodeController::recordTags(const std::string& node, const std::vector<std::string>& tags)
+{
+  tag_index_.setTags(node, tags);
+  last_tag_changes_.push_back(std::make_pair(node, tags));
+}
+
+EdgeProperty* NodeController::findEdge(const std::string& edge_id) const
+{
+  std::string node;
+  if (!edge_index_.find(edge_id, &node, NULL)) {
+    return NULL;
+  }
+  int ind = snapshot_->findNode(node);
+  if (ind < 0 || !nodeAt(ind)->getEdgeController()) {
+    return NULL;
+  }
+  return nodeAt(ind)->getEdgeController()->findEdge(edge_id);
+}
+
+void NodeController::propagateRename(NodeProperty* node, const QString& old_name)
+{
+  // The index follows snapshot_, which still has the old name until the map
+  // manager publishes the change, so only the edges which actually lead to
+  // the node are visited rather than the whole map.
+  std::string old_str = old_name.toStdString();
+  std::string new_str = node->getNodeName();
+  const std::vector<EdgeIndex::IncomingEdge>& incoming = edge_index_.incoming(old_str);
+  int patched = 0;
+  for (int i = 0; i < incoming.size(); i++) {
+    int ind = snapshot_->findNode(incoming[i].first);
+    // nodes whose details are not built show nothing to patch
+    EdgeController* edges = ind < 0 ? NULL : nodeAt(ind)->getEdgeController();
+    if (edges && edges->renameTarget(incoming[i].second, old_str, new_str)) {
+      patched++;
+    }
+  }
+  // do this after the incoming edges, since a self loop is found by its old ID
+  if (node->getEdgeController()) {
+    node->getEdgeController()->renameSource(old_str, new_str);
+  }
+  ROS_INFO("Patched %d edges leading to %s after rename to %s", patched, old_str.c_str(), new_str.c_str());
 }
 
 void NodeController::updateModifiedNode(Property* node){
@@ -2,9 +2,13 @@
 #define TOPMAP_NODE_CONTROLLER_H
 
 #include <algorithm>
+#include <list>
+#include <set>
 #include <string>
 #include <utility>
 
+#include <boost/thread.hpp>
+
 #include <QCursor>
 #include <QColor>
 #include <QFont>
@@ -26,10 +30,20 @@
 #include "rviz/viewport_mouse_event.h"
 #include "rviz/window_manager_interface.h"
 
+#include "strands_navigation_msgs/GetTaggedNodes.h"
+#include "strands_navigation_msgs/GetTags.h"
 #include "strands_navigation_msgs/TopologicalMap.h"
 #include "strands_navigation_msgs/TopologicalNode.h"
 
+#include "topological_rviz_tools/SwitchPointset.h"
+
+#include "edge_index.h"
+#include "map_cache.h"
 #include "node_property.h"
+#include "service_connection.h"
+#include "string_table.h"
+#include "tag_index.h"
+#include "topmap_snapshot.h"
 
 class QKeyEvent;
 
@@ -65,12 +79,106 @@ public:
    * Typically this will be set by the factory object which created it. */
   virtual void setClassId( const QString& class_id ) { class_id_ = class_id; }
 
+  /** @brief The map revision currently displayed. May be null before the
+   * first map is received. */
+  TopmapSnapshot::ConstPtr getSnapshot() const { return snapshot_; }
+
+  /** @brief Changes between the previous snapshot and the current one. */
+  const TopmapDelta& getLastDelta() const { return last_delta_; }
+
+  typedef std::vector<std::pair<std::string, std::vector<std::string> > > TagChanges;
+
+  /** @brief Nodes whose tags were found to have changed during the last
+   * update, with their new tags. Tags are not part of the map message, so
+   * they are not in the delta. Nodes which were removed or renamed appear
+   * under their old name with no tags. */
+  const TagChanges& getLastTagChanges() const { return last_tag_changes_; }
+
+  /** @brief Tags of all nodes in the current snapshot. */
+  const TagIndex& getTagIndex() const { return tag_index_; }
+
+  /** @brief Edges of the current snapshot by ID and by target node. */
+  const EdgeIndex& getEdgeIndex() const { return edge_index_; }
+
+  /** @brief Shared copies of the strings which repeat across the map. */
+  StringTable& getStrings() { return strings_; }
+
+  /** @brief Property of the edge @a edge_id, or null if there is none or
+   * the details of its node are not built. */
+  EdgeProperty* findEdge(const std::string& edge_id) const;
+
+  /** @brief Only keep the detailed properties of as many nodes as fit in
+   * about @a bytes, or of every node if it is 0.
+   *
+   * Nodes outside the working set are a single row, backed by the map
+   * snapshot, until they are expanded or selected. Expanded and selected
+   * nodes are always kept, and of the rest the ones used longest ago are
+   * freed first. */
+  void setMemoryBudget(size_t bytes);
+  size_t getMemoryBudget() const { return memory_budget_; }
+
+  /** @brief Estimated memory held by the properties of all nodes. */
+  size_t getPropertyMemory() const;
+
+  /** @brief Number of nodes whose detailed properties are built. */
+  int numMaterialized() const;
+
+  /** @brief Build the details of @a node if needed, and count it as just
+   * used. */
+  void useNode(NodeProperty* node);
+
+  /** @brief Keep the details of @a node for as long as it is expanded. */
+  void setExpanded(NodeProperty* node, bool expanded);
+
+  /** @brief Keep the details of @a nodes for as long as they are selected,
+   * replacing the previous selection. */
+  void setSelected(const std::vector<NodeProperty*>& nodes);
+
+  /** @brief Pointset the map manager is serving, as far as we know. */
+  const std::string& getServedPointset() const { return served_; }
+
+  /** @brief Pointsets whose latest map is cached, most recently used first. */
+  std::vector<std::string> getCachedPointsets() const;
+
+  /** @brief Keep the maps of up to @a pointsets pointsets. */
+  void setCacheSize(int pointsets);
+
+  /** @brief Ask the map manager to load @a pointset. If it was shown
+   * before, its cached map is shown straight away, and replaced by the one
+   * the map manager publishes once it has loaded it.
+   * @return false if a switch is already in progress or @a pointset is
+   * the current one. pointsetSwitched() is emitted when the map manager
+   * answers. */
+  bool switchPointset(const std::string& pointset);
+
+  /** @brief True while waiting for the map manager to switch pointsets.
+   * Edits would go to the wrong map in the meantime. */
+  bool isSwitching() const { return !switching_to_.empty(); }
+
 Q_SIGNALS:
   void configChanged();
   void childModified();
+  /** @brief Emitted after a new map revision has been applied. Use
+   * getSnapshot() and getLastDelta() to see what changed. */
+  void mapUpdated();
+  /** @brief Emitted when the map manager answers a switchPointset(). On
+   * failure the map it is still serving is shown again. */
+  void pointsetSwitched(bool success, const QString& message);
+  /** @brief Emitted from the thread making the switch call once it
+   * returns. */
+  void switchSent(bool success, const QString& message);
+  /** @brief Emitted from the thread fetching the tags of the map once it is
+   * done, with whether all of the calls succeeded. */
+  void tagsFetched(bool success);
 
 private Q_SLOTS:
   void updateModifiedNode(Property* node);
+  void onSwitchSent(bool success, const QString& message);
+  /** @brief Show the map which is waiting for its tags, with the tags. */
+  void onTagsFetched(bool success);
+  /** @brief Patch the edges which refer to a node which was just renamed,
+   * so that they are correct before the new map arrives. */
+  void propagateRename(NodeProperty* node, const QString& old_name);
 
 protected:
   /** @brief Do subclass-specific initialization.  Called by
@@ -81,25 +189,74 @@ protected:
   void addModifiedChild(rviz::Property* modifiedChild){ modifiedChildren_.push_back(modifiedChild); }
 
 private:
+  // seconds to wait for the map manager to load a pointset
+  static const double SWITCH_TIMEOUT;
+
   void topmapCallback(const strands_navigation_msgs::TopologicalMap::ConstPtr& msg);
+  /** @brief Show @a snapshot once the tags of the whole map have been
+   * fetched in the background. If the change came from our own properties,
+   * it is shown straight away and only their tags are looked up. */
+  void loadSnapshot(const TopmapSnapshot::ConstPtr& snapshot);
+  /** @brief Make @a snapshot the current one and update the children. The
+   * nodes are given the tags in @a tags. If it is null, only the tags of the
+   * nodes which were added or edited through their properties are looked
+   * up, one node at a time. Drops any map waiting for its tags. */
+  void showSnapshot(const TopmapSnapshot::ConstPtr& snapshot, const NodeTags* tags = NULL);
+  /** @brief Bring the children in line with snapshot_, touching only the
+   * nodes in @a delta, apart from the tags if @a tags is given. */
+  void applyDelta(const TopmapSnapshot* previous, const TopmapDelta& delta, const NodeTags* tags);
+  void callSwitch(topological_rviz_tools::SwitchPointset srv);
+  /** @brief Fetch the tags of pending_ on tags_thread_. */
+  void startTagFetch();
+  void callFetchTags();
+  /** @brief Get the tags of every node with two service calls plus one per
+   * tag, rather than one per node. Returns false if any call failed. */
+  bool fetchAllTags(NodeTags* node_tags);
+  void recordTags(const std::string& node, const std::vector<std::string>& tags);
+  NodeProperty* nodeAt(int index) const { return static_cast<NodeProperty*>(childAt(index)); }
+  /** @brief Move @a node to the front of the working set, if it is built. */
+  void markUsed(NodeProperty* node);
+  /** @brief Drop @a node from the working set before it is deleted or
+   * reused. */
+  void forget(NodeProperty* node);
+  /** @brief Free the details of nodes until the budget is met. */
+  void trimWorkingSet();
 
   QString class_id_;
   ros::Subscriber top_sub_;
+  ServiceConnection getTagsSrv_;
+  ServiceConnection getTaggedNodesSrv_;
+  ServiceConnection switchSrv_;
   std::vector<rviz::Property*> modifiedChildren_;
 
-  /* bool sortNodes(strands_navigation_msgs::TopologicalNode a, strands_navigation_msgs::TopologicalNode b) { return a.name.compare(b.name) < 0; } */
+  TopmapSnapshot::ConstPtr snapshot_;
+  TopmapDelta last_delta_;
+  TagChanges last_tag_changes_;
+  TagIndex tag_index_;
+  EdgeIndex edge_index_;
+  StringTable strings_;
 
-  struct NodeSorter {
+  MapCache cache_;
+  // pointset of the last map received
+  std::string served_;
+  // set until the map manager has switched to it
+  std::string switching_to_;
+  boost::thread switch_thread_;
+  // map waiting for its tags, the one they are being fetched for, and the
+  // thread fetching them into fetched_tags_
+  TopmapSnapshot::ConstPtr pending_;
+  TopmapSnapshot::ConstPtr tags_for_;
+  NodeTags fetched_tags_;
+  boost::thread tags_thread_;
 
-    bool operator() (strands_navigation_msgs::TopologicalNode a,
-                     strands_navigation_msgs::TopologicalNode b) {
-      std::string an = a.name;
-      std::string bn = b.name;
-      std::transform(an.begin(), an.end(), an.begin(), ::tolower);
-      std::transform(bn.begin(), bn.end(), bn.begin(), ::tolower);
-      return an.compare(bn) < 0;
-    }
-  } nodeSort;
+  // 0 when all properties are built
+  size_t memory_budget_;
+  // built nodes, most recently used first; only kept with a budget
+  std::list<NodeProperty*> recent_;
+  boost::unordered_map<NodeProperty*, std::list<NodeProperty*>::iterator> recent_index_;
+  std::set<NodeProperty*> expanded_;
+  std::set<NodeProperty*> selected_;
+  unsigned int revision_;
 };
 
 } // end namespace topological_rviz_tools
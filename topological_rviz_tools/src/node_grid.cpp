@@ -0,0 +1,177 @@
+#include "node_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+bool usable(double value)
+{
+  return !std::isnan(value) && !std::isinf(value);
+}
+
+double squaredDistance(const geometry_msgs::Point& pos, double x, double y)
+{
+  return (pos.x - x) * (pos.x - x) + (pos.y - y) * (pos.y - y);
+}
+}
+
+NodeGrid::NodeGrid(double cell)
+  : cell_(cell)
+{
+}
+
+void NodeGrid::setCellSize(double cell)
+{
+  if (cell != cell_) {
+    build(snapshot_, cell);
+  }
+}
+
+boost::uint64_t NodeGrid::cellKey(boost::int64_t x, boost::int64_t y)
+{
+  // Coordinates beyond 32 bits wrap around. That only puts far apart nodes
+  // in the same cell, and distances are always checked.
+  return boost::uint64_t(x) << 32 | boost::uint32_t(y);
+}
+
+boost::int64_t NodeGrid::cellOf(double value) const
+{
+  // keep far out positions within range of the integer
+  return std::max(-1e15, std::min(1e15, std::floor(value / cell_)));
+}
+
+bool NodeGrid::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  bool rebuild = !snapshot_ || !snapshot || delta.from_revision != snapshot_->getRevision()
+    || delta.to_revision != snapshot->getRevision() || !delta.added.empty() || !delta.removed.empty();
+  for (int i = 0; !rebuild && i < delta.modified.size(); i++) {
+    rebuild = delta.modified[i].fields & TopmapDelta::POSE;
+  }
+
+  if (rebuild) {
+    build(snapshot, cell_);
+  } else {
+    snapshot_ = snapshot;
+  }
+  return rebuild;
+}
+
+void NodeGrid::build(const TopmapSnapshot::ConstPtr& snapshot, double cell)
+{
+  snapshot_ = snapshot;
+  cell_ = cell;
+  cells_.clear();
+  if (!snapshot_) {
+    return;
+  }
+  for (int i = 0; i < snapshot_->numNodes(); i++) {
+    const geometry_msgs::Point& pos = snapshot_->nodeAt(i).pose.position;
+    if (usable(pos.x) && usable(pos.y)) {
+      cells_[cellKey(cellOf(pos.x), cellOf(pos.y))].push_back(i);
+    }
+  }
+}
+
+bool NodeGrid::worthSearching(double reach) const
+{
+  double side = 2 * reach + 1;
+  return side * side <= cells_.size();
+}
+
+int NodeGrid::nearest(double x, double y, double max_distance) const
+{
+  if (!snapshot_ || !usable(x) || !usable(y)) {
+    return -1;
+  }
+
+  int nearest = -1;
+  double best = max_distance * max_distance;
+  double span = std::ceil(max_distance / cell_);
+  if (!worthSearching(span)) {
+    for (CellMap::const_iterator it = cells_.begin(); it != cells_.end(); ++it) {
+      for (int j = 0; j < it->second.size(); j++) {
+	double dist = squaredDistance(snapshot_->nodeAt(it->second[j]).pose.position, x, y);
+	if (dist < best) {
+	  best = dist;
+	  nearest = it->second[j];
+	}
+      }
+    }
+    return nearest;
+  }
+
+  // Look at rings of cells further and further out. Anything beyond ring r
+  // is at least r cells away, so once a node is closer than that the search
+  // is over.
+  boost::int64_t reach = span;
+  boost::int64_t cx = cellOf(x);
+  boost::int64_t cy = cellOf(y);
+  for (boost::int64_t r = 0; r <= reach; r++) {
+    for (boost::int64_t i = cx - r; i <= cx + r; i++) {
+      // only the first and last row of the ring, or every row at the sides
+      bool side = i == cx - r || i == cx + r;
+      for (boost::int64_t j = cy - r; j <= cy + r; j += side ? 1 : 2 * r) {
+	CellMap::const_iterator it = cells_.find(cellKey(i, j));
+	if (it != cells_.end()) {
+	  for (int k = 0; k < it->second.size(); k++) {
+	    double dist = squaredDistance(snapshot_->nodeAt(it->second[k]).pose.position, x, y);
+	    if (dist < best) {
+	      best = dist;
+	      nearest = it->second[k];
+	    }
+	  }
+	}
+	if (r == 0) {
+	  break;
+	}
+      }
+    }
+    if (nearest >= 0 && best <= (r * cell_) * (r * cell_)) {
+      break;
+    }
+  }
+  return nearest;
+}
+
+void NodeGrid::within(double x, double y, double distance, std::vector<int>* nodes) const
+{
+  if (!snapshot_ || !usable(x) || !usable(y)) {
+    return;
+  }
+
+  double limit = distance * distance;
+  double span = std::ceil(distance / cell_);
+  if (!worthSearching(span)) {
+    for (CellMap::const_iterator it = cells_.begin(); it != cells_.end(); ++it) {
+      for (int j = 0; j < it->second.size(); j++) {
+	if (squaredDistance(snapshot_->nodeAt(it->second[j]).pose.position, x, y) < limit) {
+	  nodes->push_back(it->second[j]);
+	}
+      }
+    }
+    return;
+  }
+
+  boost::int64_t reach = span;
+  boost::int64_t cx = cellOf(x);
+  boost::int64_t cy = cellOf(y);
+  for (boost::int64_t i = cx - reach; i <= cx + reach; i++) {
+    for (boost::int64_t j = cy - reach; j <= cy + reach; j++) {
+      CellMap::const_iterator it = cells_.find(cellKey(i, j));
+      if (it == cells_.end()) {
+	continue;
+      }
+      for (int k = 0; k < it->second.size(); k++) {
+	if (squaredDistance(snapshot_->nodeAt(it->second[k]).pose.position, x, y) < limit) {
+	  nodes->push_back(it->second[k]);
+	}
+      }
+    }
+  }
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,66 @@
+#ifndef NODE_GRID_H
+#define NODE_GRID_H
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Uniform spatial hash of the node positions in a snapshot.
+ *
+ * Each node goes into the square cell its x and y fall in, so finding the
+ * nodes near a point only looks at the cells around it. Only occupied cells
+ * are stored. When a query would cover more cells than are occupied, the
+ * occupied cells are scanned instead, so a huge radius costs no more than
+ * going through every node. The grid is only rebuilt when nodes are added,
+ * removed or moved. Nodes without a finite position are left out. */
+class NodeGrid
+{
+public:
+  /** @param cell side of the cells in metres. */
+  NodeGrid(double cell = 1.0);
+
+  /** @brief Change the side of the cells and rebuild. */
+  void setCellSize(double cell);
+  double getCellSize() const { return cell_; }
+
+  /** @brief Move to @a snapshot. Returns true if the grid was rebuilt. */
+  bool update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  /** @brief Rebuild from @a snapshot with cells of side @a cell. */
+  void build(const TopmapSnapshot::ConstPtr& snapshot, double cell);
+
+  TopmapSnapshot::ConstPtr getSnapshot() const { return snapshot_; }
+
+  /** @brief Display index of the node closest to @a x, @a y, or -1 if there
+   * is none within @a max_distance. */
+  int nearest(double x, double y, double max_distance) const;
+
+  /** @brief Add the display indices of the nodes closer than @a distance to
+   * @a x, @a y to @a nodes, in no particular order. */
+  void within(double x, double y, double distance, std::vector<int>* nodes) const;
+
+  /** @brief Key of the cell at column @a x and row @a y. */
+  static boost::uint64_t cellKey(boost::int64_t x, boost::int64_t y);
+
+private:
+  typedef boost::unordered_map<boost::uint64_t, std::vector<int> > CellMap;
+
+  boost::int64_t cellOf(double value) const;
+  /** @brief Whether a query reaching @a reach cells out from its own cell
+   * looks at fewer cells than scanning the occupied ones. */
+  bool worthSearching(double reach) const;
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  double cell_;
+  CellMap cells_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // NODE_GRID_H
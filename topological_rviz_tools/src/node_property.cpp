@@ -1,51 +1,142 @@
 #include "node_property.h"
 
+#include <algorithm>
+
 namespace topological_rviz_tools
 {
 
 NodeProperty::NodeProperty(const QString& name,
-			   const strands_navigation_msgs::TopologicalNode& default_value,
+			   const TopmapSnapshot::NodeConstPtr& default_value,
+			   StringTable* strings,
 			   const QString& description,
 			   Property* parent,
 			   const char *changed_slot,
 			   QObject* receiver)
-  : rviz::Property(name, default_value.name.c_str(), description, parent, changed_slot, this)
+  : rviz::Property(name, default_value->name.c_str(), description, parent, changed_slot, this)
   , node_(default_value)
-  , name_(default_value.name)
-  , xy_tol_value_(default_value.xy_goal_tolerance)
-  , yaw_tol_value_(default_value.yaw_goal_tolerance)
+  , strings_(strings)
+  , placeholder_(NULL)
+  , map_(NULL)
+  , pointset_(NULL)
+  , localise_(NULL)
+  , yaw_tolerance_(NULL)
+  , xy_tolerance_(NULL)
+  , name_(default_value->name)
+  , xy_tol_value_(default_value->xy_goal_tolerance)
+  , yaw_tol_value_(default_value->yaw_goal_tolerance)
   , reset_value_(false)
+  , updating_(false)
+  , pose_(NULL)
+  , edge_controller_(NULL)
+  , tag_controller_(NULL)
 {
   // manually connect the signals instead of using the constructor to do it.
   // Can't seem to get the connection to work if passing in the slot in the
   // constructor.
   connect(this, SIGNAL(changed()), this, SLOT(updateNodeName()));
 
-  ros::NodeHandle nh;
-  nameUpdate_ = nh.serviceClient<strands_navigation_msgs::UpdateNodeName>("/topological_map_manager/update_node_name", true);
-  toleranceUpdate_ = nh.serviceClient<strands_navigation_msgs::UpdateNodeTolerance>("/topological_map_manager/update_node_tolerance", true);
+  nameUpdate_ = ServiceConnection::create<strands_navigation_msgs::UpdateNodeName>("/topological_map_manager/update_node_name");
+  toleranceUpdate_ = ServiceConnection::create<strands_navigation_msgs::UpdateNodeTolerance>("/topological_map_manager/update_node_tolerance");
+}
+
+void NodeProperty::materialize()
+{
+  if (isMaterialized()) {
+    return;
+  }
 
-  map_ = new rviz::StringProperty("Map", node_.map.c_str(), "", this);
+  map_ = new rviz::StringProperty("Map", strings_->intern(node_->map), "", this);
   map_->setReadOnly(true);
 
-  pointset_ = new rviz::StringProperty("Pointset", node_.pointset.c_str(), "", this);
+  pointset_ = new rviz::StringProperty("Pointset", strings_->intern(node_->pointset), "", this);
   pointset_->setReadOnly(true);
 
-  localise_ = new rviz::StringProperty("Localise by topic", node_.localise_by_topic.c_str(), "", this);
+  localise_ = new rviz::StringProperty("Localise by topic", strings_->intern(node_->localise_by_topic), "", this);
   localise_->setReadOnly(true);
 
-  yaw_tolerance_ = new rviz::FloatProperty("Yaw Tolerance", node_.yaw_goal_tolerance,
+  yaw_tolerance_ = new rviz::FloatProperty("Yaw Tolerance", node_->yaw_goal_tolerance,
 					   "The robot is facing the right direction if the"
 					   " difference between the current yaw and the node's"
 					   " orientation is less than this value.",
 					   this, SLOT(updateYawTolerance()), this);
-  xy_tolerance_ = new rviz::FloatProperty("XY Tolerance", node_.xy_goal_tolerance,
+  xy_tolerance_ = new rviz::FloatProperty("XY Tolerance", node_->xy_goal_tolerance,
 					  "The robot is at the goal if the difference"
 					  " between its current position and the node's"
 					  " position is less than this value.",
 					  this, SLOT(updateXYTolerance()), this);
 
-  ros::ServiceClient tagService_ = nh.serviceClient<strands_navigation_msgs::GetNodeTags>("/topological_map_manager/get_node_tags", true);
+  // the tags are filled in by the controller, which can fetch them for the
+  // whole map at once
+  tag_controller_ = new TagController("Tags", tags_, strings_, "", this);
+  tag_controller_->setHidden(tags_.empty());
+
+  pose_ = new PoseProperty("Pose", TopmapSnapshot::pose(node_), "", this);
+  edge_controller_ = new EdgeController("Edges", node_, strings_, "", this);
+
+  // only removed once the real children are in, so the row stays expanded
+  delete placeholder_;
+  placeholder_ = NULL;
+}
+
+bool NodeProperty::dematerialize()
+{
+  if (!canReuse()) {
+    return false;
+  }
+
+  // something to expand, which is where the details are built again
+  if (!placeholder_) {
+    placeholder_ = new rviz::Property("Loading...", QVariant(), "", this);
+    placeholder_->setReadOnly(true);
+  }
+  if (!isMaterialized()) {
+    return true;
+  }
+
+  delete map_;
+  delete pointset_;
+  delete localise_;
+  delete yaw_tolerance_;
+  delete xy_tolerance_;
+  delete tag_controller_;
+  delete pose_;
+  delete edge_controller_;
+  map_ = NULL;
+  pointset_ = NULL;
+  localise_ = NULL;
+  yaw_tolerance_ = NULL;
+  xy_tolerance_ = NULL;
+  tag_controller_ = NULL;
+  pose_ = NULL;
+  edge_controller_ = NULL;
+  return true;
+}
+
+int NodeProperty::numProperties() const
+{
+  if (!isMaterialized()) {
+    return placeholder_ ? 2 : 1;
+  }
+  // this one, five values, the tag list, the pose with its nine values and
+  // the edge list, plus the tags and seven properties for each edge
+  return 18 + tags_.size() + 7 * edge_controller_->numChildren();
+}
+
+NodeProperty::~NodeProperty()
+{
+  delete map_;
+  delete pointset_;
+  delete yaw_tolerance_;
+  delete xy_tolerance_;
+  delete pose_;
+  delete edge_controller_;
+}
+
+std::vector<std::string> NodeProperty::fetchTags()
+{
+  ServiceConnection tagService_ = ServiceConnection::create<strands_navigation_msgs::GetNodeTags>("/topological_map_manager/get_node_tags",
+												     ServiceConnection::INTERACTIVE,
+												     ServiceConnection::RETRY);
   strands_navigation_msgs::GetNodeTags srv;
   srv.request.node_name = name_.c_str();
   std::vector<std::string> node_tags;
@@ -58,26 +149,77 @@ NodeProperty::NodeProperty(const QString& name,
   } else {
     ROS_WARN("Failed to get response from service to get tags for node %s", name_.c_str());
   }
-  tag_controller_ = new TagController("Tags", node_tags, "", this);
-  if (node_tags.size() == 0) {
-    tag_controller_->setHidden(true);
+  return node_tags;
+}
+
+bool NodeProperty::refreshTags()
+{
+  return setTags(fetchTags());
+}
+
+bool NodeProperty::setTags(const std::vector<std::string>& tags)
+{
+  // the order depends on which service the tags came from, so sort them to
+  // be able to compare
+  std::vector<std::string> sorted(tags);
+  std::sort(sorted.begin(), sorted.end());
+  if (tag_controller_) {
+    tag_controller_->updateTags(sorted, name_);
+  }
+  if (sorted == tags_) {
+    return false;
+  }
+  tags_.swap(sorted);
+  return true;
+}
+
+void NodeProperty::updateFromMap(const TopmapSnapshot::NodeConstPtr& node, unsigned int fields)
+{
+  node_ = node;
+
+  updating_ = true;
+  if (fields & TopmapDelta::NAME) {
+    name_ = node_->name;
+    setValue(QString::fromStdString(name_));
+  }
+  if (fields & TopmapDelta::TOLERANCE) {
+    yaw_tol_value_ = node_->yaw_goal_tolerance;
+    xy_tol_value_ = node_->xy_goal_tolerance;
+  }
+  if (!isMaterialized()) {
+    // the details are read from node_ when they are built
+    updating_ = false;
+    return;
+  }
+  if (fields & TopmapDelta::INFO) {
+    map_->setValue(strings_->intern(node_->map));
+    pointset_->setValue(strings_->intern(node_->pointset));
+    localise_->setValue(strings_->intern(node_->localise_by_topic));
   }
+  if (fields & TopmapDelta::TOLERANCE) {
+    yaw_tolerance_->setValue(yaw_tol_value_);
+    xy_tolerance_->setValue(xy_tol_value_);
+  }
+  updating_ = false;
 
-  pose_ = new PoseProperty("Pose", node_.pose, "", this);
-  edge_controller_ = new EdgeController("Edges", node_.edges, "", this);
+  pose_->updateFromMap(TopmapSnapshot::pose(node_), fields & TopmapDelta::POSE);
+  edge_controller_->updateFromMap(node_, fields & TopmapDelta::EDGES);
 }
 
-NodeProperty::~NodeProperty()
+void NodeProperty::reuse(const TopmapSnapshot::NodeConstPtr& node)
 {
-  delete map_;
-  delete pointset_;
-  delete yaw_tolerance_;
-  delete xy_tolerance_;
-  delete pose_;
-  delete edge_controller_;
+  reset_value_ = false;
+  updateFromMap(node, TopmapDelta::ALL);
+  if (pose_) {
+    pose_->clearStatus();
+  }
+  collapse();
 }
 
 void NodeProperty::updateYawTolerance(){
+  if (updating_) {
+    return;
+  }
   if (reset_value_){ // this function gets called when we reset a value when the service call fails, so ignore that.
     reset_value_ = false;
     return;
@@ -106,6 +248,9 @@ void NodeProperty::updateYawTolerance(){
 }
 
 void NodeProperty::updateXYTolerance(){
+  if (updating_) {
+    return;
+  }
   if (reset_value_){ // this function gets called when we reset a value when the service call fails, so ignore that.
     reset_value_ = false;
     return;
@@ -134,6 +279,9 @@ void NodeProperty::updateXYTolerance(){
 }
 
 void NodeProperty::updateNodeName(){
+  if (updating_) {
+    return;
+  }
   if (reset_value_){ // this function gets called when we reset a value when the service call fails, so ignore that.
     reset_value_ = false;
     return;
@@ -147,7 +295,9 @@ void NodeProperty::updateNodeName(){
     if (srv.response.success) {
       ROS_INFO("Successfully updated node name %s to %s", name_.c_str(), srv.request.new_name.c_str());
       Q_EMIT nodeModified(this);
+      std::string old_name = name_;
       name_ = getValue().toString().toStdString();
+      Q_EMIT nodeRenamed(this, QString::fromStdString(old_name));
     } else {
       ROS_INFO("Failed to update node name of %s to %s: %s", name_.c_str(), srv.request.new_name.c_str(), srv.response.message.c_str());
       reset_value_ = true;
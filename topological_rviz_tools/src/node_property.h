@@ -9,6 +9,9 @@
 #include "strands_navigation_msgs/GetNodeTags.h"
 #include "strands_navigation_msgs/UpdateNodeName.h"
 #include "strands_navigation_msgs/UpdateNodeTolerance.h"
+#include "service_connection.h"
+#include "topmap_snapshot.h"
+#include "string_table.h"
 #include "pose_property.h"
 #include "edge_controller.h"
 #include "tag_controller.h"
@@ -23,8 +26,11 @@ class NodeProperty: public rviz::Property
 {
 Q_OBJECT
 public:
-  NodeProperty(const QString& name = QString(),
-               const strands_navigation_msgs::TopologicalNode& default_value = strands_navigation_msgs::TopologicalNode(),
+  /** @brief The displayed strings which repeat across the map are taken
+   * from @a strings, which must outlive the property. */
+  NodeProperty(const QString& name,
+               const TopmapSnapshot::NodeConstPtr& default_value,
+               StringTable* strings,
                const QString& description = QString(),
                Property* parent = 0,
                const char *changed_slot = 0,
@@ -32,8 +38,55 @@ public:
 
   virtual ~NodeProperty();
 
+  /** @brief Rough size of one rviz property, with its QObject data, name,
+   * description and value. */
+  static const size_t BYTES_PER_PROPERTY = 400;
+
   std::string getNodeName() { return name_; }
+  /** @brief The tag and edge lists, which are null while the details of
+   * the node are not built. */
   TagController* getTagController() { return tag_controller_; }
+  EdgeController* getEdgeController() { return edge_controller_; }
+
+  /** @brief Build the properties below the node row from the map data.
+   * New properties have nothing below the name until this is called. */
+  void materialize();
+
+  /** @brief Free the properties below the node row, leaving a placeholder
+   * to expand. The node keeps a handle to its map data, and its name, tags
+   * and tolerances. Returns false, doing nothing, if an edit is in
+   * progress. */
+  bool dematerialize();
+
+  bool isMaterialized() const { return pose_ != NULL; }
+
+  /** @brief Number of rviz properties making up the node's subtree. */
+  int numProperties() const;
+
+  /** @brief Point the property at @a node from a newer map revision.
+   *
+   * Only the leaf values for the TopmapDelta::Field bits set in @a fields
+   * are written, and the edge and tag lists are patched rather than rebuilt,
+   * so the rest of the subtree and its state in the view are untouched. */
+  void updateFromMap(const TopmapSnapshot::NodeConstPtr& node, unsigned int fields);
+
+  /** @brief True if the property has nothing in progress, so it can be
+   * taken out of the tree and reused for another node. */
+  bool canReuse() const { return !pose_ || pose_->isIdle(); }
+
+  /** @brief Turn the property into one for @a node, which may be a
+   * different node altogether. Tags are left for the caller to set. */
+  void reuse(const TopmapSnapshot::NodeConstPtr& node);
+
+  /** @brief Query the map manager for the tags of this node and update the
+   * tag list to match. Returns true if the tags changed. */
+  bool refreshTags();
+
+  /** @brief Update the tag list to match @a tags, which were fetched by
+   * someone else. Returns true if the tags changed. */
+  bool setTags(const std::vector<std::string>& tags);
+
+  const std::vector<std::string>& getTags() const { return tags_; }
 public Q_SLOTS:
   void updateYawTolerance();
   void updateXYTolerance();
@@ -42,14 +95,21 @@ public Q_SLOTS:
 
 Q_SIGNALS:
 void nodeModified(Property* node);
+/** @brief Emitted after the map manager accepted a new name for @a node,
+ * which was previously called @a old_name. */
+void nodeRenamed(NodeProperty* node, const QString& old_name);
 
 private:
-  const strands_navigation_msgs::TopologicalNode& node_;
+  std::vector<std::string> fetchTags();
+
+  // keeps the map revision this property was built from alive
+  TopmapSnapshot::NodeConstPtr node_;
+  StringTable* strings_;
   
-  ros::ServiceClient nameUpdate_;
-  ros::ServiceClient toleranceUpdate_;
+  ServiceConnection nameUpdate_;
+  ServiceConnection toleranceUpdate_;
 
-  rviz::StringProperty* node_name_;
+  rviz::Property* placeholder_;
   rviz::StringProperty* map_;
   rviz::StringProperty* pointset_;
   rviz::StringProperty* localise_;
@@ -61,9 +121,12 @@ private:
   std::string name_;
   // Also store the editable values, in case the service call fails. We then
   // reset the property value to its original value.
+  std::vector<std::string> tags_;
   float xy_tol_value_;
   float yaw_tol_value_;
   bool reset_value_;
+  // set while values are written from the map, so we don't send them back
+  bool updating_;
   PoseProperty* pose_;
   EdgeController* edge_controller_;
   TagController* tag_controller_;
@@ -0,0 +1,152 @@
+#include "overlap_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "node_grid.h"
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+int findRoot(std::vector<int>* parents, int node)
+{
+  while ((*parents)[node] != node) {
+    (*parents)[node] = (*parents)[(*parents)[node]];
+    node = (*parents)[node];
+  }
+  return node;
+}
+
+double distance(const geometry_msgs::Point& a, const geometry_msgs::Point& b)
+{
+  return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+bool usable(double value)
+{
+  return !std::isnan(value) && !std::isinf(value);
+}
+}
+
+OverlapDetector::OverlapDetector()
+{
+}
+
+bool OverlapDetector::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  bool redo = !snapshot_ || !snapshot || delta.from_revision != snapshot_->getRevision()
+    || delta.to_revision != snapshot->getRevision() || !delta.added.empty() || !delta.removed.empty();
+  for (int i = 0; !redo && i < delta.modified.size(); i++) {
+    redo = delta.modified[i].fields & (TopmapDelta::POSE | TopmapDelta::TOLERANCE);
+  }
+
+  snapshot_ = snapshot;
+  if (redo) {
+    detect();
+  }
+  return redo;
+}
+
+void OverlapDetector::detect()
+{
+  clusters_.clear();
+  if (!snapshot_) {
+    return;
+  }
+
+  // cells are the size of the median tolerance
+  int n = snapshot_->numNodes();
+  std::vector<double> tolerances;
+  for (int i = 0; i < n; i++) {
+    double tolerance = snapshot_->nodeAt(i).xy_goal_tolerance;
+    if (usable(tolerance) && tolerance > 0) {
+      tolerances.push_back(tolerance);
+    }
+  }
+  if (tolerances.empty()) {
+    return;
+  }
+  std::nth_element(tolerances.begin(), tolerances.begin() + tolerances.size() / 2, tolerances.end());
+  double cell = tolerances[tolerances.size() / 2];
+
+  // A node with a much larger tolerance just looks in more cells, so one
+  // odd node can't make every cell huge. The grid scans its occupied cells
+  // instead when that is fewer, which bounds what an outlier costs.
+  NodeGrid grid;
+  grid.build(snapshot_, cell);
+
+  // Each node looks for others within its own tolerance, so a pair is
+  // found from the side with the larger one.
+  std::vector<std::pair<int, int> > pairs;
+  std::vector<int> near;
+  for (int i = 0; i < n; i++) {
+    const strands_navigation_msgs::TopologicalNode& node = snapshot_->nodeAt(i);
+    double tolerance = node.xy_goal_tolerance;
+    if (!usable(tolerance) || tolerance <= 0) {
+      continue;
+    }
+
+    near.clear();
+    grid.within(node.pose.position.x, node.pose.position.y, tolerance, &near);
+    for (int j = 0; j < near.size(); j++) {
+      if (near[j] != i) {
+	pairs.push_back(std::make_pair(std::min(i, near[j]), std::max(i, near[j])));
+      }
+    }
+  }
+
+  cluster(pairs);
+}
+
+void OverlapDetector::cluster(const std::vector<std::pair<int, int> >& pairs)
+{
+  if (pairs.empty()) {
+    return;
+  }
+
+  std::vector<int> parents(snapshot_->numNodes());
+  for (int i = 0; i < parents.size(); i++) {
+    parents[i] = i;
+  }
+  for (int i = 0; i < pairs.size(); i++) {
+    int a = findRoot(&parents, pairs[i].first);
+    int b = findRoot(&parents, pairs[i].second);
+    parents[std::max(a, b)] = std::min(a, b);
+  }
+
+  // roots are the lowest index in their cluster, so the map is in display
+  // order of the lowest node
+  std::map<int, std::vector<int> > members;
+  for (int i = 0; i < pairs.size(); i++) {
+    members[findRoot(&parents, pairs[i].first)].push_back(pairs[i].first);
+    members[findRoot(&parents, pairs[i].second)].push_back(pairs[i].second);
+  }
+
+  for (std::map<int, std::vector<int> >::iterator it = members.begin(); it != members.end(); ++it) {
+    Cluster cluster;
+    cluster.nodes.swap(it->second);
+    std::sort(cluster.nodes.begin(), cluster.nodes.end());
+    cluster.nodes.erase(std::unique(cluster.nodes.begin(), cluster.nodes.end()), cluster.nodes.end());
+
+    // keep the node with the most edges, as it has the fewest to move
+    int keep = 0;
+    for (int i = 1; i < cluster.nodes.size(); i++) {
+      if (snapshot_->nodeAt(cluster.nodes[i]).edges.size() > snapshot_->nodeAt(cluster.nodes[keep]).edges.size()) {
+	keep = i;
+      }
+    }
+    std::rotate(cluster.nodes.begin(), cluster.nodes.begin() + keep, cluster.nodes.begin() + keep + 1);
+
+    cluster.spread = 0;
+    const geometry_msgs::Point& kept = snapshot_->nodeAt(cluster.nodes[0]).pose.position;
+    for (int i = 1; i < cluster.nodes.size(); i++) {
+      cluster.spread = std::max(cluster.spread, distance(kept, snapshot_->nodeAt(cluster.nodes[i]).pose.position));
+    }
+    clusters_.push_back(cluster);
+  }
+}
+
+} // end namespace topological_rviz_tools
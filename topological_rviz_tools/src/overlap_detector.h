@@ -0,0 +1,54 @@
+#ifndef OVERLAP_DETECTOR_H
+#define OVERLAP_DETECTOR_H
+
+#include <vector>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Finds nodes which are so close together that the robot would be
+ * at both at once.
+ *
+ * Two nodes overlap if they are closer than the larger of their
+ * xy_goal_tolerances. Overlapping nodes are grouped into clusters, each of
+ * which would be merged into one node. Positions are put into a NodeGrid
+ * with cells the size of a typical tolerance, so each node is only compared
+ * with its close neighbours. Nothing is redone unless nodes are added,
+ * removed or moved, or tolerances change. */
+class OverlapDetector
+{
+public:
+  struct Cluster
+  {
+    // display indices, with the node to keep first and the rest ascending
+    std::vector<int> nodes;
+    // largest distance between the kept node and another one
+    double spread;
+  };
+
+  OverlapDetector();
+
+  /** @brief Move to @a snapshot. Returns true if the clusters were redone,
+   * in which case they may have changed. */
+  bool update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  TopmapSnapshot::ConstPtr getSnapshot() const { return snapshot_; }
+
+  /** @brief Clusters of overlapping nodes in the snapshot, in display order
+   * of their lowest node. */
+  const std::vector<Cluster>& getClusters() const { return clusters_; }
+
+private:
+  void detect();
+  /** @brief Make the clusters from the overlapping @a pairs. */
+  void cluster(const std::vector<std::pair<int, int> >& pairs);
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  std::vector<Cluster> clusters_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // OVERLAP_DETECTOR_H
@@ -0,0 +1,240 @@
+#include "overlap_view.h"
+
+#include <map>
+#include <set>
+
+#include <QFont>
+#include <QHBoxLayout>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+
+namespace topological_rviz_tools
+{
+
+OverlapView::OverlapView(QWidget* parent)
+  : QWidget(parent)
+  , detector_(NULL)
+{
+  tree_ = new QTreeWidget();
+  tree_->setColumnCount(2);
+  tree_->setHeaderLabels(QStringList() << "Nodes" << "Spread");
+  tree_->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  tree_->setUniformRowHeights(true);
+
+  QPushButton* select_button = new QPushButton("Select nodes");
+  QPushButton* merge_button = new QPushButton("Merge");
+
+  QHBoxLayout* button_layout = new QHBoxLayout;
+  button_layout->addWidget(select_button);
+  button_layout->addWidget(merge_button);
+  button_layout->setContentsMargins(2, 0, 2, 0);
+
+  QVBoxLayout* main_layout = new QVBoxLayout;
+  main_layout->setContentsMargins(0,0,0,0);
+  main_layout->addWidget(tree_);
+  main_layout->addLayout(button_layout);
+  setLayout(main_layout);
+
+  connect(select_button, SIGNAL(clicked()), this, SLOT(onSelectClicked()));
+  connect(merge_button, SIGNAL(clicked()), this, SLOT(onMergeClicked()));
+  connect(tree_, SIGNAL(itemActivated(QTreeWidgetItem*, int)), this, SLOT(onSelectClicked()));
+}
+
+void OverlapView::setDetector(const OverlapDetector* detector)
+{
+  detector_ = detector;
+  refresh();
+}
+
+int OverlapView::numClusters() const
+{
+  return detector_ ? detector_->getClusters().size() : 0;
+}
+
+void OverlapView::refresh()
+{
+  // clusters are keyed by the node to keep
+  std::set<QString> expanded;
+  std::set<QString> selected;
+  for (int i = 0; i < tree_->topLevelItemCount(); i++) {
+    QTreeWidgetItem* item = tree_->topLevelItem(i);
+    if (item->isExpanded()) {
+      expanded.insert(item->child(0)->text(0));
+    }
+    if (item->isSelected()) {
+      selected.insert(item->child(0)->text(0));
+    }
+  }
+
+  tree_->clear();
+  if (!detector_ || !detector_->getSnapshot()) {
+    return;
+  }
+
+  TopmapSnapshot::ConstPtr snapshot = detector_->getSnapshot();
+  const std::vector<OverlapDetector::Cluster>& clusters = detector_->getClusters();
+  for (int i = 0; i < clusters.size(); i++) {
+    const std::vector<int>& nodes = clusters[i].nodes;
+    QString kept = QString::fromStdString(snapshot->nodeAt(nodes[0]).name);
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList()
+						<< QString("%1 and %2 more").arg(kept).arg(nodes.size() - 1)
+						<< QString("%1 m").arg(clusters[i].spread, 0, 'f', 2));
+    for (int j = 0; j < nodes.size(); j++) {
+      new QTreeWidgetItem(item, QStringList() << QString::fromStdString(snapshot->nodeAt(nodes[j]).name)
+			  << (j == 0 ? "kept" : ""));
+    }
+    QFont font = item->child(0)->font(0);
+    font.setBold(true);
+    item->child(0)->setFont(0, font);
+
+    // items have to be in the tree before they can be expanded or selected
+    tree_->addTopLevelItem(item);
+    item->setExpanded(expanded.count(kept));
+    item->setSelected(selected.count(kept));
+  }
+}
+
+std::vector<int> OverlapView::selectedClusters() const
+{
+  std::set<int> clusters;
+  QList<QTreeWidgetItem*> items = tree_->selectedItems();
+  for (int i = 0; i < items.size(); i++) {
+    QTreeWidgetItem* cluster_item = items[i]->parent() ? items[i]->parent() : items[i];
+    clusters.insert(tree_->indexOfTopLevelItem(cluster_item));
+  }
+  return std::vector<int>(clusters.begin(), clusters.end());
+}
+
+void OverlapView::onSelectClicked()
+{
+  std::vector<int> clusters = selectedClusters();
+  if (clusters.empty() || !detector_) {
+    return;
+  }
+
+  TopmapSnapshot::ConstPtr snapshot = detector_->getSnapshot();
+  QStringList nodes;
+  for (int i = 0; i < clusters.size(); i++) {
+    const std::vector<int>& members = detector_->getClusters()[clusters[i]].nodes;
+    for (int j = 0; j < members.size(); j++) {
+      nodes << QString::fromStdString(snapshot->nodeAt(members[j]).name);
+    }
+  }
+  Q_EMIT selectNodes(nodes);
+}
+
+void OverlapView::onMergeClicked()
+{
+  std::vector<int> clusters = selectedClusters();
+  if (clusters.empty() || !detector_) {
+    return;
+  }
+
+  int removed = 0;
+  for (int i = 0; i < clusters.size(); i++) {
+    removed += detector_->getClusters()[clusters[i]].nodes.size() - 1;
+  }
+  if (QMessageBox::question(this, "Merge nodes",
+			    QString("Merge %1 clusters? This removes %2 nodes and moves their edges onto the kept nodes.")
+			    .arg(clusters.size()).arg(removed),
+			    QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
+    Q_EMIT mergeRequested();
+  }
+}
+
+int OverlapView::queueMerge(BulkExecutor* bulk) const
+{
+  std::vector<int> clusters = selectedClusters();
+  if (clusters.empty() || !detector_) {
+    return 0;
+  }
+  TopmapSnapshot::ConstPtr snapshot = detector_->getSnapshot();
+
+  // removed node -> node it is merged into
+  std::map<std::string, std::string> into;
+  for (int i = 0; i < clusters.size(); i++) {
+    const std::vector<int>& nodes = detector_->getClusters()[clusters[i]].nodes;
+    for (int j = 1; j < nodes.size(); j++) {
+      into[snapshot->nodeAt(nodes[j]).name] = snapshot->nodeAt(nodes[0]).name;
+    }
+  }
+
+  std::set<std::pair<std::string, std::string> > existing;
+  for (int i = 0; i < snapshot->numNodes(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = snapshot->nodeAt(i);
+    for (int j = 0; j < node.edges.size(); j++) {
+      existing.insert(std::make_pair(node.name, node.edges[j].node));
+    }
+  }
+
+  // Every edge touching a removed node is replaced by one between the nodes
+  // they are merged into, unless that edge exists already or would lead
+  // back to where it started.
+  std::vector<strands_navigation_msgs::AddEdge> added;
+  std::vector<strands_navigation_msgs::UpdateEdge> speeds;
+  std::vector<std::string> dropped;
+  for (int i = 0; i < snapshot->numNodes(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = snapshot->nodeAt(i);
+    std::map<std::string, std::string>::const_iterator origin_it = into.find(node.name);
+    std::string origin = origin_it == into.end() ? node.name : origin_it->second;
+
+    for (int j = 0; j < node.edges.size(); j++) {
+      const strands_navigation_msgs::Edge& edge = node.edges[j];
+      std::map<std::string, std::string>::const_iterator dest_it = into.find(edge.node);
+      if (origin_it == into.end() && dest_it == into.end()) {
+	continue;
+      }
+      // edges of removed nodes go with them
+      if (origin_it == into.end()) {
+	dropped.push_back(edge.edge_id);
+      }
+
+      std::string destination = dest_it == into.end() ? edge.node : dest_it->second;
+      if (origin == destination || !existing.insert(std::make_pair(origin, destination)).second) {
+	continue;
+      }
+      strands_navigation_msgs::AddEdge add;
+      add.request.origin = origin;
+      add.request.destination = destination;
+      add.request.action = edge.action;
+      add.request.edge_id = origin + "_" + destination;
+      added.push_back(add);
+
+      // new edges get the default speed
+      strands_navigation_msgs::UpdateEdge speed;
+      speed.request.edge_id = add.request.edge_id;
+      speed.request.action = edge.action;
+      speed.request.top_vel = edge.top_vel;
+      speeds.push_back(speed);
+    }
+  }
+
+  // The new edges must exist before their speed is set, and the old ones
+  // go last, so that a failure part way leaves every connection in place.
+  for (int i = 0; i < added.size(); i++) {
+    bulk->add("/topological_map_manager/add_edge", added[i], "add edge " + added[i].request.edge_id);
+  }
+  bulk->barrier();
+  for (int i = 0; i < speeds.size(); i++) {
+    bulk->add("/topological_map_manager/update_edge", speeds[i], "set the speed of edge " + speeds[i].request.edge_id);
+  }
+  bulk->barrier();
+  for (int i = 0; i < dropped.size(); i++) {
+    strands_navigation_msgs::AddEdge srv;
+    srv.request.edge_id = dropped[i];
+    bulk->add("/topological_map_manager/remove_edge", srv, "remove edge " + dropped[i]);
+  }
+  bulk->barrier();
+  for (std::map<std::string, std::string>::const_iterator it = into.begin(); it != into.end(); ++it) {
+    strands_navigation_msgs::RmvNode srv;
+    srv.request.name = it->first;
+    bulk->add("/topological_map_manager/remove_topological_node", srv,
+	      "remove node " + it->first + " merged into " + it->second);
+  }
+  return clusters.size();
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,72 @@
+#ifndef OVERLAP_VIEW_H
+#define OVERLAP_VIEW_H
+
+#include <vector>
+
+#include <QStringList>
+#include <QWidget>
+
+#include "ros/ros.h"
+#include "strands_navigation_msgs/AddEdge.h"
+#include "strands_navigation_msgs/RmvNode.h"
+#include "strands_navigation_msgs/UpdateEdge.h"
+
+#include "bulk_executor.h"
+#include "overlap_detector.h"
+
+class QTreeWidget;
+
+namespace topological_rviz_tools
+{
+
+/** @brief Lists the clusters of overlapping nodes found by an
+ * OverlapDetector, and merges them.
+ *
+ * Each cluster is a top level row with its nodes as children, the node to
+ * keep first. Merging moves the edges of the other nodes onto the kept one
+ * and removes them. The view only plans the merge: the calls are queued on
+ * the panel's BulkExecutor, so they run in the background like other
+ * changes to many items. */
+class OverlapView: public QWidget
+{
+Q_OBJECT
+public:
+  OverlapView(QWidget* parent = 0);
+
+  /** @brief Set the detector to display. It must outlive the view. */
+  void setDetector(const OverlapDetector* detector);
+
+  int numClusters() const;
+
+  /** @brief Queue the calls which merge each selected cluster into its
+   * first node on @a bulk, with barriers between the calls which depend on
+   * earlier ones. Returns the number of clusters. */
+  int queueMerge(BulkExecutor* bulk) const;
+
+public Q_SLOTS:
+  /** @brief Rebuild the list from the detector. */
+  void refresh();
+
+Q_SIGNALS:
+  /** @brief Emitted when the user asks to select the nodes in @a nodes. */
+  void selectNodes(const QStringList& nodes);
+
+  /** @brief Emitted when the user confirmed merging the selected clusters,
+   * which the receiver does with queueMerge(). */
+  void mergeRequested();
+
+private Q_SLOTS:
+  void onSelectClicked();
+  void onMergeClicked();
+
+private:
+  /** @brief Indices into the detector's clusters of the selected rows. */
+  std::vector<int> selectedClusters() const;
+
+  const OverlapDetector* detector_;
+  QTreeWidget* tree_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // OVERLAP_VIEW_H
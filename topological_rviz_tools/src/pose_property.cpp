@@ -1,10 +1,12 @@
 #include "pose_property.h"
 
+#include <boost/bind.hpp>
+
 namespace topological_rviz_tools
 {
 
 PoseProperty::PoseProperty(const QString& name,
-			   const geometry_msgs::Pose& default_value,
+			   const TopmapSnapshot::PoseConstPtr& default_value,
 			   const QString& description,
 			   rviz::Property* parent,
 			   const char *changed_slot,
@@ -12,21 +14,23 @@ PoseProperty::PoseProperty(const QString& name,
   // We set the default value sent to the base property to the empty string,
   // rather than trying to put in the geometry msgs pose
   : rviz::Property(name, "", description, parent, changed_slot, receiver),
-    pose_(default_value)
+    pose_(default_value),
+    updating_(false),
+    in_flight_(false),
+    dirty_(false)
 {
   connect(this, SIGNAL(poseModified()), parent, SLOT(nodePropertyUpdated()));
   setReadOnly(true); // can't change the name of this pose
 
-  ros::NodeHandle nh;
   // Use addnode because it has the fields we need, so we don't have to write a
   // new message
-  poseUpdate_ = nh.serviceClient<strands_navigation_msgs::AddNode>("/topological_map_manager/update_node_pose", true);
+  poseUpdate_ = ServiceConnection::create<strands_navigation_msgs::AddNode>("/topological_map_manager/update_node_pose");
 
   orientation_ = new rviz::StringProperty("Orientation", "", "", this);
-  orientation_w_ = new rviz::FloatProperty("w", pose_.orientation.w, "",  orientation_);
-  orientation_x_ = new rviz::FloatProperty("x", pose_.orientation.x, "",  orientation_);
-  orientation_y_ = new rviz::FloatProperty("y", pose_.orientation.y, "",  orientation_);
-  orientation_z_ = new rviz::FloatProperty("z", pose_.orientation.z, "",  orientation_);
+  orientation_w_ = new rviz::FloatProperty("w", pose_->orientation.w, "",  orientation_);
+  orientation_x_ = new rviz::FloatProperty("x", pose_->orientation.x, "",  orientation_);
+  orientation_y_ = new rviz::FloatProperty("y", pose_->orientation.y, "",  orientation_);
+  orientation_z_ = new rviz::FloatProperty("z", pose_->orientation.z, "",  orientation_);
   // Don't allow messing around with the quaternion from here - can be done
   // using the interactive marker.
   orientation_->setReadOnly(true);
@@ -36,17 +40,29 @@ PoseProperty::PoseProperty(const QString& name,
   orientation_z_->setReadOnly(true);
 
   position_ = new rviz::StringProperty("Position", "", "", this);
-  position_x_ = new rviz::FloatProperty("x", pose_.position.x, "",  position_, SLOT(positionUpdated()), this);
-  position_y_ = new rviz::FloatProperty("y", pose_.position.y, "",  position_, SLOT(positionUpdated()), this);
-  position_z_ = new rviz::FloatProperty("z", pose_.position.z, "",  position_);
+  position_x_ = new rviz::FloatProperty("x", pose_->position.x, "",  position_, SLOT(positionUpdated()), this);
+  position_y_ = new rviz::FloatProperty("y", pose_->position.y, "",  position_, SLOT(positionUpdated()), this);
+  position_z_ = new rviz::FloatProperty("z", pose_->position.z, "",  position_);
 
   // Don't allow modification of z position of the node
   position_->setReadOnly(true);
   position_z_->setReadOnly(true);
+
+  confirmed_ = pose_->position;
+  send_timer_ = new QTimer(this);
+  send_timer_->setSingleShot(true);
+  send_timer_->setInterval(500);
+  connect(send_timer_, SIGNAL(timeout()), this, SLOT(sendPose()));
+  // the result comes back on the service call thread
+  connect(this, SIGNAL(poseSent(bool)), this, SLOT(onPoseSent(bool)), Qt::QueuedConnection);
 }
 
 PoseProperty::~PoseProperty()
 {
+  // the call thread uses the service client, so wait for it
+  if (call_thread_.joinable()) {
+    call_thread_.join();
+  }
   delete orientation_w_;
   delete orientation_x_;
   delete orientation_y_;
@@ -58,8 +74,59 @@ PoseProperty::~PoseProperty()
   delete position_;
 }
 
+void PoseProperty::updateFromMap(const TopmapSnapshot::PoseConstPtr& pose, bool changed)
+{
+  pose_ = pose;
+  confirmed_ = pose_->position;
+  if (!changed) {
+    return;
+  }
+
+  updating_ = true;
+  orientation_w_->setValue(pose_->orientation.w);
+  orientation_x_->setValue(pose_->orientation.x);
+  orientation_y_->setValue(pose_->orientation.y);
+  orientation_z_->setValue(pose_->orientation.z);
+  position_z_->setValue(pose_->position.z);
+  updating_ = false;
+
+  // an edit which is still on its way would be overwritten with the old value
+  if (!in_flight_ && !dirty_) {
+    showPosition(pose_->position);
+  }
+}
+
+void PoseProperty::clearStatus()
+{
+  position_->setValue("");
+}
+
+void PoseProperty::showPosition(const geometry_msgs::Point& position)
+{
+  updating_ = true;
+  position_x_->setValue(position.x);
+  position_y_->setValue(position.y);
+  updating_ = false;
+}
+
 void PoseProperty::positionUpdated()
 {
+  if (updating_) {
+    return;
+  }
+
+  dirty_ = true;
+  position_->setValue("(not saved)");
+  send_timer_->start();
+}
+
+void PoseProperty::sendPose()
+{
+  // edits made meanwhile go out when the current request returns
+  if (in_flight_ || !dirty_) {
+    return;
+  }
+
   strands_navigation_msgs::AddNode srv;
   srv.request.name = getParent()->getValue().toString().toStdString().c_str();
   srv.request.pose.position.x = position_x_->getFloat();
@@ -69,12 +136,49 @@ void PoseProperty::positionUpdated()
   srv.request.pose.orientation.y = orientation_y_->getFloat();
   srv.request.pose.orientation.z = orientation_z_->getFloat();
   srv.request.pose.orientation.w = orientation_w_->getFloat();
-  
-  if (poseUpdate_.call(srv)) {
-    ROS_INFO("Successfully updated pose for node %s", srv.request.name.c_str());
-    Q_EMIT poseModified();
-  } else {
+
+  sent_ = srv.request.pose.position;
+  dirty_ = false;
+  in_flight_ = true;
+  position_->setValue("(saving)");
+  if (call_thread_.joinable()) {
+    call_thread_.join();
+  }
+  call_thread_ = boost::thread(boost::bind(&PoseProperty::callService, this, srv));
+}
+
+void PoseProperty::callService(strands_navigation_msgs::AddNode srv)
+{
+  bool success = poseUpdate_.call(srv);
+  if (!success) {
+    ROS_WARN("Failed to get response from service to update pose for node %s", srv.request.name.c_str());
+  } else if (!srv.response.success) {
     ROS_WARN("Failed to update pose for node %s", srv.request.name.c_str());
+    success = false;
+  }
+  Q_EMIT poseSent(success);
+}
+
+void PoseProperty::onPoseSent(bool success)
+{
+  in_flight_ = false;
+  call_thread_.join();
+
+  if (success) {
+    ROS_INFO("Successfully updated pose for node %s", getParent()->getValue().toString().toStdString().c_str());
+    confirmed_ = sent_;
+    if (!dirty_) {
+      position_->setValue("");
+    }
+    Q_EMIT poseModified();
+  } else if (!dirty_) {
+    // nothing newer to send, so put back what the map has
+    showPosition(confirmed_);
+    position_->setValue("(update failed, reverted)");
+  }
+
+  if (dirty_ && !send_timer_->isActive()) {
+    sendPose();
   }
 }
 
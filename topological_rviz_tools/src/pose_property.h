@@ -1,12 +1,18 @@
 #ifndef POSE_PROPERTY_H
 #define POSE_PROPERTY_H
 
+#include <boost/thread.hpp>
+
+#include <QTimer>
+
 #include "ros/ros.h"
 #include "strands_navigation_msgs/AddNode.h"
 #include "geometry_msgs/Pose.h"
 #include "rviz/properties/property.h"
 #include "rviz/properties/float_property.h"
 #include "rviz/properties/string_property.h"
+#include "service_connection.h"
+#include "topmap_snapshot.h"
 
 namespace topological_rviz_tools
 {
@@ -16,8 +22,8 @@ class PoseProperty: public rviz::Property
 {
 Q_OBJECT
 public:
- PoseProperty(const QString& name = QString(),
-	      const geometry_msgs::Pose& default_value = geometry_msgs::Pose(),
+ PoseProperty(const QString& name,
+	      const TopmapSnapshot::PoseConstPtr& default_value,
 	      const QString& description = QString(),
 	      rviz::Property* parent = 0,
 	      const char *changed_slot = 0,
@@ -25,14 +31,39 @@ public:
 
   virtual ~PoseProperty();
 
+  /** @brief Point the property at @a pose from a newer map revision. If
+   * @a changed is true, the displayed values are refreshed in place, except
+   * for a position which is still being sent. */
+  void updateFromMap(const TopmapSnapshot::PoseConstPtr& pose, bool changed);
+
+  /** @brief True if no edit is waiting to be sent or on its way. */
+  bool isIdle() const { return !in_flight_ && !dirty_; }
+
+  /** @brief Forget the outcome of the last edit shown next to the position. */
+  void clearStatus();
+
 public Q_SLOTS:
+  /** @brief Keep the edited position on display and send it once editing
+   * stops. Edits of x and y in quick succession go out as one request. */
   void positionUpdated();
 
 Q_SIGNALS:
   void poseModified();
+  /** @brief Emitted from the thread making the service call once it
+   * returns. */
+  void poseSent(bool success);
+
+private Q_SLOTS:
+  void sendPose();
+  /** @brief Keep or roll back the position which was sent, and send any
+   * edits made in the meantime. */
+  void onPoseSent(bool success);
 
 private:
-  const geometry_msgs::Pose& pose_;
+  void callService(strands_navigation_msgs::AddNode srv);
+  void showPosition(const geometry_msgs::Point& position);
+
+  TopmapSnapshot::PoseConstPtr pose_;
   rviz::StringProperty* orientation_;
   rviz::FloatProperty* orientation_w_;
   rviz::FloatProperty* orientation_x_;
@@ -43,7 +74,19 @@ private:
   rviz::FloatProperty* position_y_;
   rviz::FloatProperty* position_z_;
 
-  ros::ServiceClient poseUpdate_;
+  ServiceConnection poseUpdate_;
+  // set while values are written from the map, so we don't send them back
+  bool updating_;
+
+  // waits for editing to stop before sending
+  QTimer* send_timer_;
+  boost::thread call_thread_;
+  bool in_flight_;
+  // edited since the last request was sent
+  bool dirty_;
+  // last position known to be in the map, restored if an update fails
+  geometry_msgs::Point confirmed_;
+  geometry_msgs::Point sent_;
 };
 
 } // end namespace topological_rviz_tools
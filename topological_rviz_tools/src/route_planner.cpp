@@ -0,0 +1,168 @@
+#include "route_planner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace topological_rviz_tools
+{
+
+// the default top_vel of edges made by the map manager
+const double RoutePlanner::DEFAULT_SPEED = 0.55;
+
+RoutePlanner::RoutePlanner()
+  : max_speed_(DEFAULT_SPEED)
+  , start_(-1)
+  , goal_(-1)
+{
+}
+
+bool RoutePlanner::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  bool rebuild = !snapshot_ || !snapshot || delta.from_revision != snapshot_->getRevision()
+    || delta.to_revision != snapshot->getRevision() || !delta.added.empty() || !delta.removed.empty();
+  for (int i = 0; !rebuild && i < delta.modified.size(); i++) {
+    rebuild = delta.modified[i].fields & (TopmapDelta::POSE | TopmapDelta::EDGES);
+  }
+
+  snapshot_ = snapshot;
+  if (rebuild) {
+    build();
+  }
+  return rebuild;
+}
+
+void RoutePlanner::build()
+{
+  offsets_.assign(1, 0);
+  targets_.clear();
+  costs_.clear();
+  xs_.clear();
+  ys_.clear();
+  max_speed_ = DEFAULT_SPEED;
+  start_ = -1;
+  goal_ = -1;
+  if (!snapshot_) {
+    return;
+  }
+
+  int n = snapshot_->numNodes();
+  for (int i = 0; i < n; i++) {
+    const geometry_msgs::Point& pos = snapshot_->nodeAt(i).pose.position;
+    xs_.push_back(pos.x);
+    ys_.push_back(pos.y);
+  }
+
+  for (int i = 0; i < n; i++) {
+    const std::vector<strands_navigation_msgs::Edge>& edges = snapshot_->nodeAt(i).edges;
+    for (int j = 0; j < edges.size(); j++) {
+      int target = snapshot_->findNode(edges[j].node);
+      if (target < 0) {
+	continue;
+      }
+      double speed = edges[j].top_vel > 0 ? edges[j].top_vel : DEFAULT_SPEED;
+      max_speed_ = std::max(max_speed_, speed);
+      targets_.push_back(target);
+      costs_.push_back(std::sqrt(std::pow(xs_[target] - xs_[i], 2) + std::pow(ys_[target] - ys_[i], 2)) / speed);
+    }
+    offsets_.push_back(targets_.size());
+  }
+}
+
+double RoutePlanner::heuristic(int node) const
+{
+  // never more than the real cost, as no edge is faster than max_speed_
+  return std::sqrt(std::pow(xs_[goal_] - xs_[node], 2) + std::pow(ys_[goal_] - ys_[node], 2)) / max_speed_;
+}
+
+void RoutePlanner::startSearch(int start)
+{
+  int n = xs_.size();
+  start_ = start;
+  goal_ = -1;
+  g_.assign(n, std::numeric_limits<double>::infinity());
+  parent_.assign(n, -1);
+  state_.assign(n, UNSEEN);
+  open_.clear();
+
+  g_[start] = 0;
+  state_[start] = OPEN;
+  open_.push_back(HeapEntry(0, start));
+}
+
+void RoutePlanner::setGoal(int goal)
+{
+  if (goal == goal_) {
+    return;
+  }
+  goal_ = goal;
+
+  // Closed nodes have their final cost whatever the goal, as the heuristic is
+  // consistent, so only the open list needs new estimates.
+  std::vector<HeapEntry> open;
+  open.reserve(open_.size());
+  for (int i = 0; i < open_.size(); i++) {
+    int node = open_[i].second;
+    if (state_[node] == OPEN) {
+      open.push_back(HeapEntry(g_[node] + heuristic(node), node));
+      // only keep one entry per node
+      state_[node] = UNSEEN;
+    }
+  }
+  for (int i = 0; i < open.size(); i++) {
+    state_[open[i].second] = OPEN;
+  }
+  open_.swap(open);
+  std::make_heap(open_.begin(), open_.end(), std::greater<HeapEntry>());
+}
+
+bool RoutePlanner::route(int start, int goal, std::vector<int>* nodes, double* cost)
+{
+  if (start < 0 || goal < 0 || start >= xs_.size() || goal >= xs_.size()) {
+    return false;
+  }
+
+  if (start != start_) {
+    startSearch(start);
+  }
+
+  if (state_[goal] != CLOSED) {
+    setGoal(goal);
+    while (!open_.empty() && state_[goal] != CLOSED) {
+      std::pop_heap(open_.begin(), open_.end(), std::greater<HeapEntry>());
+      int node = open_.back().second;
+      open_.pop_back();
+      if (state_[node] == CLOSED) {
+	continue;
+      }
+      state_[node] = CLOSED;
+
+      for (int e = offsets_[node]; e < offsets_[node + 1]; e++) {
+	int target = targets_[e];
+	double g = g_[node] + costs_[e];
+	if (state_[target] == CLOSED || g >= g_[target]) {
+	  continue;
+	}
+	g_[target] = g;
+	parent_[target] = node;
+	state_[target] = OPEN;
+	open_.push_back(HeapEntry(g + heuristic(target), target));
+	std::push_heap(open_.begin(), open_.end(), std::greater<HeapEntry>());
+      }
+    }
+    if (state_[goal] != CLOSED) {
+      return false;
+    }
+  }
+
+  nodes->clear();
+  for (int node = goal; node >= 0; node = parent_[node]) {
+    nodes->push_back(node);
+  }
+  std::reverse(nodes->begin(), nodes->end());
+  *cost = g_[goal];
+  return true;
+}
+
+} // end namespace topological_rviz_tools
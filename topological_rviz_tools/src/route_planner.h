@@ -0,0 +1,80 @@
+#ifndef ROUTE_PLANNER_H
+#define ROUTE_PLANNER_H
+
+#include <utility>
+#include <vector>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Fastest routes between nodes of the map.
+ *
+ * The cost of an edge is the distance between its nodes divided by its
+ * top_vel, so routes are measured in seconds. The adjacency and edge costs
+ * are kept between map revisions and only rebuilt when nodes move or edges
+ * change. Routes are found with A*, using the straight line distance at the
+ * highest speed in the map as heuristic. The search from a start node is
+ * kept after each query: nodes it already settled are answered straight
+ * from it, and otherwise it carries on towards the new goal. Asking for many
+ * goals from the same start, as when hovering over candidates, therefore
+ * costs little more than one search. */
+class RoutePlanner
+{
+public:
+  /** @brief Speed used for edges without a usable top_vel, in m/s. */
+  static const double DEFAULT_SPEED;
+
+  RoutePlanner();
+
+  /** @brief Move to @a snapshot. Returns true if the graph was rebuilt. */
+  bool update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  TopmapSnapshot::ConstPtr getSnapshot() const { return snapshot_; }
+
+  /** @brief Find the fastest route between the nodes at display indices
+   * @a start and @a goal. On success, @a nodes gets the display indices
+   * along the route, from @a start to @a goal, and @a cost its length in
+   * seconds.
+   * @return false if there is no route. */
+  bool route(int start, int goal, std::vector<int>* nodes, double* cost);
+
+private:
+  enum State {
+    UNSEEN = 0,
+    OPEN,
+    CLOSED
+  };
+
+  typedef std::pair<double, int> HeapEntry;
+
+  void build();
+  void startSearch(int start);
+  /** @brief Re-sort the open list for the heuristic towards @a goal. */
+  void setGoal(int goal);
+  double heuristic(int node) const;
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  // compressed adjacency by display index, with the cost of each edge
+  std::vector<int> offsets_;
+  std::vector<int> targets_;
+  std::vector<double> costs_;
+  std::vector<double> xs_;
+  std::vector<double> ys_;
+  double max_speed_;
+
+  // state of the search from start_, reset when the graph changes
+  int start_;
+  int goal_;
+  std::vector<double> g_;
+  std::vector<int> parent_;
+  std::vector<unsigned char> state_;
+  // min-heap on estimated total cost, may hold stale entries for nodes
+  // which have since been closed
+  std::vector<HeapEntry> open_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // ROUTE_PLANNER_H
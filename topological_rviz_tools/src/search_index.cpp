@@ -0,0 +1,307 @@
+#include "search_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+// Drop retired documents once there are at least this many of them and they
+// outnumber the live ones.
+const unsigned int MIN_COMPACT = 1000;
+
+struct SizeLess {
+  bool operator() (const std::vector<unsigned int>* a, const std::vector<unsigned int>* b) const {
+    return a->size() < b->size();
+  }
+};
+
+// Grams are packed into an integer: the top byte says whether it is a one or
+// two character prefix or a trigram from anywhere in the term, so the kinds
+// don't mix, and the characters go in the low bytes.
+enum GramKind { PREFIX1 = 1, PREFIX2 = 2, TRIGRAM = 3 };
+
+unsigned int packGram(GramKind kind, const std::string& text, size_t pos, size_t len)
+{
+  unsigned int gram = kind << 24;
+  for (size_t i = 0; i < len; i++) {
+    gram |= static_cast<unsigned char>(text[pos + i]) << (8 * (2 - i));
+  }
+  return gram;
+}
+
+void addGrams(const std::string& text, std::vector<unsigned int>& grams)
+{
+  if (text.size() >= 1) {
+    grams.push_back(packGram(PREFIX1, text, 0, 1));
+  }
+  if (text.size() >= 2) {
+    grams.push_back(packGram(PREFIX2, text, 0, 2));
+  }
+  for (size_t i = 0; i + 3 <= text.size(); i++) {
+    grams.push_back(packGram(TRIGRAM, text, i, 3));
+  }
+}
+
+} // end anonymous namespace
+
+SearchIndex::SearchIndex()
+  : dead_(0)
+{
+}
+
+std::string SearchIndex::lower(const std::string& text)
+{
+  std::string out(text);
+  std::transform(out.begin(), out.end(), out.begin(), ::tolower);
+  return out;
+}
+
+void SearchIndex::clear()
+{
+  snapshot_.reset();
+  docs_.clear();
+  postings_.clear();
+  live_.clear();
+  dead_ = 0;
+}
+
+void SearchIndex::update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  if (!snapshot_ || delta.from_revision != snapshot_->getRevision() || delta.to_revision != snapshot->getRevision()) {
+    snapshot_ = snapshot;
+    indexAll();
+    return;
+  }
+
+  for (int i = 0; i < delta.removed.size(); i++) {
+    retire(snapshot_->nodeAt(delta.removed[i]).name);
+  }
+  snapshot_ = snapshot;
+  for (int i = 0; i < delta.added.size(); i++) {
+    indexNode(snapshot_->nodeAt(delta.added[i]));
+  }
+  for (int i = 0; i < delta.modified.size(); i++) {
+    // only edges contribute searchable terms besides the name
+    if (delta.modified[i].fields & (TopmapDelta::EDGES | TopmapDelta::NAME)) {
+      indexNode(snapshot_->nodeAt(delta.modified[i].after));
+    }
+  }
+
+  if (dead_ > MIN_COMPACT && dead_ > docs_.size() / 2) {
+    compact();
+  }
+}
+
+void SearchIndex::indexAll()
+{
+  docs_.clear();
+  postings_.clear();
+  live_.clear();
+  dead_ = 0;
+  docs_.reserve(snapshot_->numNodes());
+  for (int i = 0; i < snapshot_->numNodes(); i++) {
+    indexNode(snapshot_->nodeAt(i));
+  }
+}
+
+void SearchIndex::setTags(const std::string& node, const std::vector<std::string>& tags)
+{
+  boost::unordered_map<std::string, std::vector<std::string> >::iterator it = tags_.find(node);
+  if (it == tags_.end() ? tags.empty() : it->second == tags) {
+    return;
+  }
+  if (tags.empty()) {
+    tags_.erase(it);
+  } else {
+    tags_[node] = tags;
+  }
+  if (!snapshot_) {
+    return;
+  }
+  int ind = snapshot_->findNode(node);
+  if (ind >= 0) {
+    indexNode(snapshot_->nodeAt(ind));
+  }
+}
+
+void SearchIndex::indexNode(const strands_navigation_msgs::TopologicalNode& node)
+{
+  std::vector<Term> terms;
+  terms.push_back(Term(lower(node.name), NAME));
+  for (int i = 0; i < node.edges.size(); i++) {
+    terms.push_back(Term(lower(node.edges[i].action), ACTION));
+    terms.push_back(Term(lower(node.edges[i].node), TARGET));
+  }
+  boost::unordered_map<std::string, std::vector<std::string> >::const_iterator tags = tags_.find(node.name);
+  if (tags != tags_.end()) {
+    for (int i = 0; i < tags->second.size(); i++) {
+      terms.push_back(Term(lower(tags->second[i]), TAG));
+    }
+  }
+
+  retire(node.name);
+  addDocument(node.name, terms);
+}
+
+void SearchIndex::addDocument(const std::string& node, const std::vector<Term>& terms)
+{
+  unsigned int id = docs_.size();
+  docs_.push_back(Document());
+  docs_.back().node = node;
+  docs_.back().terms = terms;
+  docs_.back().alive = true;
+  live_[node] = id;
+
+  std::vector<unsigned int> grams;
+  for (int i = 0; i < terms.size(); i++) {
+    addGrams(terms[i].text, grams);
+  }
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+  // IDs only ever grow, so appending keeps every list sorted
+  for (int i = 0; i < grams.size(); i++) {
+    postings_[grams[i]].push_back(id);
+  }
+}
+
+void SearchIndex::retire(const std::string& node)
+{
+  boost::unordered_map<std::string, unsigned int>::iterator it = live_.find(node);
+  if (it == live_.end()) {
+    return;
+  }
+  docs_[it->second].alive = false;
+  live_.erase(it);
+  dead_++;
+}
+
+void SearchIndex::compact()
+{
+  std::vector<Document> old;
+  old.swap(docs_);
+  postings_.clear();
+  live_.clear();
+  dead_ = 0;
+  for (int i = 0; i < old.size(); i++) {
+    if (old[i].alive) {
+      addDocument(old[i].node, old[i].terms);
+    }
+  }
+}
+
+bool SearchIndex::matches(const Document& doc, const std::string& text, unsigned int fields, bool prefix) const
+{
+  for (int i = 0; i < doc.terms.size(); i++) {
+    const Term& term = doc.terms[i];
+    if (!(term.field & fields)) {
+      continue;
+    }
+    if (prefix ? term.text.compare(0, text.size(), text) == 0 : term.text.find(text) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<unsigned int> SearchIndex::findDocuments(const std::string& query) const
+{
+  std::vector<unsigned int> result;
+
+  std::string text = lower(query);
+  size_t first = text.find_first_not_of(" \t");
+  size_t last = text.find_last_not_of(" \t");
+  if (first == std::string::npos) {
+    return result;
+  }
+  text = text.substr(first, last - first + 1);
+
+  unsigned int fields = ANY;
+  static const struct { const char* prefix; Field field; } field_prefixes[] = {
+    {"name:", NAME}, {"tag:", TAG}, {"action:", ACTION}, {"to:", TARGET}
+  };
+  for (int i = 0; i < 4; i++) {
+    std::string prefix(field_prefixes[i].prefix);
+    if (text.compare(0, prefix.size(), prefix) == 0) {
+      fields = field_prefixes[i].field;
+      text = text.substr(prefix.size());
+      break;
+    }
+  }
+  if (text.empty()) {
+    return result;
+  }
+
+  bool prefix = text.size() < 3;
+  std::vector<const std::vector<unsigned int>*> lists;
+  if (prefix) {
+    PostingMap::const_iterator it = postings_.find(packGram(text.size() == 1 ? PREFIX1 : PREFIX2, text, 0, text.size()));
+    if (it == postings_.end()) {
+      return result;
+    }
+    lists.push_back(&it->second);
+  } else {
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+      PostingMap::const_iterator it = postings_.find(packGram(TRIGRAM, text, i, 3));
+      if (it == postings_.end()) {
+	return result;
+      }
+      lists.push_back(&it->second);
+    }
+  }
+
+  // intersect starting from the shortest list
+  std::sort(lists.begin(), lists.end(), SizeLess());
+  std::vector<unsigned int> candidates(*lists[0]);
+  for (int i = 1; i < lists.size() && !candidates.empty(); i++) {
+    std::vector<unsigned int> both;
+    std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+			  std::back_inserter(both));
+    candidates.swap(both);
+  }
+
+  // A single gram searched in every field is an exact match. Otherwise the
+  // grams may all appear without the whole query appearing, or in a field we
+  // are not searching, so check the candidates.
+  bool exact = fields == ANY && lists.size() == 1 && (prefix || text.size() == 3);
+  for (int i = 0; i < candidates.size(); i++) {
+    const Document& doc = docs_[candidates[i]];
+    if (doc.alive && (exact || matches(doc, text, fields, prefix))) {
+      result.push_back(candidates[i]);
+    }
+  }
+  return result;
+}
+
+std::vector<std::string> SearchIndex::find(const std::string& query) const
+{
+  std::vector<unsigned int> found = findDocuments(query);
+  std::vector<std::string> names;
+  names.reserve(found.size());
+  for (int i = 0; i < found.size(); i++) {
+    names.push_back(docs_[found[i]].node);
+  }
+  return names;
+}
+
+std::vector<int> SearchIndex::find(const std::string& query, const TopmapSnapshot& snapshot) const
+{
+  std::vector<unsigned int> found = findDocuments(query);
+  std::vector<int> indices;
+  indices.reserve(found.size());
+  for (int i = 0; i < found.size(); i++) {
+    int ind = snapshot.findNode(docs_[found[i]].node);
+    if (ind >= 0) {
+      indices.push_back(ind);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,100 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Substring index over the names, tags, edge actions and edge
+ * targets of the nodes in the map.
+ *
+ * Every term is broken into its trigrams and its one and two character
+ * prefixes, and each gram maps to a list of documents, one document per
+ * node. Queries of three or more characters intersect the trigram lists and
+ * check the few remaining candidates, shorter queries match term prefixes.
+ * Documents get increasing IDs, so posting lists are sorted by construction
+ * and never need to be searched on update: changing a node retires its old
+ * document and appends a new one. Retired documents are dropped when they
+ * make up most of the index. */
+class SearchIndex
+{
+public:
+  enum Field {
+    NAME = 1,
+    TAG = 2,
+    ACTION = 4,
+    TARGET = 8,
+    ANY = NAME | TAG | ACTION | TARGET
+  };
+
+  SearchIndex();
+
+  /** @brief Bring the index in line with @a snapshot, re-indexing only the
+   * nodes in @a delta. If @a delta does not start from the snapshot indexed
+   * last, everything is indexed again. */
+  void update(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  /** @brief Set the tags of the node called @a node. */
+  void setTags(const std::string& node, const std::vector<std::string>& tags);
+
+  /** @brief Names of the nodes matching @a query, in no particular order.
+   *
+   * Matching is case-insensitive. The query may start with "name:", "tag:",
+   * "action:" or "to:" to only search that field; otherwise all fields are
+   * searched. */
+  std::vector<std::string> find(const std::string& query) const;
+
+  /** @brief Like find(), but return the display indices of the matches in
+   * @a snapshot, sorted. */
+  std::vector<int> find(const std::string& query, const TopmapSnapshot& snapshot) const;
+
+  void clear();
+
+private:
+  struct Term
+  {
+    Term(const std::string& text, Field field) : text(text), field(field) {}
+    std::string text; // lower case
+    Field field;
+  };
+
+  struct Document
+  {
+    std::string node;
+    std::vector<Term> terms;
+    bool alive;
+  };
+
+  typedef boost::unordered_map<unsigned int, std::vector<unsigned int> > PostingMap;
+
+  std::vector<unsigned int> findDocuments(const std::string& query) const;
+  void indexNode(const strands_navigation_msgs::TopologicalNode& node);
+  void indexAll();
+  void addDocument(const std::string& node, const std::vector<Term>& terms);
+  void retire(const std::string& node);
+  void compact();
+  bool matches(const Document& doc, const std::string& text, unsigned int fields, bool prefix) const;
+
+  static std::string lower(const std::string& text);
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  std::vector<Document> docs_;
+  // gram -> IDs of the documents containing it, ascending
+  PostingMap postings_;
+  // node name -> ID of its live document
+  boost::unordered_map<std::string, unsigned int> live_;
+  // tags are not part of the map message, so they are kept separately and
+  // merged in whenever a node is indexed
+  boost::unordered_map<std::string, std::vector<std::string> > tags_;
+  unsigned int dead_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // SEARCH_INDEX_H
@@ -0,0 +1,226 @@
+#include "service_connection.h"
+
+#include <algorithm>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+double default_timeout = 5.0;
+boost::mutex timeout_mutex;
+// seconds after an interactive call during which bulk calls are held back,
+// as edits tend to come in bursts
+const double INTERACTIVE_HOLD = 0.5;
+}
+
+RequestScheduler::RequestScheduler()
+  : interactive_(0)
+  , bulk_(0)
+  , bulk_alone_(1000)
+  , bulk_shared_(1)
+{
+}
+
+RequestScheduler& RequestScheduler::instance()
+{
+  static RequestScheduler scheduler;
+  return scheduler;
+}
+
+void RequestScheduler::setBulkLimits(int alone, int shared)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  bulk_alone_ = std::max(1, alone);
+  bulk_shared_ = std::max(1, std::min(shared, bulk_alone_));
+  released_.notify_all();
+}
+
+void RequestScheduler::acquire(int priority)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (priority == ServiceConnection::INTERACTIVE) {
+    interactive_++;
+    last_interactive_ = ros::WallTime::now();
+    return;
+  }
+
+  // the limit goes up again without anything being released, so check
+  // every now and then
+  while (bulk_ >= bulkLimit()) {
+    released_.timed_wait(lock, boost::posix_time::milliseconds(50));
+  }
+  bulk_++;
+}
+
+void RequestScheduler::release(int priority)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (priority == ServiceConnection::INTERACTIVE) {
+    interactive_--;
+    last_interactive_ = ros::WallTime::now();
+  } else {
+    bulk_--;
+  }
+  released_.notify_all();
+}
+
+int RequestScheduler::bulkLimit() const
+{
+  bool busy = interactive_ > 0 || (ros::WallTime::now() - last_interactive_).toSec() < INTERACTIVE_HOLD;
+  return busy ? bulk_shared_ : bulk_alone_;
+}
+
+const std::string& ServiceConnection::getService() const
+{
+  static const std::string none;
+  return impl_ ? impl_->service : none;
+}
+
+void ServiceConnection::setDefaultTimeout(double seconds)
+{
+  boost::mutex::scoped_lock lock(timeout_mutex);
+  default_timeout = seconds;
+}
+
+double ServiceConnection::getDefaultTimeout()
+{
+  boost::mutex::scoped_lock lock(timeout_mutex);
+  return default_timeout;
+}
+
+const char* ServiceConnection::statusName(Status status)
+{
+  switch (status) {
+  case OK:
+    return "ok";
+  case NO_RESPONSE:
+    return "no response";
+  case TIMED_OUT:
+    return "timed out";
+  default:
+    return "not connected";
+  }
+}
+
+bool ServiceConnection::PendingCall::wait(double timeout)
+{
+  boost::mutex::scoped_lock lock(mutex);
+  boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds(static_cast<long>(timeout * 1e6));
+  while (!done) {
+    if (!finished.timed_wait(lock, deadline)) {
+      return done;
+    }
+  }
+  return true;
+}
+
+void ServiceConnection::PendingCall::finish(bool success)
+{
+  boost::mutex::scoped_lock lock(mutex);
+  ok = success;
+  done = true;
+  finished.notify_all();
+}
+
+ServiceConnection::Impl::~Impl()
+{
+  for (int i = 0; i < calls.size(); i++) {
+    calls[i].first->client.shutdown();
+  }
+  for (int i = 0; i < calls.size(); i++) {
+    calls[i].second->join();
+  }
+}
+
+void ServiceConnection::start(const boost::shared_ptr<PendingCall>& pending) const
+{
+  boost::shared_ptr<boost::thread> thread(new boost::thread(boost::bind(&PendingCall::run, pending)));
+  boost::mutex::scoped_lock lock(impl_->mutex);
+  // join the threads of calls which have returned since
+  for (int i = impl_->calls.size() - 1; i >= 0; i--) {
+    PendingCall& call = *impl_->calls[i].first;
+    boost::mutex::scoped_lock call_lock(call.mutex);
+    if (call.done) {
+      call_lock.unlock();
+      impl_->calls[i].second->join();
+      impl_->calls.erase(impl_->calls.begin() + i);
+    }
+  }
+  impl_->calls.push_back(std::make_pair(pending, thread));
+}
+
+ServiceConnection::Status ServiceConnection::failure() const
+{
+  // a call to a service which isn't there fails straight away
+  return ros::service::exists(impl_->service, false) ? NO_RESPONSE : NOT_CONNECTED;
+}
+
+ros::ServiceClient ServiceConnection::getClient() const
+{
+  boost::mutex::scoped_lock lock(impl_->mutex);
+  return impl_->client;
+}
+
+void ServiceConnection::reconnect() const
+{
+  ros::ServiceClient client = impl_->connect();
+  boost::mutex::scoped_lock lock(impl_->mutex);
+  impl_->client = client;
+}
+
+void ServiceConnection::report(Status status, double latency) const
+{
+  if (status != OK) {
+    ROS_WARN("Call to %s failed: %s", impl_->service.c_str(), statusName(status));
+  }
+  ConnectionHealth::instance().record(impl_->service, status, latency);
+}
+
+ConnectionHealth& ConnectionHealth::instance()
+{
+  static ConnectionHealth health;
+  return health;
+}
+
+void ConnectionHealth::record(const std::string& service, ServiceConnection::Status status, double latency)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  Summary& summary = services_[service];
+  summary.last_call = ros::WallTime::now();
+  summary.available = status == ServiceConnection::OK;
+  if (summary.available) {
+    summary.latency = summary.calls == 0 ? latency : 0.8 * summary.latency + 0.2 * latency;
+  } else {
+    summary.failed_service = service;
+    summary.failed_status = status;
+  }
+  summary.calls++;
+}
+
+ConnectionHealth::Summary ConnectionHealth::getSummary(const std::string& prefix) const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  // The most recent call decides availability, and the latency is the
+  // worst of the services which are answering.
+  Summary result;
+  for (std::map<std::string, Summary>::const_iterator it = services_.lower_bound(prefix);
+       it != services_.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+    const Summary& summary = it->second;
+    if (result.calls == 0 || summary.last_call > result.last_call) {
+      result.available = summary.available;
+      result.last_call = summary.last_call;
+      if (!summary.available) {
+	result.failed_service = summary.failed_service;
+	result.failed_status = summary.failed_status;
+      }
+    }
+    if (summary.available) {
+      result.latency = std::max(result.latency, summary.latency);
+    }
+    result.calls += summary.calls;
+  }
+  return result;
+}
+
+} // end namespace topological_rviz_tools
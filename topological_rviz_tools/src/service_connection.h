@@ -0,0 +1,284 @@
+#ifndef SERVICE_CONNECTION_H
+#define SERVICE_CONNECTION_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "ros/ros.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Shares the requests going out to the services between
+ * interactive and bulk calls.
+ *
+ * Interactive calls never wait. Bulk calls are limited to a number in
+ * flight, which is lowered while interactive calls are being made and for
+ * a moment after, so the server has room to answer them straight away. */
+class RequestScheduler
+{
+public:
+  /** @brief Holds a slot for one call of the given priority for as long as
+   * it exists. */
+  class Slot
+  {
+  public:
+    Slot(int priority) : priority_(priority) { instance().acquire(priority_); }
+    ~Slot() { instance().release(priority_); }
+  private:
+    int priority_;
+  };
+
+  static RequestScheduler& instance();
+
+  /** @brief Allow up to @a alone bulk calls in flight when there are no
+   * interactive calls, and @a shared while there are. */
+  void setBulkLimits(int alone, int shared);
+
+private:
+  RequestScheduler();
+
+  void acquire(int priority);
+  void release(int priority);
+  int bulkLimit() const;
+
+  boost::mutex mutex_;
+  boost::condition_variable released_;
+  int interactive_;
+  int bulk_;
+  int bulk_alone_;
+  int bulk_shared_;
+  ros::WallTime last_interactive_;
+};
+
+/** @brief Persistent service client which gives up on calls after a
+ * deadline and reconnects when the connection is lost.
+ *
+ * ros::ServiceClient::call blocks until the server answers, and a
+ * persistent client stays broken once its server goes away. Here each call
+ * is made on a separate thread and only waited for until the deadline, and
+ * a new connection is made after any failure, so a restarted server is
+ * picked up again. Calls to services which only read may be retried once
+ * over the new connection within the same deadline. Calls which change the
+ * map are never sent twice, since the server may have made the change and
+ * only the answer was lost. The outcome and time of every call is reported
+ * to ConnectionHealth.
+ *
+ * Copies share the same connection, like ros::ServiceClient. Threads of
+ * calls which were given up on are stopped and joined when the last copy
+ * goes, so none of them outlives its owner. */
+class ServiceConnection
+{
+public:
+  enum Status {
+    OK,
+    NO_RESPONSE,
+    TIMED_OUT,
+    // the service is not advertised, so the call was certainly not made
+    NOT_CONNECTED
+  };
+
+  enum Priority {
+    // edits made by hand, which someone is waiting to see
+    INTERACTIVE,
+    // long runs of calls, and anything else which can wait
+    BULK
+  };
+
+  /** @brief Whether a call which got no answer may be sent again. */
+  enum Retry {
+    // the call changes something, and may have been made already
+    NO_RETRY,
+    // the call only reads, so making it twice does no harm
+    RETRY
+  };
+
+  ServiceConnection() {}
+
+  /** @brief Connection to @a service, of type @a Service. */
+  template <class Service>
+  static ServiceConnection create(const std::string& service, Priority priority = INTERACTIVE,
+				  Retry retry = NO_RETRY)
+  {
+    ServiceConnection connection;
+    connection.impl_.reset(new Impl);
+    connection.impl_->service = service;
+    connection.impl_->priority = priority;
+    connection.impl_->retry = retry;
+    connection.impl_->connect = boost::bind(&ServiceConnection::connect<Service>, service);
+    connection.impl_->client = connection.impl_->connect();
+    return connection;
+  }
+
+  /** @brief Call the service with the default deadline. Returns true if
+   * there was a response, in the same way as ros::ServiceClient::call. */
+  template <class Service>
+  bool call(Service& srv)
+  {
+    return call(srv, getDefaultTimeout()) == OK;
+  }
+
+  /** @brief Call the service, giving up after @a timeout seconds. The
+   * response is only written to @a srv if the status is OK. Time spent
+   * waiting for a bulk slot does not count towards the timeout. */
+  template <class Service>
+  Status call(Service& srv, double timeout);
+
+  const std::string& getService() const;
+
+  /** @brief Deadline used by call(srv), five seconds unless changed. */
+  static void setDefaultTimeout(double seconds);
+  static double getDefaultTimeout();
+
+  static const char* statusName(Status status);
+
+private:
+  /** @brief Outcome of a call made on its own thread. Shared with the
+   * thread, so it outlives a call which was given up on. */
+  struct PendingCall
+  {
+    PendingCall(const ros::ServiceClient& client) : client(client), done(false), ok(false) {}
+    virtual ~PendingCall() {}
+    void run() { finish(send()); }
+    virtual bool send() = 0;
+    /** @brief Wait until the call returns or @a timeout seconds passed.
+     * Returns true if it returned. */
+    bool wait(double timeout);
+    void finish(bool success);
+
+    ros::ServiceClient client;
+    boost::mutex mutex;
+    boost::condition_variable finished;
+    bool done;
+    bool ok;
+  };
+
+  template <class Service>
+  struct TypedCall : public PendingCall
+  {
+    TypedCall(const Service& srv, const ros::ServiceClient& client) : PendingCall(client), srv(srv) {}
+    virtual bool send() { return client.call(srv); }
+    Service srv;
+  };
+
+  struct Impl
+  {
+    /** @brief Drop the connections of the calls still going, which makes
+     * them return, and join their threads. */
+    ~Impl();
+
+    std::string service;
+    Priority priority;
+    Retry retry;
+    boost::function<ros::ServiceClient ()> connect;
+    boost::mutex mutex;
+    ros::ServiceClient client;
+    // calls whose threads have not been joined yet
+    std::vector<std::pair<boost::shared_ptr<PendingCall>, boost::shared_ptr<boost::thread> > > calls;
+  };
+
+  template <class Service>
+  static ros::ServiceClient connect(const std::string& service)
+  {
+    ros::NodeHandle nh;
+    return nh.serviceClient<Service>(service, true);
+  }
+
+  ros::ServiceClient getClient() const;
+  /** @brief Make @a pending on a thread of its own. */
+  void start(const boost::shared_ptr<PendingCall>& pending) const;
+  /** @brief Status of a call which got no answer. */
+  Status failure() const;
+  /** @brief Replace the client, after its connection broke or a call on it
+   * was given up on. */
+  void reconnect() const;
+  void report(Status status, double latency) const;
+
+  boost::shared_ptr<Impl> impl_;
+};
+
+template <class Service>
+ServiceConnection::Status ServiceConnection::call(Service& srv, double timeout)
+{
+  if (!impl_) {
+    return NOT_CONNECTED;
+  }
+
+  RequestScheduler::Slot slot(impl_->priority);
+  ros::WallTime begin = ros::WallTime::now();
+  int attempts = impl_->retry == RETRY ? 2 : 1;
+  Status status = NO_RESPONSE;
+  for (int attempt = 0; attempt < attempts && status == NO_RESPONSE; attempt++) {
+    double remaining = timeout - (ros::WallTime::now() - begin).toSec();
+    if (remaining <= 0) {
+      status = TIMED_OUT;
+      break;
+    }
+
+    // A call which is given up on keeps its thread until the server answers
+    // or the connection is dropped. The thread only touches the pending
+    // call, which holds its own copy of the client.
+    boost::shared_ptr<TypedCall<Service> > pending(new TypedCall<Service>(srv, getClient()));
+    start(pending);
+
+    if (!pending->wait(remaining)) {
+      status = TIMED_OUT;
+    } else if (pending->ok) {
+      srv = pending->srv;
+      status = OK;
+    } else {
+      status = failure();
+    }
+    if (status != OK) {
+      reconnect();
+    }
+  }
+
+  report(status, (ros::WallTime::now() - begin).toSec());
+  return status;
+}
+
+/** @brief Availability and response time of the services the plugin uses,
+ * gathered from the calls made through ServiceConnection. */
+class ConnectionHealth
+{
+public:
+  struct Summary
+  {
+    Summary() : calls(0), available(false), latency(0) {}
+    // number of calls seen, availability is unknown if there were none
+    int calls;
+    // whether the most recent call got an answer
+    bool available;
+    // smoothed round trip time of answered calls, in seconds
+    double latency;
+    // service and status of the most recent failure
+    std::string failed_service;
+    ServiceConnection::Status failed_status;
+    ros::WallTime last_call;
+  };
+
+  static ConnectionHealth& instance();
+
+  void record(const std::string& service, ServiceConnection::Status status, double latency);
+
+  /** @brief State of the services whose names start with @a prefix. */
+  Summary getSummary(const std::string& prefix) const;
+
+private:
+  ConnectionHealth() {}
+
+  mutable boost::mutex mutex_;
+  std::map<std::string, Summary> services_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // SERVICE_CONNECTION_H
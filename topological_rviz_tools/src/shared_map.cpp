@@ -0,0 +1,19 @@
+#include "shared_map.h"
+
+namespace topological_rviz_tools
+{
+
+SharedMap& SharedMap::instance()
+{
+  static SharedMap map;
+  return map;
+}
+
+void SharedMap::publish(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  snapshot_ = snapshot;
+  delta_ = delta;
+  Q_EMIT mapChanged();
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,44 @@
+#ifndef SHARED_MAP_H
+#define SHARED_MAP_H
+
+#include <QObject>
+
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief The map snapshot the panel is showing, for tools which need to
+ * look at the map.
+ *
+ * The NodeController publishes every snapshot it shows here, along with the
+ * delta from the one before, so tools can keep incremental indices without
+ * subscribing to the map and copying it themselves. Only used from the GUI
+ * thread. */
+class SharedMap: public QObject
+{
+Q_OBJECT
+public:
+  static SharedMap& instance();
+
+  void publish(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  /** @brief The snapshot shown last, or null if the panel has no map. */
+  TopmapSnapshot::ConstPtr getSnapshot() const { return snapshot_; }
+
+  /** @brief Changes from the snapshot published before the current one. */
+  const TopmapDelta& getLastDelta() const { return delta_; }
+
+Q_SIGNALS:
+  void mapChanged();
+
+private:
+  SharedMap() {}
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  TopmapDelta delta_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // SHARED_MAP_H
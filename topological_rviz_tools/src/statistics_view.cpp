@@ -0,0 +1,93 @@
+#include "statistics_view.h"
+
+#include <set>
+
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+
+namespace topological_rviz_tools
+{
+
+StatisticsView::StatisticsView(QWidget* parent)
+  : QWidget(parent)
+  , statistics_(NULL)
+{
+  tree_ = new QTreeWidget();
+  tree_->setColumnCount(2);
+  tree_->setHeaderLabels(QStringList() << "Statistic" << "Value");
+  tree_->setUniformRowHeights(true);
+
+  QVBoxLayout* main_layout = new QVBoxLayout;
+  main_layout->setContentsMargins(0,0,0,0);
+  main_layout->addWidget(tree_);
+  setLayout(main_layout);
+}
+
+void StatisticsView::setStatistics(const MapStatistics* statistics)
+{
+  statistics_ = statistics;
+  refresh();
+}
+
+QTreeWidgetItem* StatisticsView::addRow(const QString& name, const QString& value)
+{
+  QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << name << value);
+  tree_->addTopLevelItem(item);
+  return item;
+}
+
+void StatisticsView::addHistogram(const QString& name, const MapStatistics::Histogram& histogram,
+				  double bin_width, int last_key)
+{
+  int total = 0;
+  for (MapStatistics::Histogram::const_iterator it = histogram.begin(); it != histogram.end(); ++it) {
+    total += it->second;
+  }
+
+  QTreeWidgetItem* item = addRow(name, "");
+  for (MapStatistics::Histogram::const_iterator it = histogram.begin(); it != histogram.end(); ++it) {
+    QString bin = QString::number(it->first);
+    if (bin_width > 0 && it->first == last_key) {
+      bin = QString("%1 m or more").arg(it->first * bin_width);
+    } else if (bin_width > 0) {
+      bin = QString("%1 to %2 m").arg(it->first * bin_width).arg((it->first + 1) * bin_width);
+    }
+    new QTreeWidgetItem(item, QStringList() << bin
+			<< QString("%1 (%2%)").arg(it->second).arg(100.0 * it->second / total, 0, 'f', 1));
+  }
+}
+
+void StatisticsView::refresh()
+{
+  std::set<QString> expanded;
+  for (int i = 0; i < tree_->topLevelItemCount(); i++) {
+    if (tree_->topLevelItem(i)->isExpanded()) {
+      expanded.insert(tree_->topLevelItem(i)->text(0));
+    }
+  }
+
+  tree_->clear();
+  if (!statistics_) {
+    return;
+  }
+
+  const MapStatistics& stats = *statistics_;
+  int edges = stats.numEdges();
+  addRow("Nodes", QString::number(stats.numNodes()));
+  addRow("Edges", QString::number(edges));
+  addRow("Unidirectional edges", QString("%1 (%2%)").arg(stats.numUnidirectional())
+	 .arg(edges ? 100.0 * stats.numUnidirectional() / edges : 0, 0, 'f', 1));
+  addRow("Edges to missing nodes", QString::number(stats.numDangling()));
+  addRow("Mean edge length", QString("%1 m").arg(stats.meanLength(), 0, 'f', 2));
+  addHistogram("Edges per node", stats.getDegrees());
+  addHistogram("Edge length", stats.getLengths(), MapStatistics::LENGTH_BIN, MapStatistics::NUM_LENGTH_BINS);
+  addHistogram("Tags per node", stats.getTagCounts());
+
+  for (int i = 0; i < tree_->topLevelItemCount(); i++) {
+    QTreeWidgetItem* item = tree_->topLevelItem(i);
+    item->setExpanded(expanded.count(item->text(0)));
+  }
+}
+
+} // end namespace topological_rviz_tools
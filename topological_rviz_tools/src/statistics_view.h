@@ -0,0 +1,44 @@
+#ifndef STATISTICS_VIEW_H
+#define STATISTICS_VIEW_H
+
+#include <QWidget>
+
+#include "map_statistics.h"
+
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace topological_rviz_tools
+{
+
+/** @brief Shows the numbers kept by a MapStatistics, with the histograms as
+ * expandable rows. */
+class StatisticsView: public QWidget
+{
+Q_OBJECT
+public:
+  StatisticsView(QWidget* parent = 0);
+
+  /** @brief Set the statistics to display. They must outlive the view. */
+  void setStatistics(const MapStatistics* statistics);
+
+public Q_SLOTS:
+  /** @brief Rebuild the rows from the statistics, keeping expanded
+   * histograms. */
+  void refresh();
+
+private:
+  QTreeWidgetItem* addRow(const QString& name, const QString& value);
+  /** @brief Add a row for @a histogram with a child per bin. Bins are
+   * labelled with their key, or if @a bin_width is given, with the range of
+   * lengths they cover, the bin at @a last_key covering everything longer. */
+  void addHistogram(const QString& name, const MapStatistics::Histogram& histogram,
+		    double bin_width = 0, int last_key = -1);
+
+  const MapStatistics* statistics_;
+  QTreeWidget* tree_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // STATISTICS_VIEW_H
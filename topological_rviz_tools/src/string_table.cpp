@@ -0,0 +1,28 @@
+#include "string_table.h"
+
+namespace topological_rviz_tools
+{
+
+const QString& StringTable::intern(const std::string& str)
+{
+  boost::unordered_map<std::string, QString>::iterator it = strings_.find(str);
+  if (it == strings_.end()) {
+    it = strings_.insert(std::make_pair(str, QString::fromStdString(str))).first;
+  }
+  return it->second;
+}
+
+void StringTable::prune()
+{
+  boost::unordered_map<std::string, QString>::iterator it = strings_.begin();
+  while (it != strings_.end()) {
+    // detached means this is the only copy left
+    if (it->second.isDetached()) {
+      it = strings_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,40 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include <string>
+
+#include <boost/unordered_map.hpp>
+
+#include <QString>
+
+namespace topological_rviz_tools
+{
+
+/** @brief Keeps one copy of each distinct string displayed for a map.
+ *
+ * Most strings in a map repeat on every node or edge: the map and pointset
+ * names, the localisation topic, actions and tags. QString shares its
+ * characters between copies, so handing out the same QString for equal
+ * strings means each one is stored once, however many properties and model
+ * rows show it. */
+class StringTable
+{
+public:
+  /** @brief The shared copy of @a str, which is added if it is new. The
+   * reference is valid until the next call to prune() or clear(). */
+  const QString& intern(const std::string& str);
+
+  /** @brief Drop the strings which nothing but the table refers to. */
+  void prune();
+
+  void clear() { strings_.clear(); }
+
+  size_t size() const { return strings_.size(); }
+
+private:
+  boost::unordered_map<std::string, QString> strings_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // STRING_TABLE_H
@@ -1,22 +1,54 @@
 #include "tag_controller.h"
 
+#include <set>
+
 namespace topological_rviz_tools
 {
 TagController::TagController(const QString& name,
 			     const std::vector<std::string>& default_values,
+			     StringTable* strings,
 			     const QString& description,
 			     NodeProperty* parent,
 			     const char *changed_slot,
 			     QObject* receiver)
   : rviz::Property(name, "", description, parent, changed_slot, receiver)
+  , strings_(strings)
 {
   for (int i = 0; i < default_values.size(); i++) {
-    TagProperty* newTag = new TagProperty("Tag", QString(QString::fromStdString(default_values[i])), "", QString::fromStdString(parent->getNodeName()));
-    addChild(newTag);
-    connect(newTag, SIGNAL(tagModified()), parent, SLOT(nodePropertyUpdated()));
+    addTag(default_values[i], parent->getNodeName());
   }
 }
 
+void TagController::addTag(const std::string& tag, const std::string& node_name)
+{
+  TagProperty* newTag = new TagProperty("Tag", strings_->intern(tag), "", QString::fromStdString(node_name));
+  addChild(newTag);
+  connect(newTag, SIGNAL(tagModified()), getParent(), SLOT(nodePropertyUpdated()));
+}
+
+void TagController::updateTags(const std::vector<std::string>& tags, const std::string& node_name)
+{
+  std::set<std::string> wanted(tags.begin(), tags.end());
+  std::set<std::string> present;
+  for (int i = numChildren() - 1; i >= 0; i--) {
+    std::string tag = tagAt(i)->getStdString();
+    if (wanted.find(tag) == wanted.end()) {
+      delete takeChildAt(i);
+    } else {
+      tagAt(i)->setNodeName(node_name);
+      present.insert(tag);
+    }
+  }
+
+  for (int i = 0; i < tags.size(); i++) {
+    if (present.insert(tags[i]).second) {
+      addTag(tags[i], node_name);
+    }
+  }
+
+  setHidden(numChildren() == 0);
+}
+
 void TagController::initialize()
 {
 
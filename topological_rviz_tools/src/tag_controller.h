@@ -5,6 +5,7 @@
 #include "rviz/properties/property.h"
 #include "rviz/properties/string_property.h"
 #include "tag_property.h"
+#include "string_table.h"
 #include "node_property.h"
 
 namespace topological_rviz_tools
@@ -17,8 +18,9 @@ class TagController: public rviz::Property
 {
 Q_OBJECT
 public:
-  TagController(const QString& name = QString(),
-		const std::vector<std::string>& default_value = std::vector<std::string>(),
+  TagController(const QString& name,
+		const std::vector<std::string>& default_value,
+		StringTable* strings,
 		const QString& description = QString(),
 		NodeProperty* parent = 0,
 		const char *changed_slot = 0,
@@ -49,12 +51,19 @@ public:
    * Typically this will be set by the factory object which created it. */
   virtual void setClassId( const QString& class_id ) { class_id_ = class_id; }
 
+  /** @brief Make the tag list match @a tags, adding and removing only the
+   * tags which differ. The controller is hidden when there are no tags. */
+  void updateTags(const std::vector<std::string>& tags, const std::string& node_name);
+
 Q_SIGNALS:
   void configChanged();
 
 private:
+  void addTag(const std::string& tag, const std::string& node_name);
+  TagProperty* tagAt(int index) const { return static_cast<TagProperty*>(childAt(index)); }
 
   QString class_id_;
+  StringTable* strings_;
 };
 
 } // end namespace topological_rviz_tools
@@ -0,0 +1,66 @@
+#include "tag_index.h"
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+const std::vector<std::string> no_tags;
+const std::set<std::string> no_nodes;
+
+} // end anonymous namespace
+
+bool TagIndex::setTags(const std::string& node, const std::vector<std::string>& tags)
+{
+  boost::unordered_map<std::string, std::vector<std::string> >::iterator it = node_tags_.find(node);
+  const std::vector<std::string>& old_tags = it == node_tags_.end() ? no_tags : it->second;
+  if (old_tags == tags) {
+    return false;
+  }
+
+  std::set<std::string> wanted(tags.begin(), tags.end());
+  for (int i = 0; i < old_tags.size(); i++) {
+    if (wanted.count(old_tags[i])) {
+      continue;
+    }
+    TagMap::iterator tag = tags_.find(old_tags[i]);
+    if (tag != tags_.end()) {
+      tag->second.erase(node);
+      if (tag->second.empty()) {
+	tags_.erase(tag);
+      }
+    }
+  }
+
+  for (std::set<std::string>::const_iterator tag = wanted.begin(); tag != wanted.end(); ++tag) {
+    tags_[*tag].insert(node);
+  }
+
+  if (tags.empty()) {
+    node_tags_.erase(it);
+  } else {
+    node_tags_[node] = tags;
+  }
+  return true;
+}
+
+const std::vector<std::string>& TagIndex::tagsOf(const std::string& node) const
+{
+  boost::unordered_map<std::string, std::vector<std::string> >::const_iterator it = node_tags_.find(node);
+  return it == node_tags_.end() ? no_tags : it->second;
+}
+
+const std::set<std::string>& TagIndex::nodesWithTag(const std::string& tag) const
+{
+  TagMap::const_iterator it = tags_.find(tag);
+  return it == tags_.end() ? no_nodes : it->second;
+}
+
+void TagIndex::clear()
+{
+  tags_.clear();
+  node_tags_.clear();
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,53 @@
+#ifndef TAG_INDEX_H
+#define TAG_INDEX_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+namespace topological_rviz_tools
+{
+
+// tags of each node, by node name
+typedef boost::unordered_map<std::string, std::vector<std::string> > NodeTags;
+
+/** @brief Inverted index from tags to the nodes which have them.
+ *
+ * Tags are not part of the map message, so the index is filled in by
+ * whoever fetches them, one node at a time. Both directions are kept, so
+ * updating a node only touches the tags it gains or loses. */
+class TagIndex
+{
+public:
+  // tag -> names of the nodes with that tag, in alphabetical order
+  typedef std::map<std::string, std::set<std::string> > TagMap;
+
+  /** @brief Set the tags of the node called @a node, replacing any it had.
+   * An empty list removes the node from the index.
+   * @return true if the tags of the node changed. */
+  bool setTags(const std::string& node, const std::vector<std::string>& tags);
+
+  /** @brief Tags of the node called @a node, empty if it has none. */
+  const std::vector<std::string>& tagsOf(const std::string& node) const;
+
+  /** @brief Names of the nodes tagged with @a tag, empty if there are none. */
+  const std::set<std::string>& nodesWithTag(const std::string& tag) const;
+
+  const TagMap& getTags() const { return tags_; }
+
+  /** @brief Tags of every node which has any. */
+  const NodeTags& getNodeTags() const { return node_tags_; }
+
+  void clear();
+
+private:
+  TagMap tags_;
+  NodeTags node_tags_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // TAG_INDEX_H
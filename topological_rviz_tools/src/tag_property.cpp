@@ -11,13 +11,12 @@ TagProperty::TagProperty(const QString& name,
 			 const char *changed_slot,
 			 QObject* receiver)
   : rviz::StringProperty(name, default_value, description, parent, changed_slot, receiver)
-  , tag_value_(default_value.toStdString())
+  , tag_value_(default_value)
   , reset_value_(false)
   , node_name_(node_name.toStdString())
 {
   connect(this, SIGNAL(changed()), this, SLOT(updateTag()));
-  ros::NodeHandle nh;
-  tagUpdate_ = nh.serviceClient<strands_navigation_msgs::ModifyTag>("/topological_map_manager/modify_node_tags", true);
+  tagUpdate_ = ServiceConnection::create<strands_navigation_msgs::ModifyTag>("/topological_map_manager/modify_node_tags");
 }
 
 void TagProperty::updateTag(){
@@ -27,7 +26,7 @@ void TagProperty::updateTag(){
   }
 
   strands_navigation_msgs::ModifyTag srv;
-  srv.request.tag = tag_value_.c_str();
+  srv.request.tag = tag_value_.toStdString();
   srv.request.new_tag = getString().toStdString().c_str();
   srv.request.node.push_back(node_name_);
   
@@ -35,16 +34,16 @@ void TagProperty::updateTag(){
     if (srv.response.success) {
       ROS_INFO("Successfully updated tag %s to %s", srv.request.tag.c_str(), srv.request.new_tag.c_str());
       Q_EMIT tagModified();
-      tag_value_ = getString().toStdString();
+      tag_value_ = getString();
     } else {
       ROS_INFO("Failed to update tag %s: %s", srv.request.tag.c_str(), srv.response.meta.c_str());
       reset_value_ = true;
-      setValue(QString::fromStdString(tag_value_));
+      setValue(tag_value_);
     }
   } else {
     ROS_WARN("Failed to get response from service to update tag %s", srv.request.tag.c_str());
     reset_value_ = true;
-    setValue(QString::fromStdString(tag_value_));
+    setValue(tag_value_);
   }
 }
 
@@ -5,6 +5,7 @@
 #include "rviz/properties/property.h"
 #include "rviz/properties/string_property.h"
 #include "strands_navigation_msgs/ModifyTag.h"
+#include "service_connection.h"
 
 namespace topological_rviz_tools
 {
@@ -24,6 +25,8 @@ public:
 
   virtual ~TagProperty();
   void addTag(const QString& tag);
+  void setNodeName(const std::string& node_name) { node_name_ = node_name; }
+  const std::string& getNodeName() const { return node_name_; }
 
 public Q_SLOTS:
   void updateTag();
@@ -31,8 +34,8 @@ public Q_SLOTS:
 Q_SIGNALS:
   void tagModified();
 private:
-  ros::ServiceClient tagUpdate_;
-  std::string tag_value_; // keep value so it's not lost if we fail to update
+  ServiceConnection tagUpdate_;
+  QString tag_value_; // keep value so it's not lost if we fail to update
   bool reset_value_;
   std::string node_name_;
 };
@@ -0,0 +1,172 @@
+#include "tag_view.h"
+
+#include <set>
+
+#include <QHBoxLayout>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+
+namespace topological_rviz_tools
+{
+
+TagView::TagView(QWidget* parent)
+  : QWidget(parent)
+  , index_(NULL)
+{
+  tree_ = new QTreeWidget();
+  tree_->setColumnCount(2);
+  tree_->setHeaderLabels(QStringList() << "Tag" << "Nodes");
+  tree_->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  tree_->setUniformRowHeights(true);
+
+  modifyTagSrv_ = ServiceConnection::create<strands_navigation_msgs::ModifyTag>("/topological_map_manager/modify_node_tags");
+
+  QPushButton* select_button = new QPushButton("Select nodes");
+  QPushButton* rename_button = new QPushButton("Rename tag");
+
+  QHBoxLayout* button_layout = new QHBoxLayout;
+  button_layout->addWidget(select_button);
+  button_layout->addWidget(rename_button);
+  button_layout->setContentsMargins(2, 0, 2, 0);
+
+  QVBoxLayout* main_layout = new QVBoxLayout;
+  main_layout->setContentsMargins(0,0,0,0);
+  main_layout->addWidget(tree_);
+  main_layout->addLayout(button_layout);
+  setLayout(main_layout);
+
+  connect(select_button, SIGNAL(clicked()), this, SLOT(onSelectClicked()));
+  connect(rename_button, SIGNAL(clicked()), this, SLOT(onRenameClicked()));
+  connect(tree_, SIGNAL(itemActivated(QTreeWidgetItem*, int)), this, SLOT(onSelectClicked()));
+}
+
+void TagView::setTagIndex(const TagIndex* index)
+{
+  index_ = index;
+  refresh();
+}
+
+void TagView::refresh()
+{
+  std::set<QString> expanded;
+  std::set<QString> selected;
+  for (int i = 0; i < tree_->topLevelItemCount(); i++) {
+    QTreeWidgetItem* item = tree_->topLevelItem(i);
+    if (item->isExpanded()) {
+      expanded.insert(item->text(0));
+    }
+    if (item->isSelected()) {
+      selected.insert(item->text(0));
+    }
+  }
+
+  tree_->clear();
+  if (!index_) {
+    return;
+  }
+
+  const TagIndex::TagMap& tags = index_->getTags();
+  for (TagIndex::TagMap::const_iterator it = tags.begin(); it != tags.end(); ++it) {
+    QString tag = QString::fromStdString(it->first);
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << tag << QString::number(it->second.size()));
+    for (std::set<std::string>::const_iterator node = it->second.begin(); node != it->second.end(); ++node) {
+      new QTreeWidgetItem(item, QStringList() << QString::fromStdString(*node));
+    }
+    // items have to be in the tree before they can be expanded or selected
+    tree_->addTopLevelItem(item);
+    item->setExpanded(expanded.count(tag));
+    item->setSelected(selected.count(tag));
+  }
+}
+
+std::vector<std::string> TagView::selectedTags() const
+{
+  std::set<std::string> tags;
+  QList<QTreeWidgetItem*> items = tree_->selectedItems();
+  for (int i = 0; i < items.size(); i++) {
+    QTreeWidgetItem* tag_item = items[i]->parent() ? items[i]->parent() : items[i];
+    tags.insert(tag_item->text(0).toStdString());
+  }
+  return std::vector<std::string>(tags.begin(), tags.end());
+}
+
+void TagView::getSelection(std::vector<std::pair<std::string, std::string> >* tags) const
+{
+  if (!index_) {
+    return;
+  }
+
+  std::set<std::pair<std::string, std::string> > pairs;
+  QList<QTreeWidgetItem*> items = tree_->selectedItems();
+  for (int i = 0; i < items.size(); i++) {
+    if (items[i]->parent()) {
+      pairs.insert(std::make_pair(items[i]->parent()->text(0).toStdString(), items[i]->text(0).toStdString()));
+      continue;
+    }
+    std::string tag = items[i]->text(0).toStdString();
+    const std::set<std::string>& nodes = index_->nodesWithTag(tag);
+    for (std::set<std::string>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+      pairs.insert(std::make_pair(tag, *node));
+    }
+  }
+  tags->insert(tags->end(), pairs.begin(), pairs.end());
+}
+
+void TagView::onSelectClicked()
+{
+  if (!index_) {
+    return;
+  }
+
+  std::set<std::string> nodes;
+  std::vector<std::string> tags = selectedTags();
+  for (int i = 0; i < tags.size(); i++) {
+    const std::set<std::string>& tagged = index_->nodesWithTag(tags[i]);
+    nodes.insert(tagged.begin(), tagged.end());
+  }
+
+  QStringList names;
+  for (std::set<std::string>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+    names << QString::fromStdString(*it);
+  }
+  Q_EMIT selectNodes(names);
+}
+
+void TagView::onRenameClicked()
+{
+  std::vector<std::string> tags = selectedTags();
+  if (!index_ || tags.size() != 1) {
+    return;
+  }
+
+  QString old_tag = QString::fromStdString(tags[0]);
+  QString new_tag = QInputDialog::getText(this, tr("Rename tag"), tr("New name for \"%1\":").arg(old_tag),
+					  QLineEdit::Normal, old_tag);
+  if (new_tag.isEmpty() || new_tag == old_tag) {
+    return;
+  }
+
+  // a single request renames the tag on all of its nodes
+  const std::set<std::string>& nodes = index_->nodesWithTag(tags[0]);
+  strands_navigation_msgs::ModifyTag srv;
+  srv.request.tag = tags[0];
+  srv.request.new_tag = new_tag.toStdString();
+  srv.request.node.assign(nodes.begin(), nodes.end());
+
+  if (modifyTagSrv_.call(srv)) {
+    if (srv.response.success) {
+      ROS_INFO("Successfully renamed tag %s to %s on %d nodes", srv.request.tag.c_str(), srv.request.new_tag.c_str(), (int)srv.request.node.size());
+      Q_EMIT tagsModified();
+    } else {
+      ROS_INFO("Failed to rename tag %s: %s", srv.request.tag.c_str(), srv.response.meta.c_str());
+    }
+  } else {
+    ROS_WARN("Failed to get response from service to rename tag %s", srv.request.tag.c_str());
+  }
+}
+
+} // end namespace topological_rviz_tools
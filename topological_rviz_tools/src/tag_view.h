@@ -0,0 +1,66 @@
+#ifndef TAG_VIEW_H
+#define TAG_VIEW_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QStringList>
+#include <QWidget>
+
+#include "ros/ros.h"
+#include "strands_navigation_msgs/ModifyTag.h"
+
+#include "service_connection.h"
+#include "tag_index.h"
+
+class QTreeWidget;
+
+namespace topological_rviz_tools
+{
+
+/** @brief Lists every tag in the map with the nodes which have it.
+ *
+ * Tags are the top level rows and their nodes the children. Operations on a
+ * tag apply to all of its nodes at once. */
+class TagView: public QWidget
+{
+Q_OBJECT
+public:
+  TagView(QWidget* parent = 0);
+
+  /** @brief Set the index to display. It must outlive the view. */
+  void setTagIndex(const TagIndex* index);
+
+  /** @brief Collect (tag, node) pairs for the selected rows. A selected tag
+   * stands for all the nodes which have it. */
+  void getSelection(std::vector<std::pair<std::string, std::string> >* tags) const;
+
+public Q_SLOTS:
+  /** @brief Rebuild the list from the index, keeping expanded and selected
+   * tags. */
+  void refresh();
+
+Q_SIGNALS:
+  /** @brief Emitted when the user asks to select the nodes in @a nodes. */
+  void selectNodes(const QStringList& nodes);
+
+  /** @brief Emitted after tags were changed through the map manager. */
+  void tagsModified();
+
+private Q_SLOTS:
+  void onSelectClicked();
+  void onRenameClicked();
+
+private:
+  /** @brief Names of the tags which are selected, or have a selected node. */
+  std::vector<std::string> selectedTags() const;
+
+  const TagIndex* index_;
+  QTreeWidget* tree_;
+  ServiceConnection modifyTagSrv_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // TAG_VIEW_H
@@ -0,0 +1,490 @@
+#include "topmap_item_model.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include <QBrush>
+#include <QColor>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+// If a delta touches more rows than this, a reset is cheaper than announcing
+// every range separately.
+const int MAX_INCREMENTAL_ROWS = 2000;
+}
+
+struct TopmapItemModel::RowBefore {
+  bool operator() (const Row& row, int node) const { return row.node < node; }
+};
+
+TopmapItemModel::TopmapItemModel(QObject* parent)
+  : QAbstractItemModel(parent)
+  , next_id_(1)
+  , filtered_(false)
+  , edge_index_(NULL)
+  , strings_(NULL)
+{
+}
+
+TopmapItemModel::~TopmapItemModel()
+{
+}
+
+QModelIndex TopmapItemModel::index(int row, int column, const QModelIndex& parent) const
+{
+  if (row < 0 || column < 0 || column >= NumColumns) {
+    return QModelIndex();
+  }
+
+  if (!parent.isValid()) {
+    if (row >= rows_.size()) {
+      return QModelIndex();
+    }
+    return createIndex(row, column, quintptr(0));
+  }
+
+  if (isEdge(parent) || parent.row() >= rows_.size() || row >= rows_[parent.row()].edges) {
+    return QModelIndex();
+  }
+  return createIndex(row, column, quintptr(rows_[parent.row()].id));
+}
+
+QModelIndex TopmapItemModel::parent(const QModelIndex& child) const
+{
+  if (!isEdge(child)) {
+    return QModelIndex();
+  }
+
+  boost::unordered_map<quint32, int>::const_iterator it = id_rows_.find(child.internalId());
+  if (it == id_rows_.end()) {
+    return QModelIndex();
+  }
+  return createIndex(it->second, 0, quintptr(0));
+}
+
+int TopmapItemModel::rowCount(const QModelIndex& parent) const
+{
+  if (!parent.isValid()) {
+    return rows_.size();
+  }
+  if (isEdge(parent) || parent.column() != 0) {
+    return 0;
+  }
+  return rows_[parent.row()].edges;
+}
+
+int TopmapItemModel::columnCount(const QModelIndex& parent) const
+{
+  return NumColumns;
+}
+
+int TopmapItemModel::nodeOf(const QModelIndex& index) const
+{
+  if (!index.isValid()) {
+    return -1;
+  }
+  int row = isEdge(index) ? parent(index).row() : index.row();
+  if (row < 0 || row >= rows_.size()) {
+    return -1;
+  }
+  return rows_[row].node;
+}
+
+QModelIndex TopmapItemModel::nodeIndex(int node_index, int column) const
+{
+  if (!filtered_) {
+    // rows and display indices only differ in the middle of an update
+    return index(node_index, column);
+  }
+
+  // filtered rows are still in display order
+  std::vector<Row>::const_iterator it = std::lower_bound(rows_.begin(), rows_.end(), node_index, RowBefore());
+  if (it == rows_.end() || it->node != node_index) {
+    return QModelIndex();
+  }
+  return index(it - rows_.begin(), column);
+}
+
+QModelIndex TopmapItemModel::edgeIndex(const std::string& edge_id, int column) const
+{
+  std::string node;
+  int position;
+  if (!edge_index_ || !snapshot_ || !edge_index_->find(edge_id, &node, &position)) {
+    return QModelIndex();
+  }
+  // edge rows are in the order of the edge list
+  return index(position, column, nodeIndex(snapshot_->findNode(node)));
+}
+
+QVariant TopmapItemModel::data(const QModelIndex& index, int role) const
+{
+  int node_ind = nodeOf(index);
+  if (node_ind < 0) {
+    return QVariant();
+  }
+  const strands_navigation_msgs::TopologicalNode& node = snapshot_->nodeAt(node_ind);
+
+  if (!isEdge(index)) {
+    if (role == NodeNameRole) {
+      return QString::fromStdString(node.name);
+    }
+    bool warn = node_ind < warnings_.size() && !warnings_[node_ind].isEmpty();
+    if (role == Qt::ForegroundRole) {
+      return warn ? QVariant(QBrush(QColor(Qt::red))) : QVariant();
+    }
+    if (role != Qt::DisplayRole && role != Qt::ToolTipRole) {
+      return QVariant();
+    }
+    switch (index.column()) {
+    case NameColumn:
+      if (warn && role == Qt::ToolTipRole) {
+	return QString::fromStdString(node.name) + ": " + warnings_[node_ind];
+      }
+      return QString::fromStdString(node.name);
+    case DetailColumn:
+      return QString("%1, %2").arg(node.pose.position.x, 0, 'f', 2).arg(node.pose.position.y, 0, 'f', 2);
+    case ValueColumn:
+      return int(node.edges.size());
+    }
+    return QVariant();
+  }
+
+  if (index.row() >= node.edges.size()) {
+    return QVariant();
+  }
+  const strands_navigation_msgs::Edge& edge = node.edges[index.row()];
+
+  if (role == NodeNameRole) {
+    return QString::fromStdString(node.name);
+  }
+  if (role == EdgeIdRole) {
+    return QString::fromStdString(edge.edge_id);
+  }
+  if (role == Qt::ToolTipRole) {
+    return QString::fromStdString(edge.edge_id);
+  }
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  switch (index.column()) {
+  case NameColumn:
+    return QString::fromStdString(edge.node);
+  case DetailColumn:
+    return strings_ ? strings_->intern(edge.action) : QString::fromStdString(edge.action);
+  case ValueColumn:
+    return edge.top_vel;
+  }
+  return QVariant();
+}
+
+QVariant TopmapItemModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  switch (section) {
+  case NameColumn:
+    return "Node / Edge to";
+  case DetailColumn:
+    return "Position / Action";
+  case ValueColumn:
+    return "Edges / Top vel";
+  }
+  return QVariant();
+}
+
+void TopmapItemModel::setWarnings(const std::vector<QString>& warnings)
+{
+  std::vector<QString> previous;
+  previous.swap(warnings_);
+  warnings_ = warnings;
+
+  int n = std::max(previous.size(), warnings_.size());
+  for (int i = 0; i < n; i++) {
+    QString before = i < previous.size() ? previous[i] : QString();
+    QString after = i < warnings_.size() ? warnings_[i] : QString();
+    if (before == after) {
+      continue;
+    }
+    QModelIndex first = nodeIndex(i);
+    if (first.isValid()) {
+      Q_EMIT dataChanged(first, nodeIndex(i, NumColumns - 1));
+    }
+  }
+}
+
+Qt::ItemFlags TopmapItemModel::flags(const QModelIndex& index) const
+{
+  if (!index.isValid()) {
+    return Qt::NoItemFlags;
+  }
+  return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+void TopmapItemModel::setSnapshot(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta,
+				  const std::vector<int>* nodes)
+{
+  if (!snapshot_ || !snapshot || delta.from_revision != snapshot_->getRevision()
+      || delta.to_revision != snapshot->getRevision()) {
+    reset(snapshot, nodes);
+    return;
+  }
+
+  std::vector<int> removed_rows;
+  std::vector<int> inserted;
+  if (!filtered_ && !nodes) {
+    // rows are display indices, so the delta says it all
+    removed_rows = delta.removed;
+    inserted = delta.added;
+  } else {
+    diffRows(*snapshot, nodes, &removed_rows, &inserted);
+  }
+  if (removed_rows.size() + inserted.size() + delta.modified.size() > MAX_INCREMENTAL_ROWS) {
+    reset(snapshot, nodes);
+    return;
+  }
+
+  TopmapSnapshot::ConstPtr before = snapshot_;
+  removeNodeRows(removed_rows);
+
+  // The remaining rows are in the same order in the new snapshot, only their
+  // display indices move. Edge counts stay as they were until the modified
+  // rows are announced below.
+  snapshot_ = snapshot;
+  filtered_ = nodes != NULL;
+  if (before != snapshot_) {
+    // copies of a name are paired in order, as the delta pairs them, so
+    // the rows stay in ascending order
+    for (int i = 0; i < rows_.size(); i++) {
+      rows_[i].node = snapshot_->findMatch(*before, rows_[i].node);
+    }
+  }
+
+  insertNodeRows(inserted);
+
+  for (int i = 0; i < delta.modified.size(); i++) {
+    QModelIndex row = nodeIndex(delta.modified[i].after);
+    if (row.isValid()) {
+      updateNodeRow(row.row(), before->nodeAt(delta.modified[i].before), delta.modified[i].fields);
+    }
+  }
+}
+
+void TopmapItemModel::setFilter(const std::vector<int>* nodes)
+{
+  if (!snapshot_) {
+    return;
+  }
+  TopmapDelta unchanged;
+  unchanged.from_revision = unchanged.to_revision = snapshot_->getRevision();
+  setSnapshot(snapshot_, unchanged, nodes);
+}
+
+void TopmapItemModel::diffRows(const TopmapSnapshot& snapshot, const std::vector<int>* nodes,
+			       std::vector<int>* removed_rows, std::vector<int>* inserted) const
+{
+  std::vector<int> all;
+  if (!nodes) {
+    all.resize(snapshot.numNodes());
+    for (int i = 0; i < all.size(); i++) {
+      all[i] = i;
+    }
+    nodes = &all;
+  }
+
+  // display indices in the new snapshot of the rows which stay, ascending
+  std::vector<int> kept;
+  kept.reserve(rows_.size());
+  for (int i = 0; i < rows_.size(); i++) {
+    int ind = snapshot_.get() == &snapshot ? rows_[i].node : snapshot.findMatch(*snapshot_, rows_[i].node);
+    if (ind < 0 || !std::binary_search(nodes->begin(), nodes->end(), ind)) {
+      removed_rows->push_back(i);
+    } else {
+      kept.push_back(ind);
+    }
+  }
+
+  std::set_difference(nodes->begin(), nodes->end(), kept.begin(), kept.end(), std::back_inserter(*inserted));
+}
+
+void TopmapItemModel::reset(const TopmapSnapshot::ConstPtr& snapshot, const std::vector<int>* nodes)
+{
+  beginResetModel();
+  snapshot_ = snapshot;
+  filtered_ = nodes != NULL;
+  rows_.clear();
+  if (snapshot_ && nodes) {
+    rows_.reserve(nodes->size());
+    for (int i = 0; i < nodes->size(); i++) {
+      rows_.push_back(Row((*nodes)[i], next_id_++, snapshot_->nodeAt((*nodes)[i]).edges.size()));
+    }
+  } else if (snapshot_) {
+    rows_.reserve(snapshot_->numNodes());
+    for (int i = 0; i < snapshot_->numNodes(); i++) {
+      rows_.push_back(Row(i, next_id_++, snapshot_->nodeAt(i).edges.size()));
+    }
+  }
+  id_rows_.clear();
+  reindexFrom(0);
+  endResetModel();
+}
+
+void TopmapItemModel::reindexFrom(int row)
+{
+  for (int i = row; i < rows_.size(); i++) {
+    id_rows_[rows_[i].id] = i;
+  }
+}
+
+void TopmapItemModel::removeNodeRows(const std::vector<int>& rows)
+{
+  // rows is sorted, so go through contiguous ranges from the back
+  int end = rows.size() - 1;
+  while (end >= 0) {
+    int start = end;
+    while (start > 0 && rows[start - 1] == rows[start] - 1) {
+      start--;
+    }
+
+    int first = rows[start];
+    int last = rows[end];
+    beginRemoveRows(QModelIndex(), first, last);
+    for (int i = first; i <= last; i++) {
+      id_rows_.erase(rows_[i].id);
+    }
+    rows_.erase(rows_.begin() + first, rows_.begin() + last + 1);
+    reindexFrom(first);
+    endRemoveRows();
+
+    end = start - 1;
+  }
+}
+
+void TopmapItemModel::insertNodeRows(const std::vector<int>& nodes)
+{
+  // Rows are in display order, so each node goes where the first row with a
+  // larger index is. Nodes which go into the same gap are inserted together.
+  int start = 0;
+  while (start < nodes.size()) {
+    int first = std::lower_bound(rows_.begin(), rows_.end(), nodes[start], RowBefore()) - rows_.begin();
+    int end = start;
+    while (end + 1 < nodes.size() && (first == rows_.size() || nodes[end + 1] < rows_[first].node)) {
+      end++;
+    }
+
+    beginInsertRows(QModelIndex(), first, first + end - start);
+    std::vector<Row> inserted;
+    for (int i = start; i <= end; i++) {
+      inserted.push_back(Row(nodes[i], next_id_++, snapshot_->nodeAt(nodes[i]).edges.size()));
+    }
+    rows_.insert(rows_.begin() + first, inserted.begin(), inserted.end());
+    reindexFrom(first);
+    endInsertRows();
+
+    start = end + 1;
+  }
+}
+
+void TopmapItemModel::updateNodeRow(int row, const strands_navigation_msgs::TopologicalNode& before, unsigned int fields)
+{
+  Q_EMIT dataChanged(index(row, 0), index(row, NumColumns - 1));
+  if (!(fields & TopmapDelta::EDGES) || patchEdgeRows(row, before)) {
+    return;
+  }
+
+  // The edges were reordered, so keep the rows both revisions have and only
+  // add or drop rows at the end.
+  QModelIndex parent = index(row, 0);
+  int old_count = rows_[row].edges;
+  int new_count = snapshot_->nodeAt(rows_[row].node).edges.size();
+  if (new_count < old_count) {
+    beginRemoveRows(parent, new_count, old_count - 1);
+    rows_[row].edges = new_count;
+    endRemoveRows();
+  } else if (new_count > old_count) {
+    beginInsertRows(parent, old_count, new_count - 1);
+    rows_[row].edges = new_count;
+    endInsertRows();
+  }
+
+  int common = std::min(old_count, new_count);
+  if (common > 0) {
+    Q_EMIT dataChanged(index(0, 0, parent), index(common - 1, NumColumns - 1, parent));
+  }
+}
+
+bool TopmapItemModel::patchEdgeRows(int row, const strands_navigation_msgs::TopologicalNode& before)
+{
+  const std::vector<strands_navigation_msgs::Edge>& old_edges = before.edges;
+  const std::vector<strands_navigation_msgs::Edge>& new_edges = snapshot_->nodeAt(rows_[row].node).edges;
+  if (rows_[row].edges != old_edges.size()) {
+    return false;
+  }
+
+  boost::unordered_map<std::string, int> new_pos;
+  for (int i = 0; i < new_edges.size(); i++) {
+    new_pos[new_edges[i].edge_id] = i;
+  }
+  if (new_pos.size() != new_edges.size()) {
+    return false; // duplicate IDs, can't tell the edges apart
+  }
+
+  // Rows can only be inserted and removed, not moved, so the edges both
+  // revisions have must be in the same order.
+  std::vector<int> removed;
+  boost::unordered_map<std::string, int> old_pos;
+  int last = -1;
+  for (int i = 0; i < old_edges.size(); i++) {
+    old_pos[old_edges[i].edge_id] = i;
+    boost::unordered_map<std::string, int>::const_iterator it = new_pos.find(old_edges[i].edge_id);
+    if (it == new_pos.end()) {
+      removed.push_back(i);
+    } else if (it->second < last) {
+      return false;
+    } else {
+      last = it->second;
+    }
+  }
+  if (old_pos.size() != old_edges.size()) {
+    return false;
+  }
+
+  QModelIndex parent = index(row, 0);
+  for (int end = removed.size() - 1; end >= 0;) {
+    int start = end;
+    while (start > 0 && removed[start - 1] == removed[start] - 1) {
+      start--;
+    }
+    beginRemoveRows(parent, removed[start], removed[end]);
+    rows_[row].edges -= end - start + 1;
+    endRemoveRows();
+    end = start - 1;
+  }
+
+  // everything before a new edge is in place by the time it is inserted
+  for (int start = 0; start < new_edges.size();) {
+    if (old_pos.count(new_edges[start].edge_id)) {
+      start++;
+      continue;
+    }
+    int end = start;
+    while (end + 1 < new_edges.size() && !old_pos.count(new_edges[end + 1].edge_id)) {
+      end++;
+    }
+    beginInsertRows(parent, start, end);
+    rows_[row].edges += end - start + 1;
+    endInsertRows();
+    start = end + 1;
+  }
+
+  if (!new_edges.empty()) {
+    Q_EMIT dataChanged(index(0, 0, parent), index(new_edges.size() - 1, NumColumns - 1, parent));
+  }
+  return true;
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,144 @@
+#ifndef TOPMAP_ITEM_MODEL_H
+#define TOPMAP_ITEM_MODEL_H
+
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include <QAbstractItemModel>
+
+#include "edge_index.h"
+#include "string_table.h"
+#include "topmap_snapshot.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Item model which shows the nodes of a TopmapSnapshot and their edges.
+ *
+ * Unlike rviz::PropertyTreeModel there is no object behind each row: data()
+ * reads straight from the snapshot, and a row only costs a couple of
+ * integers. Nodes are the top level rows, in the display order of the
+ * snapshot, and their edges are the children. Updates are applied from a
+ * TopmapDelta, so views only see insertions, removals and dataChanged for the
+ * nodes which actually changed, and edge rows are matched by edge_id. This
+ * also holds while only part of the map is shown, and when changing which
+ * part. */
+class TopmapItemModel: public QAbstractItemModel
+{
+Q_OBJECT
+public:
+  enum Column {
+    NameColumn = 0, // node name, or target node of an edge
+    DetailColumn,   // node position, or edge action
+    ValueColumn,    // number of edges of a node, or top speed of an edge
+    NumColumns
+  };
+
+  enum Role {
+    // name of the node a row belongs to
+    NodeNameRole = Qt::UserRole,
+    // edge_id of an edge row, empty for node rows
+    EdgeIdRole
+  };
+
+  TopmapItemModel(QObject* parent = 0);
+  virtual ~TopmapItemModel();
+
+  virtual QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const;
+  virtual QModelIndex parent(const QModelIndex& child) const;
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+  virtual Qt::ItemFlags flags(const QModelIndex& index) const;
+
+  TopmapSnapshot::ConstPtr getSnapshot() const { return snapshot_; }
+
+  /** @brief Move to @a snapshot. If @a nodes is given, only show the nodes
+   * at those display indices, which must be sorted.
+   *
+   * If @a delta goes from the snapshot currently shown to @a snapshot, only
+   * the rows which change are touched, otherwise the model is reset. */
+  void setSnapshot(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta,
+		   const std::vector<int>* nodes = NULL);
+
+  /** @brief Only show the nodes at the sorted display indices in @a nodes
+   * of the current snapshot, or all of them if @a nodes is null. */
+  void setFilter(const std::vector<int>* nodes);
+
+  bool isFiltered() const { return filtered_; }
+
+  /** @brief Index of the node row for the node at @a node_index in the
+   * display order of the current snapshot. Invalid if the node is filtered
+   * out. */
+  QModelIndex nodeIndex(int node_index, int column = 0) const;
+
+  /** @brief Look edge rows up in @a index, which must be kept in step with
+   * the snapshots given to the model. */
+  void setEdgeIndex(const EdgeIndex* index) { edge_index_ = index; }
+
+  /** @brief Take the strings which repeat across the map from @a strings
+   * rather than converting them for every row. */
+  void setStringTable(StringTable* strings) { strings_ = strings; }
+
+  /** @brief Index of the row of the edge @a edge_id. Invalid if there is no
+   * such edge, no edge index was set, or its node is filtered out. */
+  QModelIndex edgeIndex(const std::string& edge_id, int column = 0) const;
+
+  /** @brief True if @a index is an edge row. */
+  bool isEdge(const QModelIndex& index) const { return index.isValid() && index.internalId() != 0; }
+
+  /** @brief Display index in the current snapshot of the node @a index
+   * belongs to, or -1. */
+  int nodeOf(const QModelIndex& index) const;
+
+  /** @brief Highlight the nodes with a non-empty entry in @a warnings, which
+   * is indexed by display index in the current snapshot, and show the entry
+   * in their tooltip. Only rows whose warning changes are announced. */
+  void setWarnings(const std::vector<QString>& warnings);
+
+private:
+  struct RowBefore;
+  struct Row
+  {
+    Row(int node, quint32 id, int edges) : node(node), id(id), edges(edges) {}
+    // display index of the node in snapshot_
+    int node;
+    // Stable ID of the node. Edge rows use the ID of their parent as internal
+    // ID, so persistent indices of edges stay valid when node rows above
+    // them are inserted or removed. Node rows have internal ID 0.
+    quint32 id;
+    // number of edge rows currently announced to the views
+    int edges;
+  };
+
+  void reset(const TopmapSnapshot::ConstPtr& snapshot, const std::vector<int>* nodes = NULL);
+  /** @brief Work out which rows to remove and which display indices of
+   * @a snapshot to insert to go from the current rows to @a nodes, or to all
+   * nodes if it is null. */
+  void diffRows(const TopmapSnapshot& snapshot, const std::vector<int>* nodes,
+		std::vector<int>* removed_rows, std::vector<int>* inserted) const;
+  void removeNodeRows(const std::vector<int>& rows);
+  void insertNodeRows(const std::vector<int>& nodes);
+  void updateNodeRow(int row, const strands_navigation_msgs::TopologicalNode& before, unsigned int fields);
+  /** @brief Announce the edges of @a row going from @a before to the
+   * current ones by edge_id. Returns false if the edges were reordered, in
+   * which case nothing was done. */
+  bool patchEdgeRows(int row, const strands_navigation_msgs::TopologicalNode& before);
+  void reindexFrom(int row);
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  std::vector<Row> rows_;
+  boost::unordered_map<quint32, int> id_rows_;
+  quint32 next_id_;
+  bool filtered_;
+  const EdgeIndex* edge_index_;
+  StringTable* strings_;
+  // by display index, empty if there is nothing wrong with the node
+  std::vector<QString> warnings_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // TOPMAP_ITEM_MODEL_H
@@ -1,24 +1,82 @@
 #include "topmap_manager.h"
 
+#include <boost/bind.hpp>
+
+#include <QTimer>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <visualization_msgs/MarkerArray.h>
+
 namespace topological_rviz_tools
 {
+
+namespace
+{
+
+// maps at least this large are analysed off the GUI thread, below it the
+// analyses take a few milliseconds at most
+const int BACKGROUND_ANALYSIS_NODES = 2000;
+
+// whether @a delta moves a node or an edge, which is all the connectivity and
+// the overlaps depend on
+bool movesNodes(const TopmapDelta& delta)
+{
+  if (!delta.added.empty() || !delta.removed.empty()) {
+    return true;
+  }
+  for (int i = 0; i < delta.modified.size(); i++) {
+    if (delta.modified[i].fields & (TopmapDelta::POSE | TopmapDelta::TOLERANCE | TopmapDelta::EDGES)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
 TopmapManager::TopmapManager(rviz::DisplayContext* context)
   : context_(context)
   , root_property_(new NodeController)
   , property_model_(new rviz::PropertyTreeModel(root_property_))
+  , item_model_(new TopmapItemModel)
+  , table_model_(new TopmapTableModel)
+  , diff_before_live_(false)
+  , diff_after_live_(false)
+  , connectivity_unshown_(false)
+  , overlaps_unshown_(false)
   , factory_(new rviz::PluginlibFactory<NodeController>("topological_rviz_tools", "topological_rviz_tools::NodeController"))
   , current_(NULL)
   , render_panel_(NULL)
 {
   ROS_INFO("Initialising node manager");
   property_model_->setDragDropClass("node-controller");
+  item_model_->setEdgeIndex(&root_property_->getEdgeIndex());
+  item_model_->setStringTable(&root_property_->getStrings());
+  table_model_->setStringTable(&root_property_->getStrings());
+  connect(root_property_, SIGNAL(mapUpdated()), this, SLOT(onMapUpdated()));
+  connect(this, SIGNAL(analysisDone(bool, bool)), this, SLOT(onAnalysisDone(bool, bool)), Qt::QueuedConnection);
+  ros::NodeHandle nh;
+  connectivity_pub_ = nh.advertise<visualization_msgs::MarkerArray>("topological_map_connectivity", 1, true);
+  overlap_pub_ = nh.advertise<visualization_msgs::MarkerArray>("topological_map_overlaps", 1, true);
+  diff_pub_ = nh.advertise<visualization_msgs::MarkerArray>("topological_map_diff", 1, true);
+  diagnostics_pub_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+
+  // diagnostics are expected regularly, not just when something changes
+  QTimer* diagnostics_timer = new QTimer(this);
+  connect(diagnostics_timer, SIGNAL(timeout()), this, SLOT(publishStatistics()));
+  diagnostics_timer->start(1000);
   // connect(property_model_, SIGNAL(configChanged()), this, SIGNAL(configChanged()));
   // add(new NodeController, -1);
 }
 
 TopmapManager::~TopmapManager()
 {
+  if (analysis_thread_.joinable()) {
+    analysis_thread_.join();
+  }
   delete property_model_;
+  delete item_model_;
+  delete table_model_;
   delete factory_;
   delete root_property_;
 }
@@ -44,6 +102,439 @@ NodeController* TopmapManager::create(const QString& class_id)
   // return view;
 }
 
+void TopmapManager::onMapUpdated()
+{
+  TopmapSnapshot::ConstPtr snapshot = root_property_->getSnapshot();
+  search_index_.update(snapshot, root_property_->getLastDelta());
+  const NodeController::TagChanges& tags = root_property_->getLastTagChanges();
+  statistics_.update(snapshot, root_property_->getLastDelta());
+  for (int i = 0; i < tags.size(); i++) {
+    search_index_.setTags(tags[i].first, tags[i].second);
+    statistics_.setTags(tags[i].first, tags[i].second.size());
+  }
+
+  table_model_->setSnapshot(snapshot, root_property_->getLastDelta());
+  if (filter_.empty()) {
+    item_model_->setSnapshot(snapshot, root_property_->getLastDelta());
+  } else {
+    std::vector<int> matches = search_index_.find(filter_, *snapshot);
+    item_model_->setSnapshot(snapshot, root_property_->getLastDelta(), &matches);
+  }
+
+  validator_.update(snapshot, root_property_->getLastDelta());
+
+  if (!snapshot) {
+    return;
+  }
+  publishStatistics();
+
+  analyse(snapshot, root_property_->getLastDelta());
+
+  if (diff_.isActive() && (diff_before_live_ || diff_after_live_)) {
+    ros::WallTime start = ros::WallTime::now();
+    if (diff_before_live_) {
+      // the fingerprints are of the first map, so it all has to be redone
+      diff_.compare(getLiveSource(), diff_after_live_ ? getLiveSource() : diff_.getAfter());
+    } else {
+      diff_.update(snapshot, root_property_->getLastDelta(), tags);
+    }
+    ROS_INFO("Map differences updated in %.1fms", (ros::WallTime::now() - start).toSec() * 1000);
+    showDiff();
+  }
+}
+
+void TopmapManager::analyse(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  if (analysis_thread_.joinable()) {
+    // onAnalysisDone() catches up with the map once the thread is done
+    return;
+  }
+
+  if (analysed_ && delta.from_revision == analysed_->getRevision() && !movesNodes(delta)) {
+    // neither analysis looks at anything which changed, so this only moves
+    // them on to the new snapshot
+    connectivity_.update(snapshot, delta);
+    overlaps_.update(snapshot, delta);
+    analysed_ = snapshot;
+    return;
+  }
+
+  if (snapshot->numNodes() >= BACKGROUND_ANALYSIS_NODES) {
+    next_connectivity_ = connectivity_;
+    next_overlaps_ = overlaps_;
+    analysing_ = snapshot;
+    analysing_delta_ = delta;
+    analysis_thread_ = boost::thread(boost::bind(&TopmapManager::runAnalysis, this));
+    return;
+  }
+
+  ros::WallTime start = ros::WallTime::now();
+  bool connectivity = connectivity_.update(snapshot, delta);
+  if (connectivity) {
+    ROS_INFO("Connectivity of %d nodes analysed in %.1fms: %d components, %d nodes not connected to the rest",
+	     int(snapshot->numNodes()), (ros::WallTime::now() - start).toSec() * 1000,
+	     connectivity_.numComponents(), int(connectivity_.problemNodes().size()));
+  }
+
+  start = ros::WallTime::now();
+  bool overlaps = overlaps_.update(snapshot, delta);
+  if (overlaps) {
+    ROS_INFO("Overlapping nodes searched in %.1fms: %d clusters",
+	     (ros::WallTime::now() - start).toSec() * 1000, int(overlaps_.getClusters().size()));
+  }
+  analysed_ = snapshot;
+  showAnalysis(*snapshot, connectivity, overlaps);
+}
+
+void TopmapManager::runAnalysis()
+{
+  ros::WallTime start = ros::WallTime::now();
+  bool connectivity = next_connectivity_.update(analysing_, analysing_delta_);
+  bool overlaps = next_overlaps_.update(analysing_, analysing_delta_);
+  ROS_INFO("Connectivity and overlaps of %d nodes analysed in the background in %.1fms",
+	   int(analysing_->numNodes()), (ros::WallTime::now() - start).toSec() * 1000);
+  Q_EMIT analysisDone(connectivity, overlaps);
+}
+
+void TopmapManager::onAnalysisDone(bool connectivity, bool overlaps)
+{
+  analysis_thread_.join();
+  // assigned rather than swapped, the views keep pointers to the analyses
+  connectivity_ = next_connectivity_;
+  overlaps_ = next_overlaps_;
+  analysed_ = analysing_;
+  analysing_.reset();
+
+  TopmapSnapshot::ConstPtr snapshot = root_property_->getSnapshot();
+  if (snapshot == analysed_) {
+    showAnalysis(*snapshot, connectivity, overlaps);
+  } else {
+    // the warnings are shown by the rows of the current map, so the results
+    // wait until they have caught up with it
+    connectivity_unshown_ |= connectivity;
+    overlaps_unshown_ |= overlaps;
+    if (snapshot) {
+      analyse(snapshot, TopmapSnapshot::diff(analysed_.get(), *snapshot));
+    }
+  }
+}
+
+void TopmapManager::showAnalysis(const TopmapSnapshot& snapshot, bool connectivity, bool overlaps)
+{
+  connectivity |= connectivity_unshown_;
+  overlaps |= overlaps_unshown_;
+  connectivity_unshown_ = false;
+  overlaps_unshown_ = false;
+  if (connectivity) {
+    showConnectivity(snapshot);
+  }
+  if (overlaps) {
+    showOverlaps(snapshot);
+  }
+  if (connectivity || overlaps) {
+    updateWarnings(snapshot);
+    Q_EMIT analysisUpdated();
+  }
+}
+
+MapDiff::Source TopmapManager::getLiveSource() const
+{
+  MapDiff::Source live;
+  live.snapshot = root_property_->getSnapshot();
+  live.tags = root_property_->getTagIndex().getNodeTags();
+  live.has_tags = true;
+  live.label = "Live map";
+  return live;
+}
+
+void TopmapManager::setDiff(const MapDiff::Source& before, const MapDiff::Source& after)
+{
+  diff_before_live_ = !before.snapshot;
+  diff_after_live_ = !after.snapshot;
+  if ((diff_before_live_ || diff_after_live_) && !root_property_->getSnapshot()) {
+    ROS_WARN("No map received yet to compare");
+    clearDiff();
+    return;
+  }
+
+  ros::WallTime start = ros::WallTime::now();
+  diff_.compare(diff_before_live_ ? getLiveSource() : before, diff_after_live_ ? getLiveSource() : after);
+  MapDiff::Summary summary = diff_.getSummary();
+  ROS_INFO("Compared %s with %s in %.1fms: %d nodes added, %d removed, %d changed",
+	   diff_.getBefore().label.c_str(), diff_.getAfter().label.c_str(),
+	   (ros::WallTime::now() - start).toSec() * 1000, summary.nodes[MapDiff::ADDED],
+	   summary.nodes[MapDiff::REMOVED], summary.nodes[MapDiff::MODIFIED]);
+  showDiff();
+}
+
+void TopmapManager::clearDiff()
+{
+  diff_.clear();
+  diff_before_live_ = false;
+  diff_after_live_ = false;
+  showDiff();
+}
+
+void TopmapManager::publishStatistics()
+{
+  if (!root_property_->getSnapshot()) {
+    return;
+  }
+
+  diagnostic_msgs::DiagnosticStatus status;
+  status.name = "topological_map: Statistics";
+  status.hardware_id = "topological_map";
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = "OK";
+  if (statistics_.numDangling() > 0) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "Edges lead to missing nodes";
+  }
+
+  std::vector<std::pair<QString, QString> > values;
+  values.push_back(std::make_pair("Nodes", QString::number(statistics_.numNodes())));
+  values.push_back(std::make_pair("Edges", QString::number(statistics_.numEdges())));
+  values.push_back(std::make_pair("Unidirectional edges", QString::number(statistics_.numUnidirectional())));
+  values.push_back(std::make_pair("Edges to missing nodes", QString::number(statistics_.numDangling())));
+  values.push_back(std::make_pair("Mean edge length", QString::number(statistics_.meanLength(), 'f', 3)));
+
+  const MapStatistics::Histogram& degrees = statistics_.getDegrees();
+  for (MapStatistics::Histogram::const_iterator it = degrees.begin(); it != degrees.end(); ++it) {
+    values.push_back(std::make_pair(QString("Nodes with %1 edges").arg(it->first), QString::number(it->second)));
+  }
+  const MapStatistics::Histogram& lengths = statistics_.getLengths();
+  for (MapStatistics::Histogram::const_iterator it = lengths.begin(); it != lengths.end(); ++it) {
+    QString bin = it->first == MapStatistics::NUM_LENGTH_BINS
+      ? QString("Edges of %1 m or more").arg(it->first * MapStatistics::LENGTH_BIN)
+      : QString("Edges of %1 to %2 m").arg(it->first * MapStatistics::LENGTH_BIN).arg((it->first + 1) * MapStatistics::LENGTH_BIN);
+    values.push_back(std::make_pair(bin, QString::number(it->second)));
+  }
+  MapStatistics::Histogram tags = statistics_.getTagCounts();
+  for (MapStatistics::Histogram::const_iterator it = tags.begin(); it != tags.end(); ++it) {
+    values.push_back(std::make_pair(QString("Nodes with %1 tags").arg(it->first), QString::number(it->second)));
+  }
+
+  for (int i = 0; i < values.size(); i++) {
+    diagnostic_msgs::KeyValue value;
+    value.key = values[i].first.toStdString();
+    value.value = values[i].second.toStdString();
+    status.values.push_back(value);
+  }
+
+  diagnostic_msgs::DiagnosticArray msg;
+  msg.header.stamp = ros::Time::now();
+  msg.status.push_back(status);
+  diagnostics_pub_.publish(msg);
+}
+
+void TopmapManager::updateWarnings(const TopmapSnapshot& snapshot)
+{
+  std::vector<QString> warnings(snapshot.numNodes());
+  const std::vector<int>& problems = connectivity_.problemNodes();
+  for (int i = 0; i < problems.size(); i++) {
+    unsigned int flags = connectivity_.flags(problems[i]);
+    if (flags & ConnectivityAnalysis::UNREACHABLE) {
+      warnings[problems[i]] = "can't be reached from the rest of the map";
+    }
+    if (flags & ConnectivityAnalysis::DEAD_END) {
+      warnings[problems[i]] += QString(warnings[problems[i]].isEmpty() ? "" : ", and ")
+	+ "the rest of the map can't be reached from it";
+    }
+  }
+
+  const std::vector<OverlapDetector::Cluster>& clusters = overlaps_.getClusters();
+  for (int i = 0; i < clusters.size(); i++) {
+    QString kept = QString::fromStdString(snapshot.nodeAt(clusters[i].nodes[0]).name);
+    for (int j = 1; j < clusters[i].nodes.size(); j++) {
+      QString& warning = warnings[clusters[i].nodes[j]];
+      warning += QString(warning.isEmpty() ? "" : ", and ") + "overlaps " + kept;
+    }
+  }
+  item_model_->setWarnings(warnings);
+}
+
+void TopmapManager::showConnectivity(const TopmapSnapshot& snapshot)
+{
+  const std::vector<int>& problems = connectivity_.problemNodes();
+
+  visualization_msgs::Marker unreachable;
+  unreachable.header.frame_id = "map";
+  unreachable.header.stamp = ros::Time::now();
+  unreachable.ns = "unreachable";
+  unreachable.id = 0;
+  unreachable.type = visualization_msgs::Marker::SPHERE_LIST;
+  unreachable.pose.orientation.w = 1.0;
+  unreachable.scale.x = unreachable.scale.y = unreachable.scale.z = 0.6;
+  unreachable.color.a = 0.8;
+  unreachable.color.r = 1.0;
+
+  visualization_msgs::Marker dead_end = unreachable;
+  dead_end.ns = "dead_end";
+  dead_end.color.g = 0.6;
+
+  for (int i = 0; i < problems.size(); i++) {
+    int node = problems[i];
+    unsigned int flags = connectivity_.flags(node);
+    geometry_msgs::Point point = snapshot.nodeAt(node).pose.position;
+    // the unreachable sphere is drawn a little higher so both show
+    if (flags & ConnectivityAnalysis::UNREACHABLE) {
+      point.z += 0.2;
+      unreachable.points.push_back(point);
+      point.z -= 0.2;
+    }
+    if (flags & ConnectivityAnalysis::DEAD_END) {
+      dead_end.points.push_back(point);
+    }
+  }
+
+  visualization_msgs::MarkerArray markers;
+  markers.markers.push_back(unreachable);
+  markers.markers.push_back(dead_end);
+  for (int i = 0; i < markers.markers.size(); i++) {
+    // rviz complains about empty lists, so remove the marker instead
+    if (markers.markers[i].points.empty()) {
+      markers.markers[i].action = visualization_msgs::Marker::DELETE;
+    }
+  }
+  connectivity_pub_.publish(markers);
+}
+
+void TopmapManager::showOverlaps(const TopmapSnapshot& snapshot)
+{
+  // the nodes which would be removed, with a line to the node they would be
+  // merged into
+  visualization_msgs::Marker nodes;
+  nodes.header.frame_id = "map";
+  nodes.header.stamp = ros::Time::now();
+  nodes.ns = "overlap";
+  nodes.id = 0;
+  nodes.type = visualization_msgs::Marker::SPHERE_LIST;
+  nodes.pose.orientation.w = 1.0;
+  nodes.scale.x = nodes.scale.y = nodes.scale.z = 0.4;
+  nodes.color.a = 0.8;
+  nodes.color.r = 1.0;
+  nodes.color.b = 1.0;
+
+  visualization_msgs::Marker links = nodes;
+  links.id = 1;
+  links.type = visualization_msgs::Marker::LINE_LIST;
+  links.scale.x = 0.05;
+
+  const std::vector<OverlapDetector::Cluster>& clusters = overlaps_.getClusters();
+  for (int i = 0; i < clusters.size(); i++) {
+    const geometry_msgs::Point& kept = snapshot.nodeAt(clusters[i].nodes[0]).pose.position;
+    for (int j = 1; j < clusters[i].nodes.size(); j++) {
+      const geometry_msgs::Point& point = snapshot.nodeAt(clusters[i].nodes[j]).pose.position;
+      nodes.points.push_back(point);
+      links.points.push_back(point);
+      links.points.push_back(kept);
+    }
+  }
+
+  visualization_msgs::MarkerArray markers;
+  markers.markers.push_back(nodes);
+  markers.markers.push_back(links);
+  for (int i = 0; i < markers.markers.size(); i++) {
+    if (markers.markers[i].points.empty()) {
+      markers.markers[i].action = visualization_msgs::Marker::DELETE;
+    }
+  }
+  overlap_pub_.publish(markers);
+}
+
+void TopmapManager::showDiff()
+{
+  // one sphere list for the nodes and one line list for the edges of each
+  // kind of change, so that rviz can hide them separately
+  const char* names[] = {"diff_added", "diff_removed", "diff_changed"};
+  const double colors[][3] = {{0.0, 0.8, 0.0}, {1.0, 0.0, 0.0}, {1.0, 0.6, 0.0}};
+  std::vector<visualization_msgs::Marker> nodes(3);
+  std::vector<visualization_msgs::Marker> edges(3);
+  for (int i = 0; i < 3; i++) {
+    nodes[i].header.frame_id = "map";
+    nodes[i].header.stamp = ros::Time::now();
+    nodes[i].ns = names[i];
+    nodes[i].id = 0;
+    nodes[i].type = visualization_msgs::Marker::SPHERE_LIST;
+    nodes[i].pose.orientation.w = 1.0;
+    nodes[i].scale.x = nodes[i].scale.y = nodes[i].scale.z = 0.5;
+    nodes[i].color.a = 0.8;
+    nodes[i].color.r = colors[i][0];
+    nodes[i].color.g = colors[i][1];
+    nodes[i].color.b = colors[i][2];
+
+    edges[i] = nodes[i];
+    edges[i].id = 1;
+    edges[i].type = visualization_msgs::Marker::LINE_LIST;
+    edges[i].scale.x = 0.08;
+  }
+  // where moved nodes were before
+  visualization_msgs::Marker moves = edges[MapDiff::MODIFIED];
+  moves.id = 2;
+  moves.scale.x = 0.04;
+
+  std::vector<MapDiff::NodeChange> changes = diff_.isActive() ? diff_.getChanges() : std::vector<MapDiff::NodeChange>();
+  for (int i = 0; i < changes.size(); i++) {
+    const MapDiff::NodeChange& change = changes[i];
+    // removed things are drawn where they were in the first map
+    const TopmapSnapshot& before = *diff_.getBefore().snapshot;
+    const TopmapSnapshot& after = *diff_.getAfter().snapshot;
+    const TopmapSnapshot& shown = change.kind == MapDiff::REMOVED ? before : after;
+    const strands_navigation_msgs::TopologicalNode& node = shown.nodeAt(shown.findNode(change.name));
+    nodes[change.kind].points.push_back(node.pose.position);
+    if (change.kind == MapDiff::MODIFIED && (change.fields & TopmapDelta::POSE)) {
+      moves.points.push_back(before.nodeAt(before.findNode(change.name)).pose.position);
+      moves.points.push_back(node.pose.position);
+    }
+
+    for (int j = 0; j < change.edges.size(); j++) {
+      const MapDiff::EdgeChange& edge_change = change.edges[j];
+      const TopmapSnapshot& edge_map = edge_change.kind == MapDiff::REMOVED ? before : after;
+      const strands_navigation_msgs::TopologicalNode& origin = edge_map.nodeAt(edge_map.findNode(change.name));
+      for (int k = 0; k < origin.edges.size(); k++) {
+	if (origin.edges[k].edge_id != edge_change.edge_id) {
+	  continue;
+	}
+	int target = edge_map.findNode(origin.edges[k].node);
+	if (target >= 0) {
+	  edges[edge_change.kind].points.push_back(origin.pose.position);
+	  edges[edge_change.kind].points.push_back(edge_map.nodeAt(target).pose.position);
+	}
+	break;
+      }
+    }
+  }
+
+  visualization_msgs::MarkerArray markers;
+  markers.markers.insert(markers.markers.end(), nodes.begin(), nodes.end());
+  markers.markers.insert(markers.markers.end(), edges.begin(), edges.end());
+  markers.markers.push_back(moves);
+  for (int i = 0; i < markers.markers.size(); i++) {
+    if (markers.markers[i].points.empty()) {
+      markers.markers[i].action = visualization_msgs::Marker::DELETE;
+    }
+  }
+  diff_pub_.publish(markers);
+}
+
+int TopmapManager::setFilter(const QString& query)
+{
+  filter_ = query.trimmed().toStdString();
+  TopmapSnapshot::ConstPtr snapshot = root_property_->getSnapshot();
+  if (!snapshot) {
+    return 0;
+  }
+
+  if (filter_.empty()) {
+    item_model_->setFilter(NULL);
+    return snapshot->numNodes();
+  }
+
+  std::vector<int> matches = search_index_.find(filter_, *snapshot);
+  item_model_->setFilter(&matches);
+  return matches.size();
+}
+
 NodeController* TopmapManager::getController() const
 {
   return root_property_;
@@ -2,11 +2,21 @@
 #define TOPMAP_MANAGER_H
 
 #include "node_controller.h"
+#include "topmap_item_model.h"
+#include "topmap_table_model.h"
+#include "search_index.h"
+#include "connectivity_analysis.h"
+#include "map_validator.h"
+#include "overlap_detector.h"
+#include "map_statistics.h"
+#include "map_diff.h"
 #include "ros/ros.h"
 
 #include <stdio.h>
 #include <sstream>
 
+#include <boost/thread.hpp>
+
 #include <QList>
 #include <QObject>
 #include <QStringList>
@@ -56,6 +66,47 @@ public:
 
   rviz::PropertyTreeModel* getPropertyModel() { return property_model_; }
 
+  /** @brief Lightweight model of the nodes and edges, kept in sync with the
+   * controller. */
+  TopmapItemModel* getItemModel() { return item_model_; }
+
+  /** @brief Flat, sortable model of the nodes and edges, kept in sync with
+   * the controller. */
+  TopmapTableModel* getTableModel() { return table_model_; }
+
+  /** @brief Only show the nodes matching @a query in the item model, see
+   * SearchIndex::find() for the syntax. An empty query shows everything.
+   * The filter is reapplied whenever the map changes.
+   * @return the number of matching nodes. */
+  int setFilter(const QString& query);
+
+  /** @brief Connectivity of the current map, redone when edges change. */
+  const ConnectivityAnalysis& getConnectivity() const { return connectivity_; }
+
+  /** @brief Problems in the current map, checked again on every change. */
+  const MapValidator& getValidator() const { return validator_; }
+
+  /** @brief Clusters of overlapping nodes in the current map. */
+  const OverlapDetector& getOverlaps() const { return overlaps_; }
+
+  /** @brief Counts and distributions describing the current map. */
+  const MapStatistics& getStatistics() const { return statistics_; }
+
+  /** @brief Differences between the maps chosen with setDiff(). */
+  const MapDiff& getDiff() const { return diff_; }
+
+  /** @brief Compare @a before with @a after and show the differences in
+   * the 3D view. A source without a snapshot stands for the live map, which
+   * is followed as it changes. */
+  void setDiff(const MapDiff::Source& before, const MapDiff::Source& after);
+
+  /** @brief Stop comparing maps and remove the differences from the 3D
+   * view. */
+  void clearDiff();
+
+  /** @brief The current map and the tags of its nodes. */
+  MapDiff::Source getLiveSource() const;
+
   void load(const rviz::Config& config);
   void save(rviz::Config config) const;
 
@@ -90,8 +141,19 @@ Q_SIGNALS:
   /** @brief Emitted just after the current view controller changes. */
   void currentChanged();
 
+  /** @brief Emitted when the connectivity or the overlaps of the current
+   * map have been found again. */
+  void analysisUpdated();
+
+  /** @brief Emitted from the analysis thread when it is done. */
+  void analysisDone(bool connectivity, bool overlaps);
+
 private Q_SLOTS:
   void onCurrentDestroyed(QObject* obj);
+  void onMapUpdated();
+  void onAnalysisDone(bool connectivity, bool overlaps);
+  /** @brief Publish the map statistics on /diagnostics. */
+  void publishStatistics();
 
 private:
   /** @brief Set @a new_current as current.
@@ -102,9 +164,58 @@ private:
    * RenderPanel about the new controller. */
   void setCurrent(NodeProperty* new_current, bool mimic_view);
 
+  /** @brief Bring the connectivity and the overlaps up to date with
+   * @a snapshot. Nothing is redone for changes which move no node and no
+   * edge, and large maps are analysed in the background. */
+  void analyse(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+  /** @brief Update the copies of the analyses in the analysis thread. */
+  void runAnalysis();
+  /** @brief Publish the markers and warnings for the analyses of the
+   * current map. */
+  void showAnalysis(const TopmapSnapshot& snapshot, bool connectivity, bool overlaps);
+
+  /** @brief Highlight the nodes with connectivity problems or overlaps in
+   * the item model. */
+  void updateWarnings(const TopmapSnapshot& snapshot);
+  /** @brief Publish markers for the results of the connectivity analysis. */
+  void showConnectivity(const TopmapSnapshot& snapshot);
+  /** @brief Publish markers for the overlapping nodes. */
+  void showOverlaps(const TopmapSnapshot& snapshot);
+  /** @brief Publish markers for the differences between the compared maps,
+   * green where something was added, red where it was removed and orange
+   * where it was changed. */
+  void showDiff();
+
   rviz::DisplayContext* context_;
   NodeController* root_property_;
   rviz::PropertyTreeModel* property_model_;
+  TopmapItemModel* item_model_;
+  TopmapTableModel* table_model_;
+  SearchIndex search_index_;
+  std::string filter_;
+  ConnectivityAnalysis connectivity_;
+  MapValidator validator_;
+  OverlapDetector overlaps_;
+  MapStatistics statistics_;
+  MapDiff diff_;
+  // the map the connectivity and overlaps were last brought up to date with
+  TopmapSnapshot::ConstPtr analysed_;
+  // the analyses being done in the background, swapped in when done
+  ConnectivityAnalysis next_connectivity_;
+  OverlapDetector next_overlaps_;
+  TopmapSnapshot::ConstPtr analysing_;
+  TopmapDelta analysing_delta_;
+  // results found for a map which changed again before they could be shown
+  bool connectivity_unshown_;
+  bool overlaps_unshown_;
+  boost::thread analysis_thread_;
+  // which sides of the diff follow the live map
+  bool diff_before_live_;
+  bool diff_after_live_;
+  ros::Publisher diagnostics_pub_;
+  ros::Publisher connectivity_pub_;
+  ros::Publisher overlap_pub_;
+  ros::Publisher diff_pub_;
   rviz::PluginlibFactory<NodeController>* factory_;
   NodeProperty* current_;
   rviz::RenderPanel* render_panel_;
@@ -0,0 +1,220 @@
+#include "topmap_snapshot.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include <boost/functional/hash.hpp>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+bool charLess(char a, char b)
+{
+  return ::tolower(static_cast<unsigned char>(a)) < ::tolower(static_cast<unsigned char>(b));
+}
+
+// Orders indices into the node list by node name, without copying the nodes
+// around like sorting the message itself would.
+struct IndexSorter {
+  IndexSorter(const std::vector<strands_navigation_msgs::TopologicalNode>& nodes) : nodes_(nodes) {}
+
+  bool operator() (unsigned int a, unsigned int b) const {
+    const std::string& an = nodes_[a].name;
+    const std::string& bn = nodes_[b].name;
+    // break ties between names differing only in case, so that the order does
+    // not depend on the order of nodes in the message
+    if (TopmapSnapshot::nameLess(an, bn)) {
+      return true;
+    }
+    return !TopmapSnapshot::nameLess(bn, an) && an < bn;
+  }
+
+  const std::vector<strands_navigation_msgs::TopologicalNode>& nodes_;
+};
+
+bool posesEqual(const geometry_msgs::Pose& a, const geometry_msgs::Pose& b)
+{
+  return a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z
+    && a.orientation.x == b.orientation.x && a.orientation.y == b.orientation.y
+    && a.orientation.z == b.orientation.z && a.orientation.w == b.orientation.w;
+}
+
+bool edgesEqual(const strands_navigation_msgs::Edge& a, const strands_navigation_msgs::Edge& b)
+{
+  return a.edge_id == b.edge_id && a.node == b.node && a.action == b.action && a.top_vel == b.top_vel
+    && a.map_2d == b.map_2d && a.inflation_radius == b.inflation_radius;
+}
+
+} // end anonymous namespace
+
+TopmapSnapshot::TopmapSnapshot(const strands_navigation_msgs::TopologicalMap::ConstPtr& msg, unsigned int revision)
+  : msg_(msg)
+  , revision_(revision)
+{
+  order_.resize(msg_->nodes.size());
+  for (unsigned int i = 0; i < order_.size(); i++) {
+    order_[i] = i;
+  }
+  std::stable_sort(order_.begin(), order_.end(), IndexSorter(msg_->nodes));
+
+  size_t slots = 1;
+  while (slots < 2 * order_.size()) {
+    slots <<= 1;
+  }
+  name_slots_.assign(slots, -1);
+  boost::hash<std::string> hash;
+  for (int i = 0; i < order_.size(); i++) {
+    const std::string& name = nodeAt(i).name;
+    size_t slot = hash(name) & (slots - 1);
+    while (name_slots_[slot] >= 0 && nodeAt(name_slots_[slot]).name != name) {
+      slot = (slot + 1) & (slots - 1);
+    }
+    // nodes with the same name are next to each other in display order, and
+    // the slot points at the first of them
+    if (name_slots_[slot] < 0) {
+      name_slots_[slot] = i;
+    }
+  }
+}
+
+TopmapSnapshot::TopmapSnapshot(const TopmapSnapshot& other, unsigned int revision)
+  : msg_(other.msg_)
+  , revision_(revision)
+  , order_(other.order_)
+  , name_slots_(other.name_slots_)
+{
+}
+
+TopmapSnapshot::NodeConstPtr TopmapSnapshot::node(size_t index) const
+{
+  // aliasing constructor: the handle shares ownership of the whole message
+  return NodeConstPtr(msg_, &msg_->nodes[order_[index]]);
+}
+
+int TopmapSnapshot::findNode(const std::string& name) const
+{
+  size_t mask = name_slots_.size() - 1;
+  for (size_t slot = boost::hash<std::string>()(name) & mask; name_slots_[slot] >= 0; slot = (slot + 1) & mask) {
+    if (nodeAt(name_slots_[slot]).name == name) {
+      return name_slots_[slot];
+    }
+  }
+  return -1;
+}
+
+int TopmapSnapshot::countNode(const std::string& name) const
+{
+  int first = findNode(name);
+  if (first < 0) {
+    return 0;
+  }
+  int last = first + 1;
+  while (last < order_.size() && nodeAt(last).name == name) {
+    last++;
+  }
+  return last - first;
+}
+
+int TopmapSnapshot::occurrence(size_t index) const
+{
+  int copy = 0;
+  while (copy < index && nodeAt(index - copy - 1).name == nodeAt(index).name) {
+    copy++;
+  }
+  return copy;
+}
+
+int TopmapSnapshot::findMatch(const TopmapSnapshot& other, size_t index) const
+{
+  const std::string& name = other.nodeAt(index).name;
+  int copy = other.occurrence(index);
+  int first = findNode(name);
+  if (first < 0 || copy >= countNode(name)) {
+    return -1;
+  }
+  return first + copy;
+}
+
+TopmapSnapshot::EdgeConstPtr TopmapSnapshot::edge(const NodeConstPtr& node, size_t index)
+{
+  return EdgeConstPtr(node, &node->edges[index]);
+}
+
+TopmapSnapshot::PoseConstPtr TopmapSnapshot::pose(const NodeConstPtr& node)
+{
+  return PoseConstPtr(node, &node->pose);
+}
+
+bool TopmapSnapshot::nameLess(const std::string& a, const std::string& b)
+{
+  return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), charLess);
+}
+
+unsigned int TopmapSnapshot::compareNodes(const strands_navigation_msgs::TopologicalNode& a,
+					  const strands_navigation_msgs::TopologicalNode& b)
+{
+  unsigned int fields = 0;
+  if (!posesEqual(a.pose, b.pose)) {
+    fields |= TopmapDelta::POSE;
+  }
+  if (a.yaw_goal_tolerance != b.yaw_goal_tolerance || a.xy_goal_tolerance != b.xy_goal_tolerance) {
+    fields |= TopmapDelta::TOLERANCE;
+  }
+  if (a.map != b.map || a.pointset != b.pointset || a.localise_by_topic != b.localise_by_topic) {
+    fields |= TopmapDelta::INFO;
+  }
+  if (a.edges.size() != b.edges.size()) {
+    fields |= TopmapDelta::EDGES;
+  } else {
+    for (size_t i = 0; i < a.edges.size(); i++) {
+      if (!edgesEqual(a.edges[i], b.edges[i])) {
+	fields |= TopmapDelta::EDGES;
+	break;
+      }
+    }
+  }
+  return fields;
+}
+
+TopmapDelta TopmapSnapshot::diff(const TopmapSnapshot* before, const TopmapSnapshot& after)
+{
+  TopmapDelta delta;
+  delta.to_revision = after.getRevision();
+  if (!before) {
+    delta.added.resize(after.numNodes());
+    for (int i = 0; i < after.numNodes(); i++) {
+      delta.added[i] = i;
+    }
+    return delta;
+  }
+
+  // The map manager does not stop two nodes from having the same name. The
+  // n-th node of a name is paired with the n-th node of that name in the
+  // other snapshot, so that every node is either kept, added or removed and
+  // the display indices on both sides still add up.
+  delta.from_revision = before->getRevision();
+  for (int i = 0; i < after.numNodes(); i++) {
+    int old_ind = before->findMatch(after, i);
+    if (old_ind < 0) {
+      delta.added.push_back(i);
+      continue;
+    }
+    unsigned int fields = compareNodes(before->nodeAt(old_ind), after.nodeAt(i));
+    if (fields) {
+      delta.modified.push_back(TopmapDelta::Change(old_ind, i, fields));
+    }
+  }
+
+  for (int i = 0; i < before->numNodes(); i++) {
+    if (after.findMatch(*before, i) < 0) {
+      delta.removed.push_back(i);
+    }
+  }
+
+  return delta;
+}
+
+} // end namespace topological_rviz_tools
@@ -0,0 +1,138 @@
+#ifndef TOPMAP_SNAPSHOT_H
+#define TOPMAP_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "geometry_msgs/Pose.h"
+#include "strands_navigation_msgs/Edge.h"
+#include "strands_navigation_msgs/TopologicalMap.h"
+#include "strands_navigation_msgs/TopologicalNode.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Differences between two revisions of the map, keyed by node name.
+ *
+ * Indices refer to display order: removed nodes index into the old snapshot,
+ * added nodes into the new one. Both lists are sorted in ascending order. */
+struct TopmapDelta
+{
+  /** @brief Bits describing which parts of a node changed. */
+  enum Field {
+    NAME = 1,
+    POSE = 2,
+    TOLERANCE = 4,
+    EDGES = 8,
+    INFO = 16, // map, pointset and localise_by_topic
+    ALL = NAME | POSE | TOLERANCE | EDGES | INFO
+  };
+
+  struct Change
+  {
+    Change(int before, int after, unsigned int fields) : before(before), after(after), fields(fields) {}
+    int before;
+    int after;
+    unsigned int fields;
+  };
+
+  TopmapDelta() : from_revision(0), to_revision(0) {}
+
+  // revision of the snapshots the delta goes between, 0 if there was none
+  unsigned int from_revision;
+  unsigned int to_revision;
+
+  std::vector<int> added;
+  std::vector<int> removed;
+  std::vector<Change> modified;
+
+  bool empty() const { return added.empty() && removed.empty() && modified.empty(); }
+};
+
+/** @brief Immutable view of one revision of the topological map.
+ *
+ * The snapshot shares the message it was built from instead of copying it,
+ * and only stores the display order of the nodes and a name lookup table on
+ * top. Both are flat arrays which refer to the names in the message, so
+ * building a revision takes a couple of allocations and dropping it frees
+ * them in one go. Handles returned by node(), edge() and pose() are reference counted
+ * into the message, so anything holding one keeps the revision alive and
+ * never reads freed memory, however many map updates arrive after it. */
+class TopmapSnapshot
+{
+public:
+  typedef boost::shared_ptr<const TopmapSnapshot> ConstPtr;
+  typedef boost::shared_ptr<const strands_navigation_msgs::TopologicalNode> NodeConstPtr;
+  typedef boost::shared_ptr<const strands_navigation_msgs::Edge> EdgeConstPtr;
+  typedef boost::shared_ptr<const geometry_msgs::Pose> PoseConstPtr;
+
+  TopmapSnapshot(const strands_navigation_msgs::TopologicalMap::ConstPtr& msg, unsigned int revision);
+
+  /** @brief Same map as @a other under another revision number, without
+   * sorting or indexing the nodes again. */
+  TopmapSnapshot(const TopmapSnapshot& other, unsigned int revision);
+
+  /** @brief Revision number assigned by whoever created the snapshot. */
+  unsigned int getRevision() const { return revision_; }
+
+  const strands_navigation_msgs::TopologicalMap& getMap() const { return *msg_; }
+
+  size_t numNodes() const { return order_.size(); }
+
+  /** @brief Node at position @a index in display order, which is the
+   * case-insensitive alphabetical order of node names. */
+  const strands_navigation_msgs::TopologicalNode& nodeAt(size_t index) const { return msg_->nodes[order_[index]]; }
+
+  /** @brief Shared handle to the node at position @a index in display order. */
+  NodeConstPtr node(size_t index) const;
+
+  /** @brief Display index of the node called @a name, or -1 if there is
+   * none. If several nodes have that name, they follow on from the first,
+   * which is the one returned. */
+  int findNode(const std::string& name) const;
+
+  /** @brief Number of nodes called @a name. */
+  int countNode(const std::string& name) const;
+
+  /** @brief How many nodes with the same name come before the one at
+   * @a index, which is 0 unless the name is used more than once. */
+  int occurrence(size_t index) const;
+
+  /** @brief Display index of the node which diff() pairs with the one at
+   * @a index in @a other: the copy of its name which comes as many places
+   * after the first. -1 if there is no such node. */
+  int findMatch(const TopmapSnapshot& other, size_t index) const;
+
+  /** @brief Handle to the edge at @a index in the edge list of @a node. */
+  static EdgeConstPtr edge(const NodeConstPtr& node, size_t index);
+
+  /** @brief Handle to the pose of @a node. */
+  static PoseConstPtr pose(const NodeConstPtr& node);
+
+  /** @brief Case-insensitive ordering used to sort the nodes for display. */
+  static bool nameLess(const std::string& a, const std::string& b);
+
+  /** @brief Return the TopmapDelta::Field bits which differ between @a a and
+   * @a b. The name is not compared. */
+  static unsigned int compareNodes(const strands_navigation_msgs::TopologicalNode& a,
+				   const strands_navigation_msgs::TopologicalNode& b);
+
+  /** @brief Compute the changes needed to go from @a before to @a after.
+   * @a before may be null, in which case every node is added. */
+  static TopmapDelta diff(const TopmapSnapshot* before, const TopmapSnapshot& after);
+
+private:
+  strands_navigation_msgs::TopologicalMap::ConstPtr msg_;
+  unsigned int revision_;
+  // indices into msg_->nodes, in display order
+  std::vector<unsigned int> order_;
+  // open addressing hash table of display indices by node name, -1 where
+  // empty. The size is a power of two, at least twice the number of nodes.
+  std::vector<int> name_slots_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // TOPMAP_SNAPSHOT_H
@@ -0,0 +1,301 @@
+#include "topmap_table_model.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+
+double yawOf(const geometry_msgs::Quaternion& q)
+{
+  return std::atan2(2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z)) * 180 / M_PI;
+}
+
+std::string lower(const std::string& text)
+{
+  std::string result(text);
+  for (size_t i = 0; i < result.size(); i++) {
+    result[i] = ::tolower(static_cast<unsigned char>(result[i]));
+  }
+  return result;
+}
+
+struct HasKey {
+  HasKey(const std::vector<double>& keys) : keys_(keys) {}
+  bool operator() (int a) const { return !std::isnan(keys_[a]); }
+  const std::vector<double>& keys_;
+};
+
+struct KeyLess {
+  KeyLess(const std::vector<double>& keys) : keys_(keys) {}
+  bool operator() (int a, int b) const { return keys_[a] < keys_[b]; }
+  const std::vector<double>& keys_;
+};
+
+struct KeyGreater {
+  KeyGreater(const std::vector<double>& keys) : keys_(keys) {}
+  bool operator() (int a, int b) const { return keys_[a] > keys_[b]; }
+  const std::vector<double>& keys_;
+};
+
+} // end anonymous namespace
+
+TopmapTableModel::TopmapTableModel(QObject* parent)
+  : QAbstractTableModel(parent)
+  , strings_(NULL)
+  , keys_(NumColumns)
+  , sort_column_(-1)
+  , sort_order_(Qt::AscendingOrder)
+{
+}
+
+int TopmapTableModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : order_.size();
+}
+
+int TopmapTableModel::columnCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : NumColumns;
+}
+
+int TopmapTableModel::nodeOf(const QModelIndex& index) const
+{
+  if (!index.isValid() || index.row() >= order_.size()) {
+    return -1;
+  }
+  return entries_[order_[index.row()]].node;
+}
+
+QVariant TopmapTableModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || index.row() >= order_.size()) {
+    return QVariant();
+  }
+  const Entry& entry = entries_[order_[index.row()]];
+  const strands_navigation_msgs::TopologicalNode& node = snapshot_->nodeAt(entry.node);
+  const strands_navigation_msgs::Edge* edge = entry.edge < 0 ? NULL : &node.edges[entry.edge];
+
+  if (role == NodeNameRole) {
+    return QString::fromStdString(node.name);
+  }
+  if (role == EdgeIdRole) {
+    return edge ? QString::fromStdString(edge->edge_id) : QString();
+  }
+  if (role == Qt::TextAlignmentRole) {
+    if (index.column() == NameColumn || index.column() == ActionColumn) {
+      return int(Qt::AlignLeft | Qt::AlignVCenter);
+    }
+    return int(Qt::AlignRight | Qt::AlignVCenter);
+  }
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  if (edge) {
+    switch (index.column()) {
+    case NameColumn:
+      return QString::fromStdString(edge->edge_id);
+    case ActionColumn:
+      return strings_ ? strings_->intern(edge->action) : QString::fromStdString(edge->action);
+    case TopVelColumn:
+      return QString::number(edge->top_vel, 'f', 2);
+    }
+    return QVariant();
+  }
+
+  switch (index.column()) {
+  case NameColumn:
+    return QString::fromStdString(node.name);
+  case XColumn:
+    return QString::number(node.pose.position.x, 'f', 2);
+  case YColumn:
+    return QString::number(node.pose.position.y, 'f', 2);
+  case YawColumn:
+    return QString::number(yawOf(node.pose.orientation), 'f', 1);
+  case XYToleranceColumn:
+    return QString::number(node.xy_goal_tolerance, 'f', 3);
+  case YawToleranceColumn:
+    return QString::number(node.yaw_goal_tolerance, 'f', 3);
+  case EdgesColumn:
+    return int(node.edges.size());
+  }
+  return QVariant();
+}
+
+QVariant TopmapTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  switch (section) {
+  case NameColumn:
+    return "Node / Edge";
+  case XColumn:
+    return "X";
+  case YColumn:
+    return "Y";
+  case YawColumn:
+    return "Yaw";
+  case XYToleranceColumn:
+    return "XY tol";
+  case YawToleranceColumn:
+    return "Yaw tol";
+  case EdgesColumn:
+    return "Edges";
+  case ActionColumn:
+    return "Action";
+  case TopVelColumn:
+    return "Top vel";
+  }
+  return QVariant();
+}
+
+void TopmapTableModel::setSnapshot(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta)
+{
+  if (snapshot_ && snapshot && delta.empty() && delta.from_revision == snapshot_->getRevision()) {
+    // same nodes at the same display indices, the rows still hold
+    snapshot_ = snapshot;
+    return;
+  }
+
+  beginResetModel();
+  snapshot_ = snapshot;
+  entries_.clear();
+  for (int i = 0; i < keys_.size(); i++) {
+    keys_[i].clear();
+  }
+  if (snapshot_) {
+    for (int i = 0; i < snapshot_->numNodes(); i++) {
+      entries_.push_back(Entry(i, -1));
+      for (int j = 0; j < snapshot_->nodeAt(i).edges.size(); j++) {
+	entries_.push_back(Entry(i, j));
+      }
+    }
+  }
+  sortRows();
+  endResetModel();
+}
+
+const std::vector<double>& TopmapTableModel::keysFor(int column)
+{
+  std::vector<double>& keys = keys_[column];
+  if (!keys.empty() || entries_.empty()) {
+    return keys;
+  }
+
+  keys.resize(entries_.size(), std::numeric_limits<double>::quiet_NaN());
+
+  if (column == NameColumn || column == ActionColumn) {
+    // Rank the rows by their text, with equal text getting the same rank.
+    // Sorting lower case copies is several times faster than comparing
+    // case-insensitively.
+    std::vector<std::pair<std::string, int> > ranked;
+    ranked.reserve(entries_.size());
+    for (int i = 0; i < entries_.size(); i++) {
+      const strands_navigation_msgs::TopologicalNode& node = snapshot_->nodeAt(entries_[i].node);
+      if (entries_[i].edge >= 0) {
+	const strands_navigation_msgs::Edge& edge = node.edges[entries_[i].edge];
+	ranked.push_back(std::make_pair(lower(column == NameColumn ? edge.edge_id : edge.action), i));
+      } else if (column == NameColumn) {
+	ranked.push_back(std::make_pair(lower(node.name), i));
+      }
+    }
+    std::sort(ranked.begin(), ranked.end());
+    for (int i = 0, rank = 0; i < ranked.size(); i++) {
+      if (i > 0 && ranked[i - 1].first != ranked[i].first) {
+	rank++;
+      }
+      keys[ranked[i].second] = rank;
+    }
+    return keys;
+  }
+
+  for (int i = 0; i < entries_.size(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = snapshot_->nodeAt(entries_[i].node);
+    if (entries_[i].edge >= 0) {
+      if (column == TopVelColumn) {
+	keys[i] = node.edges[entries_[i].edge].top_vel;
+      }
+      continue;
+    }
+    switch (column) {
+    case XColumn:
+      keys[i] = node.pose.position.x;
+      break;
+    case YColumn:
+      keys[i] = node.pose.position.y;
+      break;
+    case YawColumn:
+      keys[i] = yawOf(node.pose.orientation);
+      break;
+    case XYToleranceColumn:
+      keys[i] = node.xy_goal_tolerance;
+      break;
+    case YawToleranceColumn:
+      keys[i] = node.yaw_goal_tolerance;
+      break;
+    case EdgesColumn:
+      keys[i] = node.edges.size();
+      break;
+    }
+  }
+  return keys;
+}
+
+void TopmapTableModel::sortRows()
+{
+  order_.resize(entries_.size());
+  for (int i = 0; i < order_.size(); i++) {
+    order_[i] = i;
+  }
+  if (sort_column_ < 0 || sort_column_ >= NumColumns || entries_.empty()) {
+    return;
+  }
+
+  // Rows the column doesn't apply to go last either way. Sorting is stable,
+  // so ties stay in map order.
+  const std::vector<double>& keys = keysFor(sort_column_);
+  std::vector<int>::iterator end = std::stable_partition(order_.begin(), order_.end(), HasKey(keys));
+  if (sort_order_ == Qt::AscendingOrder) {
+    std::stable_sort(order_.begin(), end, KeyLess(keys));
+  } else {
+    std::stable_sort(order_.begin(), end, KeyGreater(keys));
+  }
+}
+
+void TopmapTableModel::sort(int column, Qt::SortOrder order)
+{
+  sort_column_ = column;
+  sort_order_ = order;
+
+  Q_EMIT layoutAboutToBeChanged();
+  QModelIndexList persistent = persistentIndexList();
+  std::vector<int> persistent_entries(persistent.size());
+  for (int i = 0; i < persistent.size(); i++) {
+    persistent_entries[i] = order_[persistent[i].row()];
+  }
+
+  sortRows();
+
+  // keep the selection on the same rows
+  if (!persistent.isEmpty()) {
+    std::vector<int> rows(order_.size());
+    for (int i = 0; i < order_.size(); i++) {
+      rows[order_[i]] = i;
+    }
+    for (int i = 0; i < persistent.size(); i++) {
+      changePersistentIndex(persistent[i], index(rows[persistent_entries[i]], persistent[i].column()));
+    }
+  }
+  Q_EMIT layoutChanged();
+}
+
+} // end namespace topological_rviz_tools
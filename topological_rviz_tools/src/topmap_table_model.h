@@ -0,0 +1,94 @@
+#ifndef TOPMAP_TABLE_MODEL_H
+#define TOPMAP_TABLE_MODEL_H
+
+#include <vector>
+
+#include <QAbstractTableModel>
+
+#include "topmap_item_model.h"
+#include "topmap_snapshot.h"
+#include "string_table.h"
+
+namespace topological_rviz_tools
+{
+
+/** @brief Flat table with one row per node and one per edge of a
+ * TopmapSnapshot, for scanning the whole map for odd values.
+ *
+ * Like TopmapItemModel, rows are only a pair of indices into the snapshot,
+ * so views can page through any number of them. Sorting compares one
+ * precomputed number per row. The numbers for a column are worked out the
+ * first time it is sorted on, and kept until the map changes. */
+class TopmapTableModel: public QAbstractTableModel
+{
+Q_OBJECT
+public:
+  enum Column {
+    NameColumn = 0, // node name or edge_id
+    XColumn,
+    YColumn,
+    YawColumn,
+    XYToleranceColumn,
+    YawToleranceColumn,
+    EdgesColumn,
+    ActionColumn,
+    TopVelColumn,
+    NumColumns
+  };
+
+  // same roles as the tree, so selections can be read the same way
+  enum Role {
+    NodeNameRole = TopmapItemModel::NodeNameRole,
+    EdgeIdRole = TopmapItemModel::EdgeIdRole
+  };
+
+  TopmapTableModel(QObject* parent = 0);
+
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+  virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+  /** @brief Move to @a snapshot. If nothing changed in @a delta the rows
+   * are kept, otherwise they are rebuilt and sorted again. */
+  void setSnapshot(const TopmapSnapshot::ConstPtr& snapshot, const TopmapDelta& delta);
+
+  /** @brief Take the strings which repeat across the map from @a strings
+   * rather than converting them for every row. */
+  void setStringTable(StringTable* strings) { strings_ = strings; }
+
+  /** @brief Display index in the current snapshot of the node the row at
+   * @a index belongs to, or -1. */
+  int nodeOf(const QModelIndex& index) const;
+
+private:
+  struct Entry
+  {
+    Entry(int node, int edge) : node(node), edge(edge) {}
+    // display index of the node in the snapshot
+    int node;
+    // index into the edges of the node, -1 for node rows
+    int edge;
+  };
+
+  /** @brief Sort keys of all entries for @a column, NaN where the column
+   * does not apply to the row. */
+  const std::vector<double>& keysFor(int column);
+  void sortRows();
+
+  TopmapSnapshot::ConstPtr snapshot_;
+  StringTable* strings_;
+  // all rows, each node followed by its edges
+  std::vector<Entry> entries_;
+  // indices into entries_ in the order shown
+  std::vector<int> order_;
+  // per column, empty until it is needed
+  std::vector<std::vector<double> > keys_;
+  int sort_column_;
+  Qt::SortOrder sort_order_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // TOPMAP_TABLE_MODEL_H
@@ -65,7 +65,7 @@ TopmapEdgeTool::~TopmapEdgeTool()
 void TopmapEdgeTool::onInitialize()
 {
   ros::NodeHandle nh;
-  addEdgeSrv_ = nh.serviceClient<topological_rviz_tools::AddEdge>("/topmap_interface/add_edge", true);
+  addEdgeSrv_ = ServiceConnection::create<topological_rviz_tools::AddEdge>("/topmap_interface/add_edge");
   markerPub_ = nh.advertise<visualization_msgs::Marker>("edge_tool_marker", 0);
   update_map_ = nh.advertise<std_msgs::Time>("/update_map", 5);
 }
@@ -7,6 +7,7 @@
 #include <geometry_msgs/Pose.h>
 #include "topological_rviz_tools/AddEdge.h"
 #include "std_msgs/Time.h"
+#include "service_connection.h"
 
 namespace rviz
 {
@@ -38,7 +39,7 @@ public:
 private:
   ros::Publisher markerPub_;
   ros::Publisher update_map_;
-  ros::ServiceClient addEdgeSrv_;
+  ServiceConnection addEdgeSrv_;
   bool noClick_; // true if nothing clicked yet
   geometry_msgs::Pose firstClick_;
   visualization_msgs::Marker edgeMarker_;
@@ -1,5 +1,13 @@
 #include "topological_map_panel.h"
 
+#include <fstream>
+#include <map>
+#include <set>
+
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+
 #include <QLabel>
 #include <QListWidget>
 #include <QComboBox>
@@ -9,38 +17,199 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QComboBox>
+#include <QProgressBar>
+#include <QTableView>
+#include <QTabWidget>
+#include <QTreeView>
+#include <QHeaderView>
+#include <QItemSelection>
+#include <QLineEdit>
+#include <QTimer>
+
+#include <OGRE/OgreQuaternion.h>
+#include <OGRE/OgreVector3.h>
+
+#include "rviz/frame_manager.h"
+#include "rviz/view_controller.h"
+#include "rviz/view_manager.h"
+#include "rviz/visualization_manager.h"
 
 namespace topological_rviz_tools
 {
+
+namespace
+{
+
+// enough for the details of a couple of thousand nodes at a time
+const int DEFAULT_MEMORY_BUDGET_MB = 16;
+
+// deadline of a batch edit, in seconds
+const double BATCH_EDIT_TIMEOUT = 120.0;
+
+/** @brief The node @a prop belongs to, or null if it is not part of one. */
+NodeProperty* owningNode(rviz::Property* prop)
+{
+  while (prop && !qobject_cast<NodeProperty*>(prop)) {
+    prop = prop->getParent();
+  }
+  return static_cast<NodeProperty*>(prop);
+}
+
+/** @brief Resident memory of the process in bytes, or 0 if unknown. */
+size_t residentMemory()
+{
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+} // end anonymous namespace
+
+TopologicalMapPanel::~TopologicalMapPanel()
+{
+  // the call thread uses the service connection and batch_
+  if (batch_thread_.joinable()) {
+    batch_thread_.join();
+  }
+}
+
 TopologicalMapPanel::TopologicalMapPanel(QWidget* parent)
   : rviz::Panel(parent)
+  , bulk_share_(1)
+  , bulk_cancelled_(false)
   , topmap_man_(NULL)
+  , memory_budget_mb_(DEFAULT_MEMORY_BUDGET_MB)
+  , cached_pointsets_(3)
 {
   properties_view_ = new rviz::PropertyTreeWidget();
+  edit_triggers_ = properties_view_->editTriggers();
+
+  // The nodes view shows rows straight from the map snapshot, so it stays
+  // responsive on maps too large to browse comfortably as properties. It is
+  // the view the panel opens on. The property tree stays, since it is what
+  // edits nodes through the map manager, but within a memory budget only the
+  // nodes in use have their details built.
+  nodes_view_ = new QTreeView();
+  nodes_view_->setUniformRowHeights(true);
+  nodes_view_->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  nodes_view_->setAllColumnsShowFocus(true);
+
+  search_box_ = new QLineEdit();
+  search_box_->setPlaceholderText("Search nodes (name:, tag:, action:, to:)");
+  search_status_ = new QLabel();
+
+  pointset_box_ = new QComboBox();
+  pointset_box_->setMinimumContentsLength(12);
+  pointset_box_->setToolTip("Pointset to show and edit. Pointsets shown before are cached and switch instantly.");
+  QPushButton* refresh_button = new QPushButton("Refresh");
+  refresh_button->setToolTip("Look up the pointsets in the database again");
+
+  QHBoxLayout* search_layout = new QHBoxLayout;
+  search_layout->addWidget(pointset_box_);
+  search_layout->addWidget(refresh_button);
+  search_layout->addWidget(search_box_);
+  search_layout->addWidget(search_status_);
+  search_layout->setContentsMargins(2, 2, 2, 0);
+
+  tabs_ = new QTabWidget();
+  tabs_->addTab(nodes_view_, "Nodes");
+  tabs_->addTab(properties_view_, "Properties");
+
+  // Flat table for finding outliers. The row height is fixed so the view
+  // never has to measure rows, whatever the size of the map.
+  table_view_ = new QTableView();
+  table_view_->setSortingEnabled(true);
+  table_view_->setSelectionBehavior(QAbstractItemView::SelectRows);
+  table_view_->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  table_view_->setWordWrap(false);
+  table_view_->verticalHeader()->setDefaultSectionSize(table_view_->fontMetrics().height() + 4);
+  table_view_->verticalHeader()->hide();
+  table_view_->horizontalHeader()->setStretchLastSection(true);
+  tabs_->addTab(table_view_, "Table");
+
+  tag_view_ = new TagView();
+  tabs_->addTab(tag_view_, "Tags");
+
+  validation_view_ = new ValidationView();
+  tabs_->addTab(validation_view_, "Problems");
+
+  overlap_view_ = new OverlapView();
+  tabs_->addTab(overlap_view_, "Overlaps");
+
+  statistics_view_ = new StatisticsView();
+  tabs_->addTab(statistics_view_, "Statistics");
+
+  diff_view_ = new DiffView();
+  tabs_->addTab(diff_view_, "Diff");
 
   ros::NodeHandle nh;
-  delNodeSrv_ = nh.serviceClient<strands_navigation_msgs::RmvNode>("/topological_map_manager/remove_topological_node", true);
-  addTagSrv_ = nh.serviceClient<strands_navigation_msgs::AddTag>("/topological_map_manager/add_tag_to_node", true);
-  delTagSrv_ = nh.serviceClient<strands_navigation_msgs::AddTag>("/topological_map_manager/rm_tag_from_node", true);
-  delEdgeSrv_ = nh.serviceClient<strands_navigation_msgs::AddEdge>("/topological_map_manager/remove_edge", true);
+  batchEditSrv_ = ServiceConnection::create<topological_rviz_tools::BatchEdit>("/topmap_interface/batch_edit");
+  listPointsetsSrv_ = ServiceConnection::create<topological_rviz_tools::ListPointsets>("/topmap_interface/list_pointsets",
+										  ServiceConnection::INTERACTIVE, ServiceConnection::RETRY);
   update_map_ = nh.advertise<std_msgs::Time>("/update_map", 5);
 
-  QPushButton* add_tag_button = new QPushButton("Add tag");
-  QPushButton* remove_button = new QPushButton("Remove");
+  add_tag_button_ = new QPushButton("Add tag");
+  remove_button_ = new QPushButton("Remove");
+  edit_button_ = new QPushButton("Edit selection");
 
   QHBoxLayout* button_layout = new QHBoxLayout;
-  button_layout->addWidget(add_tag_button);
-  button_layout->addWidget(remove_button);
+  button_layout->addWidget(new ConnectionIndicator());
+  memory_status_ = new QLabel();
+  button_layout->addWidget(memory_status_);
+  button_layout->addStretch();
+  button_layout->addWidget(add_tag_button_);
+  button_layout->addWidget(edit_button_);
+  button_layout->addWidget(remove_button_);
   button_layout->setContentsMargins(2, 0, 2, 2);
 
+  // progress of bulk jobs, which run in the background
+  bulk_progress_ = new QProgressBar();
+  bulk_cancel_ = new QPushButton("Cancel");
+  bulk_timer_ = new QTimer(this);
+  bulk_timer_->setInterval(100);
+  QHBoxLayout* bulk_layout = new QHBoxLayout;
+  bulk_layout->addWidget(bulk_progress_);
+  bulk_layout->addWidget(bulk_cancel_);
+  bulk_layout->setContentsMargins(2, 0, 2, 2);
+  bulk_progress_->hide();
+  bulk_cancel_->hide();
+  RequestScheduler::instance().setBulkLimits(bulk_.getInFlight(), bulk_share_);
+
   QVBoxLayout* main_layout = new QVBoxLayout;
   main_layout->setContentsMargins(0,0,0,0);
-  main_layout->addWidget(properties_view_);
+  main_layout->addLayout(search_layout);
+  main_layout->addWidget(tabs_);
+  main_layout->addLayout(bulk_layout);
   main_layout->addLayout(button_layout);
   setLayout(main_layout);
 
-  connect(remove_button, SIGNAL(clicked()), this, SLOT(onDeleteClicked()));
-  connect(add_tag_button, SIGNAL(clicked()), this, SLOT(onAddTagClicked()));
+  connect(remove_button_, SIGNAL(clicked()), this, SLOT(onDeleteClicked()));
+  connect(add_tag_button_, SIGNAL(clicked()), this, SLOT(onAddTagClicked()));
+  connect(edit_button_, SIGNAL(clicked()), this, SLOT(onBulkEditClicked()));
+  connect(refresh_button, SIGNAL(clicked()), this, SLOT(refreshPointsets()));
+  connect(pointset_box_, SIGNAL(activated(int)), this, SLOT(onPointsetActivated(int)));
+  connect(bulk_cancel_, SIGNAL(clicked()), this, SLOT(onBulkCancel()));
+  connect(bulk_timer_, SIGNAL(timeout()), this, SLOT(onBulkProgress()));
+  connect(this, SIGNAL(batchEditSent(int)), this, SLOT(onBatchEditSent(int)), Qt::QueuedConnection);
+  connect(properties_view_, SIGNAL(expanded(const QModelIndex&)), this, SLOT(onPropertyExpanded(const QModelIndex&)));
+  connect(properties_view_, SIGNAL(collapsed(const QModelIndex&)), this, SLOT(onPropertyCollapsed(const QModelIndex&)));
+
+  QTimer* memory_timer = new QTimer(this);
+  connect(memory_timer, SIGNAL(timeout()), this, SLOT(updateMemoryStatus()));
+  memory_timer->start(2000);
+  connect(search_box_, SIGNAL(textChanged(const QString&)), this, SLOT(onSearchChanged(const QString&)));
+  connect(nodes_view_, SIGNAL(activated(const QModelIndex&)), this, SLOT(onNodeActivated(const QModelIndex&)));
+  connect(table_view_, SIGNAL(activated(const QModelIndex&)), this, SLOT(onTableActivated(const QModelIndex&)));
+  connect(tag_view_, SIGNAL(selectNodes(const QStringList&)), this, SLOT(selectNodes(const QStringList&)));
+  connect(tag_view_, SIGNAL(tagsModified()), this, SLOT(updateTopMap()));
+  connect(validation_view_, SIGNAL(selectNodes(const QStringList&)), this, SLOT(selectNodes(const QStringList&)));
+  connect(overlap_view_, SIGNAL(selectNodes(const QStringList&)), this, SLOT(selectNodes(const QStringList&)));
+  connect(overlap_view_, SIGNAL(mergeRequested()), this, SLOT(onMergeRequested()));
+  connect(diff_view_, SIGNAL(selectNodes(const QStringList&)), this, SLOT(selectNodes(const QStringList&)));
   // connect(properties_view_, SIGNAL(clicked(const QModelIndex&)), this, SLOT(setCurrentViewFromIndex(const QModelIndex&)));
   // connect(properties_view_, SIGNAL(activated(const QModelIndex&)), this, SLOT(setCurrentViewFromIndex(const QModelIndex&)));
 }
@@ -58,28 +227,242 @@ void TopologicalMapPanel::setTopmapManager(TopmapManager* topmap_man)
 {
   ROS_INFO("Setting model");
   properties_view_->setModel(topmap_man->getPropertyModel());
+  connect(properties_view_->selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
+	  this, SLOT(onPropertySelectionChanged()));
+  topmap_man->getController()->setMemoryBudget(memory_budget_mb_ * size_t(1024 * 1024));
+  topmap_man->getController()->setCacheSize(cached_pointsets_);
+  nodes_view_->setModel(topmap_man->getItemModel());
+  table_view_->setModel(topmap_man->getTableModel());
+  // the model is reset when too much changes at once, so keep track of what
+  // the user was looking at
+  new TreeState(nodes_view_, topmap_man->getItemModel());
+  tag_view_->setTagIndex(&topmap_man->getController()->getTagIndex());
+  validation_view_->setValidator(&topmap_man->getValidator());
+  overlap_view_->setDetector(&topmap_man->getOverlaps());
+  statistics_view_->setStatistics(&topmap_man->getStatistics());
+  diff_view_->setManager(topmap_man);
   topmap_man_ = topmap_man;
+  connect(topmap_man_->getController(), SIGNAL(mapUpdated()), this, SLOT(onMapUpdated()));
+  connect(topmap_man_, SIGNAL(analysisUpdated()), this, SLOT(onAnalysisUpdated()));
+  connect(topmap_man_->getController(), SIGNAL(pointsetSwitched(bool, const QString&)),
+	  this, SLOT(onPointsetSwitched(bool, const QString&)));
+  refreshPointsets();
 
   // connect(camera_type_selector_, SIGNAL(activated(int)), this, SLOT(onTypeSelectorChanged(int)));
   // connect(topmap_man_, SIGNAL(currentChanged()), this, SLOT(onCurrentChanged()));
   // onCurrentChanged();
 }
 
-void TopologicalMapPanel::onDeleteClicked()
+void TopologicalMapPanel::refreshPointsets()
 {
-  QList<NodeProperty*> nodes_to_delete = properties_view_->getSelectedObjects<NodeProperty>();
-  QList<TagProperty*> tags_to_delete = properties_view_->getSelectedObjects<TagProperty>();
-  QList<EdgeProperty*> edges_to_delete = properties_view_->getSelectedObjects<EdgeProperty>();
+  std::set<std::string> pointsets;
+  topological_rviz_tools::ListPointsets srv;
+  // the database is local, so don't keep the panel waiting if it is not up
+  if (listPointsetsSrv_.call(srv, 2.0) == ServiceConnection::OK) {
+    pointsets.insert(srv.response.pointsets.begin(), srv.response.pointsets.end());
+  } else {
+    ROS_WARN("Could not list the pointsets, only showing the cached ones");
+  }
 
-  if (nodes_to_delete.size() + tags_to_delete.size() + edges_to_delete.size() == 0){
+  std::vector<std::string> cached;
+  if (topmap_man_) {
+    cached = topmap_man_->getController()->getCachedPointsets();
+    pointsets.insert(cached.begin(), cached.end());
+  }
+  std::set<std::string> is_cached(cached.begin(), cached.end());
+
+  pointset_box_->clear();
+  for (std::set<std::string>::iterator it = pointsets.begin(); it != pointsets.end(); ++it) {
+    QString name = QString::fromStdString(*it);
+    pointset_box_->addItem(is_cached.count(*it) ? name + " (cached)" : name, name);
+  }
+  showCurrentPointset();
+}
+
+void TopologicalMapPanel::showCurrentPointset()
+{
+  if (!topmap_man_ || topmap_man_->getController()->isSwitching()) {
+    return;
+  }
+  TopmapSnapshot::ConstPtr snapshot = topmap_man_->getController()->getSnapshot();
+  if (!snapshot) {
+    return;
+  }
+  QString pointset = QString::fromStdString(snapshot->getMap().pointset);
+  int index = pointset_box_->findData(pointset);
+  if (index < 0) {
+    pointset_box_->addItem(pointset + " (cached)", pointset);
+    index = pointset_box_->count() - 1;
+  } else if (pointset_box_->itemText(index) == pointset) {
+    pointset_box_->setItemText(index, pointset + " (cached)");
+  }
+  pointset_box_->setCurrentIndex(index);
+}
+
+void TopologicalMapPanel::onPointsetActivated(int index)
+{
+  if (!topmap_man_ || index < 0) {
+    return;
+  }
+  NodeController* controller = topmap_man_->getController();
+  std::string pointset = pointset_box_->itemData(index).toString().toStdString();
+  // edits queued against the old pointset would end up in the new one
+  if (bulkBusy()) {
+    showCurrentPointset();
+    return;
+  }
+  if (!controller->switchPointset(pointset)) {
+    showCurrentPointset();
+    return;
+  }
+  // The cached map may already be shown, but the map manager still serves
+  // the old one until it answers, so nothing can be edited until then.
+  setEditingEnabled(false);
+  pointset_box_->setEnabled(false);
+}
+
+void TopologicalMapPanel::onPointsetSwitched(bool success, const QString& message)
+{
+  setEditingEnabled(true);
+  pointset_box_->setEnabled(true);
+  if (!success) {
+    QMessageBox::warning(this, "Switching pointsets failed", message);
+  }
+  showCurrentPointset();
+}
+
+void TopologicalMapPanel::setEditingEnabled(bool enabled)
+{
+  add_tag_button_->setEnabled(enabled);
+  edit_button_->setEnabled(enabled);
+  remove_button_->setEnabled(enabled);
+  tag_view_->setEnabled(enabled);
+  overlap_view_->setEnabled(enabled);
+  properties_view_->setEditTriggers(enabled ? edit_triggers_ : QAbstractItemView::NoEditTriggers);
+}
+
+void TopologicalMapPanel::onPropertyExpanded(const QModelIndex& index)
+{
+  NodeProperty* node = owningNode(topmap_man_->getPropertyModel()->getProp(index));
+  if (!node) {
     return;
   }
+  // expanding a node opens it for good, expanding something inside it just
+  // counts as using it
+  if (node == topmap_man_->getPropertyModel()->getProp(index)) {
+    topmap_man_->getController()->setExpanded(node, true);
+  } else {
+    topmap_man_->getController()->useNode(node);
+  }
+}
+
+void TopologicalMapPanel::onPropertyCollapsed(const QModelIndex& index)
+{
+  rviz::Property* prop = topmap_man_->getPropertyModel()->getProp(index);
+  NodeProperty* node = qobject_cast<NodeProperty*>(prop);
+  if (node) {
+    topmap_man_->getController()->setExpanded(node, false);
+  }
+}
+
+void TopologicalMapPanel::onPropertySelectionChanged()
+{
+  QList<rviz::Property*> selected = properties_view_->getSelectedObjects<rviz::Property>();
+  std::vector<NodeProperty*> nodes;
+  for (int i = 0; i < selected.size(); i++) {
+    NodeProperty* node = owningNode(selected[i]);
+    if (node) {
+      nodes.push_back(node);
+    }
+  }
+  topmap_man_->getController()->setSelected(nodes);
+}
 
+void TopologicalMapPanel::updateMemoryStatus()
+{
+  if (!topmap_man_) {
+    return;
+  }
   NodeController* controller = topmap_man_->getController();
+  double mb = 1024 * 1024;
+  QString text = tr("Memory %1 MB, properties ~%2 MB")
+    .arg(residentMemory() / mb, 0, 'f', 0)
+    .arg(controller->getPropertyMemory() / mb, 0, 'f', 1);
+  if (controller->getMemoryBudget() > 0) {
+    text += tr(" of %1 MB").arg(memory_budget_mb_);
+  }
+  memory_status_->setText(text);
+
+  TopmapSnapshot::ConstPtr snapshot = controller->getSnapshot();
+  memory_status_->setToolTip(tr("Details of %1 of %2 nodes are loaded")
+			     .arg(controller->numMaterialized())
+			     .arg(snapshot ? int(snapshot->numNodes()) : 0));
+}
+
+void TopologicalMapPanel::getSelection(std::vector<std::string>* nodes,
+				       std::vector<std::string>* edges,
+				       std::vector<std::pair<std::string, std::string> >* tags)
+{
+  if (tabs_->currentWidget() == nodes_view_ || tabs_->currentWidget() == table_view_) {
+    QAbstractItemView* view = static_cast<QAbstractItemView*>(tabs_->currentWidget());
+    QModelIndexList rows = view->selectionModel()->selectedRows();
+    for (int i = 0; i < rows.size(); i++) {
+      // both models give the edge ID for edge rows only
+      QString edge_id = rows[i].data(TopmapItemModel::EdgeIdRole).toString();
+      if (!edge_id.isEmpty()) {
+	if (edges) {
+	  edges->push_back(edge_id.toStdString());
+	}
+      } else if (nodes) {
+	nodes->push_back(rows[i].data(TopmapItemModel::NodeNameRole).toString().toStdString());
+      }
+    }
+    return;
+  }
+
+  if (tabs_->currentWidget() == tag_view_) {
+    if (tags) {
+      tag_view_->getSelection(tags);
+    }
+    return;
+  }
+
+  if (nodes) {
+    QList<NodeProperty*> selected = properties_view_->getSelectedObjects<NodeProperty>();
+    for (int i = 0; i < selected.size(); i++) {
+      nodes->push_back(selected[i]->getValue().toString().toStdString());
+    }
+  }
+
+  if (edges) {
+    QList<EdgeProperty*> selected = properties_view_->getSelectedObjects<EdgeProperty>();
+    for (int i = 0; i < selected.size(); i++) {
+      edges->push_back(selected[i]->getEdgeId());
+    }
+  }
+
+  if (tags) {
+    QList<TagProperty*> selected = properties_view_->getSelectedObjects<TagProperty>();
+    for (int i = 0; i < selected.size(); i++) {
+      tags->push_back(std::make_pair(selected[i]->getStdString(), selected[i]->getNodeName()));
+    }
+  }
+}
+
+void TopologicalMapPanel::onDeleteClicked()
+{
+  std::vector<std::string> nodes_to_delete;
+  std::vector<std::string> edges_to_delete;
+  std::vector<std::pair<std::string, std::string> > tags_to_delete;
+  getSelection(&nodes_to_delete, &edges_to_delete, &tags_to_delete);
+
+  if (nodes_to_delete.size() + tags_to_delete.size() + edges_to_delete.size() == 0){
+    return;
+  }
 
   QMessageBox box;
   char* buf = new char[100];
-  sprintf(buf, "Delete %d nodes, %d edges and %d tags?", nodes_to_delete.size(), tags_to_delete.size(), edges_to_delete.size());
+  sprintf(buf, "Delete %d nodes, %d edges and %d tags?", (int)nodes_to_delete.size(), (int)edges_to_delete.size(), (int)tags_to_delete.size());
   std::string info_msg = buf;
   delete buf;
   
@@ -93,70 +476,216 @@ void TopologicalMapPanel::onDeleteClicked()
     return;
   }
   
-  for(int i = 0; i < nodes_to_delete.size(); i++) {
-    strands_navigation_msgs::RmvNode srv;
-    srv.request.name = nodes_to_delete[i]->getValue().toString().toStdString().c_str();
-    
-    if (delNodeSrv_.call(srv)) {
-      if (srv.response.success) {
-	ROS_INFO("Successfully removed node %s", srv.request.name.c_str());
-      } else {
-	ROS_INFO("Failed to remove node %s", srv.request.name.c_str());
-      }
-    } else {
-      ROS_INFO("Failed to get response from server to remove node %s", srv.request.name.c_str());
+  // Edges go with the node they belong to, so don't ask to remove those
+  // again, or edges which are not in the map any more.
+  const EdgeIndex& edge_index = topmap_man_->getController()->getEdgeIndex();
+  std::set<std::string> deleted_nodes(nodes_to_delete.begin(), nodes_to_delete.end());
+  std::vector<std::string> edges;
+  for(int i = 0; i < edges_to_delete.size(); i++) {
+    std::string node_name;
+    if (!edge_index.find(edges_to_delete[i], &node_name, NULL)) {
+      ROS_WARN("Edge %s is not in the map, not removing it", edges_to_delete[i].c_str());
+    } else if (!deleted_nodes.count(node_name)) {
+      edges.push_back(edges_to_delete[i]);
     }
   }
 
+  // the services take a list of nodes, so each tag is removed with one call
+  std::map<std::string, std::vector<std::string> > tag_nodes;
   for(int i = 0; i < tags_to_delete.size(); i++) {
-    strands_navigation_msgs::AddTag srv;
-    srv.request.tag = tags_to_delete[i]->getString().toStdString().c_str();
-    // go over all nodes in the controller and see which one this tag is from so
-    // we can extract the node name
-    std::string node_name;
-    for (int nd; nd < controller->numChildren(); nd++) {
-      if (controller->childAt(nd)->isAncestorOf(tags_to_delete[i])){
-	srv.request.node.push_back(controller->childAt(nd)->getValue().toString().toStdString());
-	break;
-      }
-    }
+    tag_nodes[tags_to_delete[i].first].push_back(tags_to_delete[i].second);
+  }
 
-    if (delTagSrv_.call(srv)) {
-      if (srv.response.success) {
-	ROS_INFO("Successfully removed tag %s from node %s", srv.request.tag.c_str(), srv.request.node[0].c_str());
-      } else {
-	ROS_INFO("Failed to remove tag %s from node %s", srv.request.tag.c_str(), srv.request.node[0].c_str());
-      }
-    } else {
-      ROS_INFO("Failed to get response from server to remove tag %s from node %s", srv.request.tag.c_str(), srv.request.node[0].c_str());
+  if (bulkBusy()) {
+    return;
+  }
+
+  // Tags and edges first, so that nothing they refer to is gone by the time
+  // they are removed. The nodes of each tag go together.
+  topological_rviz_tools::BatchEdit batch;
+  for(std::map<std::string, std::vector<std::string> >::iterator it = tag_nodes.begin(); it != tag_nodes.end(); ++it) {
+    for(int i = 0; i < it->second.size(); i++) {
+      addBatchEdit(&batch.request, topological_rviz_tools::BatchEditRequest::REMOVE_TAG, it->second[i], it->first);
     }
   }
+  for(int i = 0; i < edges.size(); i++) {
+    addBatchEdit(&batch.request, topological_rviz_tools::BatchEditRequest::REMOVE_EDGE, edges[i]);
+  }
+  for(int i = 0; i < nodes_to_delete.size(); i++) {
+    addBatchEdit(&batch.request, topological_rviz_tools::BatchEditRequest::REMOVE_NODE, nodes_to_delete[i]);
+  }
 
-  for(int i = 0; i < edges_to_delete.size(); i++) {
+  // Without the batch service, send the requests over several connections
+  // at once. Calls between barriers may finish in any order, so each kind
+  // is done separately, in the same order as in the batch.
+  bulk_.clear();
+
+  for(std::map<std::string, std::vector<std::string> >::iterator it = tag_nodes.begin(); it != tag_nodes.end(); ++it) {
+    strands_navigation_msgs::AddTag srv;
+    srv.request.tag = it->first;
+    srv.request.node = it->second;
+    std::stringstream description;
+    description << "remove tag " << it->first << " from " << it->second.size() << " nodes";
+    bulk_.add("/topological_map_manager/rm_tag_from_node", srv, description.str());
+  }
+  bulk_.barrier();
+
+  for(int i = 0; i < edges.size(); i++) {
     strands_navigation_msgs::AddEdge srv;
-    srv.request.edge_id = edges_to_delete[i]->getEdgeId().c_str();
+    srv.request.edge_id = edges[i];
+    bulk_.add("/topological_map_manager/remove_edge", srv, "remove edge " + edges[i]);
+  }
+  bulk_.barrier();
 
-    if (delEdgeSrv_.call(srv)) {
-      if (srv.response.success) {
-	ROS_INFO("Successfully removed edge %s", srv.request.edge_id.c_str());
+  for(int i = 0; i < nodes_to_delete.size(); i++) {
+    strands_navigation_msgs::RmvNode srv;
+    srv.request.name = nodes_to_delete[i];
+    bulk_.add("/topological_map_manager/remove_topological_node", srv, "remove node " + nodes_to_delete[i]);
+  }
 
-      } else {
-	ROS_INFO("Failed to remove edge %s", srv.request.edge_id.c_str());
-      }
-    } else {
-      ROS_INFO("Failed to get response from server to remove edge %s", srv.request.edge_id.c_str());
-    }
+  startBatchEdit(batch, tr("Delete"));
+}
+
+void TopologicalMapPanel::startBulk(const QString& action)
+{
+  if (bulk_.numQueued() == 0) {
+    return;
+  }
+
+  bulk_action_ = action;
+  bulk_cancelled_ = false;
+  bulk_progress_->setRange(0, bulk_.numQueued());
+  bulk_progress_->setValue(0);
+  bulk_progress_->setFormat(action + ": %v of %m");
+  bulk_progress_->show();
+  bulk_cancel_->setEnabled(true);
+  bulk_cancel_->show();
+  bulk_.start();
+  bulk_timer_->start();
+}
+
+bool TopologicalMapPanel::bulkBusy()
+{
+  if (!bulk_timer_->isActive() && !batch_thread_.joinable()) {
+    return false;
   }
+  QMessageBox::information(this, bulk_action_,
+			   tr("Still working on the last change to several items. Wait for it to finish or cancel it first."));
+  return true;
+}
 
-  // Update topological map only once after we remove all the stuff, to prevent
-  // update spam.
+void TopologicalMapPanel::onBulkProgress()
+{
+  if (!bulk_.wait(0)) {
+    bulk_progress_->setValue(bulk_.numDone());
+    return;
+  }
+
+  bulk_timer_->stop();
+  bulk_progress_->hide();
+  bulk_cancel_->hide();
+  // Update topological map only once after all the calls, to prevent update
+  // spam.
   updateTopMap();
+  showBulkSummary(bulk_cancelled_ ? tr("%1 (cancelled)").arg(bulk_action_) : bulk_action_);
+}
 
+void TopologicalMapPanel::onBulkCancel()
+{
+  ROS_INFO("Cancelling the remaining requests");
+  bulk_.cancel();
+  bulk_cancelled_ = true;
+  bulk_cancel_->setEnabled(false);
+}
+
+void TopologicalMapPanel::showBulkSummary(const QString& action)
+{
+  const std::vector<BulkExecutor::Result>& results = bulk_.getResults();
+  int failed = bulk_.numFailed();
+  ROS_INFO("%s: %d of %d requests succeeded", action.toStdString().c_str(), (int)results.size() - failed, (int)results.size());
+
+  QString details;
+  for (int i = 0; i < results.size(); i++) {
+    if (results[i].outcome != BulkExecutor::SUCCEEDED) {
+      details += QString("%1: %2\n").arg(QString::fromStdString(results[i].description))
+	.arg(BulkExecutor::outcomeName(results[i].outcome));
+    }
+  }
+
+  QMessageBox box;
+  box.setText(tr("%1: %2 of %3 requests succeeded.").arg(action).arg(results.size() - failed).arg(results.size()));
+  if (failed > 0) {
+    box.setIcon(QMessageBox::Warning);
+    box.setDetailedText(details);
+  }
+  box.exec();
+}
+
+void TopologicalMapPanel::addBatchEdit(topological_rviz_tools::BatchEditRequest* request, int operation,
+				       const std::string& target, const std::string& tag)
+{
+  request->operations.push_back(operation);
+  request->targets.push_back(target);
+  request->tags.push_back(tag);
+}
+
+void TopologicalMapPanel::startBatchEdit(const topological_rviz_tools::BatchEdit& srv, const QString& action)
+{
+  batch_ = srv;
+  bulk_action_ = action;
+  // the batch edit service does not say how far it has got
+  bulk_progress_->setRange(0, 0);
+  bulk_progress_->setFormat(action);
+  bulk_progress_->show();
+  batch_thread_ = boost::thread(boost::bind(&TopologicalMapPanel::callBatchEdit, this));
+}
+
+void TopologicalMapPanel::callBatchEdit()
+{
+  // the batch makes its edits one after the other, and may have to undo
+  // them, so it gets far longer than a single call
+  Q_EMIT batchEditSent(batchEditSrv_.call(batch_, BATCH_EDIT_TIMEOUT));
+}
+
+void TopologicalMapPanel::onBatchEditSent(int status)
+{
+  batch_thread_.join();
+  bulk_progress_->hide();
+  int count = batch_.request.operations.size();
+  if (status == ServiceConnection::NOT_CONNECTED) {
+    ROS_WARN("Batch edit service is not available, making %d edits one at a time", count);
+    startBulk(bulk_action_);
+    return;
+  }
+  bulk_.clear();
+
+  if (status != ServiceConnection::OK) {
+    // Some or all of the edits may have been made, so making them again one
+    // by one could do them twice. Show whatever the map is now instead.
+    ROS_WARN("No answer from the batch edit service: %s",
+	     ServiceConnection::statusName(static_cast<ServiceConnection::Status>(status)));
+    QMessageBox::warning(this, bulk_action_,
+			 tr("The map manager did not confirm the %1 edits. Some of them may have been made, "
+			    "check the map before trying again.").arg(count));
+  } else if (batch_.response.success) {
+    ROS_INFO("Successfully made %d edits", count);
+  } else {
+    ROS_WARN("Failed to make %d edits, map was left unchanged: %s", count, batch_.response.message.c_str());
+    QMessageBox::warning(this, bulk_action_,
+			 tr("The map manager could not make edit %1 of %2, so none of the edits were made.\n\n%3")
+			 .arg(batch_.response.failed + 1).arg(count)
+			 .arg(QString::fromStdString(batch_.response.message)));
+  }
+  updateTopMap();
 }
 
 void TopologicalMapPanel::onAddTagClicked()
 {
-  QList<NodeProperty*> nodes = properties_view_->getSelectedObjects<NodeProperty>();
+  std::vector<std::string> nodes;
+  getSelection(&nodes, NULL, NULL);
+  if (bulkBusy()) {
+    return;
+  }
 
   QString tag = QInputDialog::getText(this, tr("Add tag"),
 				      tr("Tag to add:"));
@@ -165,29 +694,138 @@ void TopologicalMapPanel::onAddTagClicked()
     return;
   }
 
+  topological_rviz_tools::BatchEdit batch;
+  for (int i = 0; i < nodes.size(); i++) {
+    addBatchEdit(&batch.request, topological_rviz_tools::BatchEditRequest::ADD_TAG, nodes[i], tag.toStdString());
+  }
+
+  // without the batch service, the tag is added to all nodes with one call
+  bulk_.clear();
   strands_navigation_msgs::AddTag srv;
-  srv.request.tag = tag.toStdString().c_str();
+  srv.request.tag = tag.toStdString();
+  srv.request.node = nodes;
+  std::stringstream description;
+  description << "add tag " << srv.request.tag << " to " << nodes.size() << " nodes";
+  bulk_.add("/topological_map_manager/add_tag_to_node", srv, description.str());
+
+  startBatchEdit(batch, tr("Add tag"));
+}
+  
 
-  for(int i = 0; i < nodes.size(); i++)
-  {
-    srv.request.node.push_back(nodes[i]->getValue().toString().toStdString().c_str());
-    if (nodes[i]->getTagController()->getHidden()){
-      nodes[i]->getTagController()->setHidden(false);
+void TopologicalMapPanel::onBulkEditClicked()
+{
+  TopmapSnapshot::ConstPtr snapshot = topmap_man_->getController()->getSnapshot();
+  if (!snapshot) {
+    return;
+  }
+
+  std::vector<std::string> node_names;
+  std::vector<std::string> edge_ids;
+  getSelection(&node_names, &edge_ids, NULL);
+
+  // Edge settings apply to the selected edges and to all edges of the
+  // selected nodes. The pointers stay valid while we hold the snapshot.
+  std::vector<const strands_navigation_msgs::TopologicalNode*> nodes;
+  std::vector<const strands_navigation_msgs::Edge*> edges;
+  std::set<std::string> seen_edges;
+  for (int i = 0; i < node_names.size(); i++) {
+    int ind = snapshot->findNode(node_names[i]);
+    if (ind < 0) {
+      continue;
+    }
+    const strands_navigation_msgs::TopologicalNode& node = snapshot->nodeAt(ind);
+    nodes.push_back(&node);
+    for (int j = 0; j < node.edges.size(); j++) {
+      if (seen_edges.insert(node.edges[j].edge_id).second) {
+	edges.push_back(&node.edges[j]);
+      }
     }
   }
 
-  if (addTagSrv_.call(srv)) {
-    if (srv.response.success) {
-      ROS_INFO("Successfully added tag \"%s\" to %d nodes", srv.request.tag.c_str(), nodes.size());
-      updateTopMap();
-    } else {
-      ROS_INFO("Failed to add tag \"%s\" to %d nodes: %s", srv.request.tag.c_str(), nodes.size(), srv.response.meta.c_str());
+  std::set<std::string> wanted_edges;
+  for (int i = 0; i < edge_ids.size(); i++) {
+    if (!seen_edges.count(edge_ids[i])) {
+      wanted_edges.insert(edge_ids[i]);
     }
-  } else {
-    ROS_WARN("Failed to get response from service to add tag \"%s\" to %d nodes", srv.request.tag.c_str(), nodes.size());
   }
+  const EdgeIndex& edge_index = topmap_man_->getController()->getEdgeIndex();
+  for (std::set<std::string>::iterator it = wanted_edges.begin(); it != wanted_edges.end(); ++it) {
+    std::string node_name;
+    int position;
+    if (!edge_index.find(*it, &node_name, &position)) {
+      continue;
+    }
+    int ind = snapshot->findNode(node_name);
+    if (ind >= 0) {
+      edges.push_back(&snapshot->nodeAt(ind).edges[position]);
+    }
+  }
+
+  if (nodes.empty() && edges.empty()) {
+    return;
+  }
+
+  BulkEdit initial;
+  if (!nodes.empty()) {
+    initial.yaw_tolerance = nodes[0]->yaw_goal_tolerance;
+    initial.xy_tolerance = nodes[0]->xy_goal_tolerance;
+  }
+  if (!edges.empty()) {
+    initial.top_vel = edges[0]->top_vel;
+    initial.action = edges[0]->action;
+  }
+
+  BulkEditDialog dialog(initial, nodes.size(), edges.size(), this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+  applyBulkEdit(dialog.getEdit(), nodes, edges);
+}
+
+void TopologicalMapPanel::applyBulkEdit(const BulkEdit& edit,
+					const std::vector<const strands_navigation_msgs::TopologicalNode*>& nodes,
+					const std::vector<const strands_navigation_msgs::Edge*>& edges)
+{
+  if (bulkBusy()) {
+    return;
+  }
+  bulk_.clear();
+
+  for (int i = 0; i < nodes.size() && edit.setsNodes(); i++) {
+    strands_navigation_msgs::UpdateNodeTolerance srv;
+    srv.request.node_name = nodes[i]->name;
+    srv.request.yaw_tolerance = edit.set_yaw_tolerance ? edit.yaw_tolerance : nodes[i]->yaw_goal_tolerance;
+    srv.request.xy_tolerance = edit.set_xy_tolerance ? edit.xy_tolerance : nodes[i]->xy_goal_tolerance;
+    if (srv.request.yaw_tolerance == nodes[i]->yaw_goal_tolerance
+	&& srv.request.xy_tolerance == nodes[i]->xy_goal_tolerance) {
+      continue;
+    }
+    bulk_.add("/topological_map_manager/update_node_tolerance", srv, "update tolerance of node " + nodes[i]->name);
+  }
+
+  for (int i = 0; i < edges.size() && edit.setsEdges(); i++) {
+    strands_navigation_msgs::UpdateEdge srv;
+    srv.request.edge_id = edges[i]->edge_id;
+    srv.request.top_vel = edit.set_top_vel ? edit.top_vel : edges[i]->top_vel;
+    srv.request.action = edit.set_action ? edit.action : edges[i]->action;
+    if (srv.request.top_vel == edges[i]->top_vel && srv.request.action == edges[i]->action) {
+      continue;
+    }
+    bulk_.add("/topological_map_manager/update_edge", srv, "update edge " + edges[i]->edge_id);
+  }
+
+  startBulk(tr("Edit selection"));
+}
+
+void TopologicalMapPanel::onMergeRequested()
+{
+  if (bulkBusy()) {
+    return;
+  }
+  bulk_.clear();
+  overlap_view_->queueMerge(&bulk_);
+  startBulk(tr("Merge nodes"));
 }
-  
 
 void TopologicalMapPanel::renameSelected()
 {
@@ -225,6 +863,129 @@ void TopologicalMapPanel::onCurrentChanged()
   // properties_view_->setAnimated(true);
 }
 
+void TopologicalMapPanel::onSearchChanged(const QString& text)
+{
+  if (!topmap_man_) {
+    return;
+  }
+
+  int matches = topmap_man_->setFilter(text);
+  if (text.trimmed().isEmpty()) {
+    search_status_->setText("");
+    return;
+  }
+  search_status_->setText(QString("%1 found").arg(matches));
+  tabs_->setCurrentWidget(nodes_view_);
+}
+
+void TopologicalMapPanel::onNodeActivated(const QModelIndex& index)
+{
+  int node_index = topmap_man_->getItemModel()->nodeOf(index);
+  if (node_index >= 0) {
+    jumpToNode(node_index);
+    // open the node for editing
+    tabs_->setCurrentWidget(properties_view_);
+  }
+}
+
+void TopologicalMapPanel::onTableActivated(const QModelIndex& index)
+{
+  int node_index = topmap_man_->getTableModel()->nodeOf(index);
+  if (node_index >= 0) {
+    jumpToNode(node_index);
+  }
+}
+
+void TopologicalMapPanel::jumpToNode(int node_index)
+{
+  NodeController* controller = topmap_man_->getController();
+  TopmapSnapshot::ConstPtr snapshot = controller->getSnapshot();
+  if (!snapshot || node_index >= controller->numChildren()) {
+    return;
+  }
+
+  // the controller children are in the same order as the snapshot
+  NodeProperty* node = static_cast<NodeProperty*>(controller->childAt(node_index));
+  controller->useNode(node);
+  QModelIndex prop_index = topmap_man_->getPropertyModel()->indexOf(node);
+  properties_view_->setCurrentIndex(prop_index);
+  properties_view_->scrollTo(prop_index);
+
+  if (!vis_manager_) {
+    return;
+  }
+  rviz::ViewController* view = vis_manager_->getViewManager()->getCurrent();
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  // node poses are in the map frame, which need not be the fixed frame
+  if (view && vis_manager_->getFrameManager()->transform("map", ros::Time(), snapshot->nodeAt(node_index).pose,
+							    position, orientation)) {
+    view->lookAt(position);
+  }
+}
+
+void TopologicalMapPanel::onMapUpdated()
+{
+  if (!topmap_man_->getController()->getLastTagChanges().empty()) {
+    tag_view_->refresh();
+  }
+
+  validation_view_->refresh();
+  int problems = validation_view_->numIssues();
+  tabs_->setTabText(tabs_->indexOf(validation_view_), problems ? QString("Problems (%1)").arg(problems) : "Problems");
+
+  onAnalysisUpdated();
+
+  statistics_view_->refresh();
+
+  // only a diff with the live map changes along with it
+  if (topmap_man_->getDiff().isActive()) {
+    diff_view_->refresh();
+  }
+  int changes = diff_view_->numChanges();
+  tabs_->setTabText(tabs_->indexOf(diff_view_), changes ? QString("Diff (%1)").arg(changes) : "Diff");
+
+  showCurrentPointset();
+}
+
+void TopologicalMapPanel::onAnalysisUpdated()
+{
+  overlap_view_->refresh();
+  int clusters = overlap_view_->numClusters();
+  tabs_->setTabText(tabs_->indexOf(overlap_view_), clusters ? QString("Overlaps (%1)").arg(clusters) : "Overlaps");
+}
+
+void TopologicalMapPanel::selectNodes(const QStringList& nodes)
+{
+  // nodes hidden by the search could not be selected
+  search_box_->clear();
+
+  TopmapItemModel* model = topmap_man_->getItemModel();
+  TopmapSnapshot::ConstPtr snapshot = model->getSnapshot();
+  if (!snapshot) {
+    return;
+  }
+
+  QItemSelection selection;
+  QModelIndex first;
+  for (int i = 0; i < nodes.size(); i++) {
+    QModelIndex index = model->nodeIndex(snapshot->findNode(nodes[i].toStdString()));
+    if (!index.isValid()) {
+      continue;
+    }
+    selection.select(index, index);
+    if (!first.isValid()) {
+      first = index;
+    }
+  }
+
+  nodes_view_->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+  tabs_->setCurrentWidget(nodes_view_);
+  if (first.isValid()) {
+    nodes_view_->scrollTo(first);
+  }
+}
+
 void TopologicalMapPanel::updateTopMap(){
   ROS_INFO("updating topmap");
   std_msgs::Time t;
@@ -236,12 +997,44 @@ void TopologicalMapPanel::save(rviz::Config config) const
 {
   rviz::Panel::save(config);
   properties_view_->save(config);
+  config.mapSetValue("Requests in flight", bulk_.getInFlight());
+  config.mapSetValue("Requests in flight while editing", bulk_share_);
+  config.mapSetValue("Property memory budget (MB)", memory_budget_mb_);
+  config.mapSetValue("Cached pointsets", cached_pointsets_);
+  config.mapSetValue("Service timeout", ServiceConnection::getDefaultTimeout());
 }
 
 void TopologicalMapPanel::load(const rviz::Config& config)
 {
   rviz::Panel::load(config);
   properties_view_->load(config);
+  int in_flight;
+  if (config.mapGetInt("Requests in flight", &in_flight)) {
+    bulk_.setInFlight(in_flight);
+  }
+  int share;
+  if (config.mapGetInt("Requests in flight while editing", &share)) {
+    bulk_share_ = share;
+  }
+  RequestScheduler::instance().setBulkLimits(bulk_.getInFlight(), bulk_share_);
+  int budget;
+  if (config.mapGetInt("Property memory budget (MB)", &budget) && budget >= 0) {
+    memory_budget_mb_ = budget;
+    if (topmap_man_) {
+      topmap_man_->getController()->setMemoryBudget(memory_budget_mb_ * size_t(1024 * 1024));
+    }
+  }
+  int cached;
+  if (config.mapGetInt("Cached pointsets", &cached) && cached >= 1) {
+    cached_pointsets_ = cached;
+    if (topmap_man_) {
+      topmap_man_->getController()->setCacheSize(cached_pointsets_);
+    }
+  }
+  float timeout;
+  if (config.mapGetFloat("Service timeout", &timeout) && timeout > 0) {
+    ServiceConnection::setDefaultTimeout(timeout);
+  }
 }
 
 } // namespace topological_rviz_tools
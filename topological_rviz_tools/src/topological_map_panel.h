@@ -3,8 +3,20 @@
 
 #include <cstdio>
 
+#include <boost/thread.hpp>
+
 #include "rviz/panel.h"
+#include "service_connection.h"
 #include "topmap_manager.h"
+#include "tag_view.h"
+#include "validation_view.h"
+#include "overlap_view.h"
+#include "statistics_view.h"
+#include "diff_view.h"
+#include "tree_state.h"
+#include "bulk_edit_dialog.h"
+#include "bulk_executor.h"
+#include "connection_indicator.h"
 #include "tag_property.h"
 #include "edge_property.h"
 #include "node_property.h"
@@ -16,12 +28,23 @@
 #include "strands_navigation_msgs/AddTag.h"
 #include "strands_navigation_msgs/AddEdge.h"
 #include "strands_navigation_msgs/RmvNode.h"
+#include "strands_navigation_msgs/UpdateEdge.h"
+#include "strands_navigation_msgs/UpdateNodeTolerance.h"
+#include "topological_rviz_tools/BatchEdit.h"
+#include "topological_rviz_tools/ListPointsets.h"
 
 class QComboBox;
+class QLabel;
+class QLineEdit;
 class QMessageBox;
 class QModelIndex;
+class QProgressBar;
 class QPushButton;
+class QTimer;
 class QInputDialog;
+class QTableView;
+class QTabWidget;
+class QTreeView;
 
 namespace topological_rviz_tools {
 /**
@@ -33,7 +56,7 @@ class TopologicalMapPanel: public rviz::Panel
 Q_OBJECT
 public:
   TopologicalMapPanel(QWidget* parent = 0);
-  virtual ~TopologicalMapPanel() {}
+  virtual ~TopologicalMapPanel();
 
   /** @brief Overridden from TopologicalMapPanel.  Just calls setMan() with vis_manager_->getTopmapManager(). */
   virtual void onInitialize();
@@ -56,21 +79,133 @@ public:
   /** @brief Save configuration data, specifically the PropertyTreeWidget view settings. */
   virtual void save(rviz::Config config) const;
 
+Q_SIGNALS:
+  /** @brief Emitted from the thread making a batch edit once the call
+   * returns, with its ServiceConnection::Status. */
+  void batchEditSent(int status);
+
 private Q_SLOTS:
   void onDeleteClicked();
   void onAddTagClicked();
+  void onBulkEditClicked();
+  void onMergeRequested();
   void renameSelected();
   void onCurrentChanged();
   void updateTopMap();
+  void onSearchChanged(const QString& text);
+  void onNodeActivated(const QModelIndex& index);
+  void onTableActivated(const QModelIndex& index);
+  void onMapUpdated();
+  /** @brief Show the overlaps found by the map manager. */
+  void onAnalysisUpdated();
+  void selectNodes(const QStringList& nodes);
+  /** @brief Show how far the bulk job has got, and wrap it up once done. */
+  void onBulkProgress();
+  void onBulkCancel();
+  /** @brief Report how the batch edit went, or start the calls queued on
+   * bulk_ instead if there is no batch edit service. */
+  void onBatchEditSent(int status);
+  /** @brief Build the properties of nodes as they are expanded or
+   * selected, when there is a memory budget. */
+  void onPropertyExpanded(const QModelIndex& index);
+  void onPropertyCollapsed(const QModelIndex& index);
+  void onPropertySelectionChanged();
+  void updateMemoryStatus();
+  /** @brief Fill the pointset box with the pointsets in the database and
+   * the ones which are cached. */
+  void refreshPointsets();
+  void onPointsetActivated(int index);
+  void onPointsetSwitched(bool success, const QString& message);
 private:
-  ros::ServiceClient delNodeSrv_;
-  ros::ServiceClient delTagSrv_;
-  ros::ServiceClient delEdgeSrv_;
-  ros::ServiceClient addTagSrv_;
+  /** @brief Select the node at @a node_index in the display order in the
+   * property tree, and centre the 3D view on it. */
+  void jumpToNode(int node_index);
+
+  /** @brief Send the requests to apply @a edit to @a nodes and @a edges, and
+   * refresh the map once when done. Requests which would not change anything
+   * are skipped. */
+  void applyBulkEdit(const BulkEdit& edit,
+		     const std::vector<const strands_navigation_msgs::TopologicalNode*>& nodes,
+		     const std::vector<const strands_navigation_msgs::Edge*>& edges);
+
+  void addBatchEdit(topological_rviz_tools::BatchEditRequest* request, int operation,
+		    const std::string& target, const std::string& tag = std::string());
+
+  /** @brief Make the edits in @a srv in one go, all or nothing, in the
+   * background. The same edits should be queued on bulk_ beforehand; those
+   * calls are only made if the batch edit service is not advertised. Counts
+   * as a bulk job under @a action while it runs. */
+  void startBatchEdit(const topological_rviz_tools::BatchEdit& srv, const QString& action);
+  void callBatchEdit();
+
+  /** @brief Make the calls queued on bulk_ in the background, showing
+   * progress in the panel. The map is refreshed and a summary shown under
+   * @a action once they are done. The panel stays usable meanwhile, and
+   * edits made by hand go ahead of the queued calls. */
+  void startBulk(const QString& action);
+
+  /** @brief True while a bulk job or batch edit is running. Only one runs at a time, so
+   * this tells the user to wait if it is. */
+  bool bulkBusy();
+
+  /** @brief Show how many of the calls made by bulk_ succeeded, with the
+   * failures in the details. */
+  void showBulkSummary(const QString& action);
+
+  /** @brief Collect the names of the nodes, IDs of the edges and (tag, node)
+   * pairs selected in the view which is currently shown. Any of the
+   * arguments may be null. */
+  void getSelection(std::vector<std::string>* nodes,
+		    std::vector<std::string>* edges,
+		    std::vector<std::pair<std::string, std::string> >* tags);
+
+  /** @brief Allow or prevent edits from the panel, e.g. while the map shown
+   * is not yet the one the map manager serves. */
+  void setEditingEnabled(bool enabled);
+
+  /** @brief Select the pointset of the map which is shown in the pointset
+   * box, adding it if needed. */
+  void showCurrentPointset();
+
+  ServiceConnection batchEditSrv_;
+  // the batch edit being made, and the thread making it
+  topological_rviz_tools::BatchEdit batch_;
+  boost::thread batch_thread_;
+  ServiceConnection listPointsetsSrv_;
+  // makes the calls of edits to many items one by one
+  BulkExecutor bulk_;
+  // bulk calls allowed in flight while edits are being made by hand
+  int bulk_share_;
+  QString bulk_action_;
+  bool bulk_cancelled_;
+  QTimer* bulk_timer_;
+  QProgressBar* bulk_progress_;
+  QPushButton* bulk_cancel_;
   ros::Publisher update_map_;
 
   TopmapManager* topmap_man_;
   rviz::PropertyTreeWidget* properties_view_;
+  QTreeView* nodes_view_;
+  QTableView* table_view_;
+  TagView* tag_view_;
+  ValidationView* validation_view_;
+  OverlapView* overlap_view_;
+  StatisticsView* statistics_view_;
+  DiffView* diff_view_;
+  QTabWidget* tabs_;
+  QLineEdit* search_box_;
+  QLabel* search_status_;
+  QLabel* memory_status_;
+  QComboBox* pointset_box_;
+  QPushButton* add_tag_button_;
+  QPushButton* edit_button_;
+  QPushButton* remove_button_;
+  // edit triggers of the property tree, restored once editing is allowed
+  QAbstractItemView::EditTriggers edit_triggers_;
+  // only the properties of the nodes in view are built when above 0
+  int memory_budget_mb_;
+  // number of pointsets whose maps are kept for switching back quickly
+  int cached_pointsets_;
 };
 
 } // namespace topological_rviz_tools
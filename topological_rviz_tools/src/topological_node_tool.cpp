@@ -51,7 +51,7 @@ TopmapNodeTool::~TopmapNodeTool()
 void TopmapNodeTool::onInitialize()
 {
   ros::NodeHandle nh;
-  addNodeSrv_ = nh.serviceClient<strands_navigation_msgs::AddNode>("/topological_map_manager/add_topological_node", true);
+  addNodeSrv_ = ServiceConnection::create<strands_navigation_msgs::AddNode>("/topological_map_manager/add_topological_node");
   update_map_ = nh.advertise<std_msgs::Time>("/update_map", 5);
 }
 
@@ -6,6 +6,7 @@
 #include "geometry_msgs/Pose.h"
 #include "std_msgs/Time.h"
 #include "strands_navigation_msgs/AddNode.h"
+#include "service_connection.h"
 
 namespace rviz
 {
@@ -35,7 +36,7 @@ public:
 
   virtual int processMouseEvent(rviz::ViewportMouseEvent& event);
 private:
-  ros::ServiceClient addNodeSrv_;
+  ServiceConnection addNodeSrv_;
   ros::Publisher update_map_;
 };
 } // end namespace topological_rviz_tools
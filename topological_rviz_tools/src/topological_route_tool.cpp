@@ -0,0 +1,195 @@
+#include <OGRE/OgrePlane.h>
+#include <OGRE/OgreVector3.h>
+
+#include <ros/console.h>
+
+#include <rviz/viewport_mouse_event.h>
+#include <rviz/geometry.h>
+
+#include "shared_map.h"
+#include "topological_route_tool.h"
+
+namespace topological_rviz_tools
+{
+
+namespace
+{
+// how far from a node a click may be to pick it, in metres
+const double MAX_PICK_DISTANCE = 5.0;
+}
+
+TopmapRouteTool::TopmapRouteTool()
+  : grid_(MAX_PICK_DISTANCE)
+  , shown_goal_(-1)
+  , goal_fixed_(false)
+{
+  shortcut_key_ = 'r';
+}
+
+TopmapRouteTool::~TopmapRouteTool()
+{
+}
+
+void TopmapRouteTool::onInitialize()
+{
+  ros::NodeHandle nh;
+  markerPub_ = nh.advertise<visualization_msgs::MarkerArray>("route_tool_markers", 1);
+  connect(&SharedMap::instance(), SIGNAL(mapChanged()), this, SLOT(onMapChanged()));
+  onMapChanged();
+}
+
+void TopmapRouteTool::activate()
+{
+  if (!SharedMap::instance().getSnapshot()) {
+    ROS_WARN("The route tool uses the map shown in the topological map panel, which has no map yet");
+  }
+}
+
+void TopmapRouteTool::deactivate()
+{
+  clear();
+}
+
+void TopmapRouteTool::onMapChanged()
+{
+  // If a map was missed, the revisions don't line up and both rebuild.
+  TopmapSnapshot::ConstPtr snapshot = SharedMap::instance().getSnapshot();
+  const TopmapDelta& delta = SharedMap::instance().getLastDelta();
+  planner_.update(snapshot, delta);
+  grid_.update(snapshot, delta);
+  if (!snapshot) {
+    if (!start_.empty()) {
+      clear();
+    }
+    return;
+  }
+
+  // redraw whatever is shown on the new map
+  if (!start_.empty()) {
+    shown_goal_ = -1;
+    showRoute(goal_.empty() ? -1 : snapshot->findNode(goal_));
+  }
+}
+
+bool TopmapRouteTool::showRoute(int goal)
+{
+  TopmapSnapshot::ConstPtr snapshot = planner_.getSnapshot();
+  int start = snapshot ? snapshot->findNode(start_) : -1;
+  if (start < 0) {
+    clear();
+    return false;
+  }
+
+  visualization_msgs::Marker start_marker;
+  start_marker.header.frame_id = "map";
+  start_marker.ns = "route_tool_markers";
+  start_marker.id = 0;
+  start_marker.type = visualization_msgs::Marker::SPHERE;
+  start_marker.pose = snapshot->nodeAt(start).pose;
+  start_marker.scale.x = start_marker.scale.y = start_marker.scale.z = 0.5;
+  start_marker.color.a = 1.0;
+  start_marker.color.b = 1.0;
+
+  visualization_msgs::Marker route_marker;
+  route_marker.header.frame_id = "map";
+  route_marker.ns = "route_tool_markers";
+  route_marker.id = 1;
+  route_marker.type = visualization_msgs::Marker::LINE_STRIP;
+  route_marker.pose.orientation.w = 1.0;
+  route_marker.scale.x = 0.15;
+  route_marker.color.a = 1.0;
+  route_marker.color.g = 1.0;
+  route_marker.color.b = 1.0;
+
+  std::vector<int> route;
+  double cost = 0;
+  bool found = goal >= 0 && planner_.route(start, goal, &route, &cost);
+  for (int i = 0; found && i < route.size(); i++) {
+    geometry_msgs::Point point = snapshot->nodeAt(route[i]).pose.position;
+    // lift the line above the edge arrows
+    point.z += 0.1;
+    route_marker.points.push_back(point);
+  }
+  if (route_marker.points.size() < 2) {
+    route_marker.action = visualization_msgs::Marker::DELETE;
+  }
+
+  visualization_msgs::MarkerArray markers;
+  markers.markers.push_back(start_marker);
+  markers.markers.push_back(route_marker);
+  markerPub_.publish(markers);
+  shown_goal_ = goal;
+
+  if (goal >= 0 && goal_fixed_) {
+    if (found) {
+      ROS_INFO("Route from %s to %s: %d edges, %.1fs", start_.c_str(), goal_.c_str(), int(route.size()) - 1, cost);
+    } else {
+      ROS_INFO("No route from %s to %s", start_.c_str(), goal_.c_str());
+    }
+  }
+  return found;
+}
+
+void TopmapRouteTool::clear()
+{
+  start_.clear();
+  goal_.clear();
+  shown_goal_ = -1;
+  goal_fixed_ = false;
+
+  visualization_msgs::Marker marker;
+  marker.header.frame_id = "map";
+  marker.ns = "route_tool_markers";
+  marker.action = visualization_msgs::Marker::DELETE;
+  visualization_msgs::MarkerArray markers;
+  for (marker.id = 0; marker.id < 2; marker.id++) {
+    markers.markers.push_back(marker);
+  }
+  markerPub_.publish(markers);
+}
+
+int TopmapRouteTool::processMouseEvent(rviz::ViewportMouseEvent& event)
+{
+  if (event.rightDown()) {
+    clear();
+    return Render;
+  }
+
+  Ogre::Vector3 intersection;
+  Ogre::Plane ground_plane(Ogre::Vector3::UNIT_Z, 0.0f);
+  if (!rviz::getPointOnPlaneFromWindowXY(event.viewport, ground_plane, event.x, event.y, intersection)) {
+    return Render;
+  }
+  int node = grid_.nearest(intersection.x, intersection.y, MAX_PICK_DISTANCE);
+  TopmapSnapshot::ConstPtr snapshot = planner_.getSnapshot();
+
+  if (event.leftDown()) {
+    if (node < 0) {
+      return Render;
+    }
+    if (start_.empty() || goal_fixed_) {
+      // start over from the clicked node
+      goal_.clear();
+      goal_fixed_ = false;
+      start_ = snapshot->nodeAt(node).name;
+      showRoute(-1);
+    } else {
+      goal_ = snapshot->nodeAt(node).name;
+      goal_fixed_ = true;
+      showRoute(node);
+    }
+    return Render;
+  }
+
+  // while hovering, follow the node under the cursor
+  if (!start_.empty() && !goal_fixed_ && node != shown_goal_) {
+    goal_ = node < 0 ? std::string() : snapshot->nodeAt(node).name;
+    showRoute(node);
+  }
+  return Render;
+}
+
+} // end namespace topological_rviz_tools
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_EXPORT_CLASS(topological_rviz_tools::TopmapRouteTool,rviz::Tool)
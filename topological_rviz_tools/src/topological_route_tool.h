@@ -0,0 +1,63 @@
+#ifndef TOPMAP_ROUTE_TOOL_H
+#define TOPMAP_ROUTE_TOOL_H
+
+#include <ros/ros.h>
+#include <rviz/tool.h>
+#include <visualization_msgs/MarkerArray.h>
+
+#include "node_grid.h"
+#include "route_planner.h"
+
+namespace rviz
+{
+class ViewportMouseEvent;
+}
+
+namespace topological_rviz_tools
+{
+
+/** @brief Tool which shows the fastest route between two nodes.
+ *
+ * Click a node to start from, then move the mouse over the map to see the
+ * route to the node under the cursor. Clicking again keeps that route shown,
+ * and a further click starts over from another node. Right click clears.
+ *
+ * The map is the one shown in the panel, so the tool needs the topological
+ * map panel to be open. */
+class TopmapRouteTool: public rviz::Tool
+{
+Q_OBJECT
+public:
+  TopmapRouteTool();
+  ~TopmapRouteTool();
+
+  virtual void onInitialize();
+
+  virtual void activate();
+  virtual void deactivate();
+
+  virtual int processMouseEvent(rviz::ViewportMouseEvent& event);
+
+private Q_SLOTS:
+  void onMapChanged();
+
+private:
+  /** @brief Show the route from start_ to @a goal, or just the start if
+   * @a goal is -1. Returns true if there is a route. */
+  bool showRoute(int goal);
+  void clear();
+
+  ros::Publisher markerPub_;
+  RoutePlanner planner_;
+  // node positions, to find the node under the cursor
+  NodeGrid grid_;
+  // nodes are kept by name, as their indices change with the map
+  std::string start_;
+  std::string goal_;
+  // goal the route is currently shown to, to skip redrawing while hovering
+  int shown_goal_;
+  bool goal_fixed_;
+};
+} // end namespace topological_rviz_tools
+
+#endif // TOPMAP_ROUTE_TOOL_H
@@ -0,0 +1,96 @@
+#include "tree_state.h"
+
+#include <QItemSelection>
+#include <QItemSelectionModel>
+#include <QTreeView>
+
+#include "topmap_item_model.h"
+
+namespace topological_rviz_tools
+{
+
+TreeState::TreeState(QTreeView* view, TopmapItemModel* model)
+  : QObject(view)
+  , view_(view)
+  , model_(model)
+{
+  connect(model_, SIGNAL(modelAboutToBeReset()), this, SLOT(save()));
+  connect(model_, SIGNAL(modelReset()), this, SLOT(restore()));
+}
+
+TreeState::Key TreeState::keyOf(const QModelIndex& index) const
+{
+  if (!index.isValid()) {
+    return Key();
+  }
+  return Key(index.data(TopmapItemModel::NodeNameRole).toString().toStdString(),
+	     index.data(TopmapItemModel::EdgeIdRole).toString().toStdString());
+}
+
+QModelIndex TreeState::find(const Key& key) const
+{
+  TopmapSnapshot::ConstPtr snapshot = model_->getSnapshot();
+  if (key.first.empty() || !snapshot) {
+    return QModelIndex();
+  }
+
+  if (key.second.empty()) {
+    return model_->nodeIndex(snapshot->findNode(key.first));
+  }
+  return model_->edgeIndex(key.second);
+}
+
+void TreeState::save()
+{
+  expanded_.clear();
+  selected_.clear();
+  if (!model_->getSnapshot()) {
+    return;
+  }
+
+  // only nodes have children
+  for (int i = 0; i < model_->rowCount(); i++) {
+    QModelIndex index = model_->index(i, 0);
+    if (view_->isExpanded(index)) {
+      expanded_.push_back(keyOf(index));
+    }
+  }
+
+  QModelIndexList selected = view_->selectionModel()->selectedRows();
+  for (int i = 0; i < selected.size(); i++) {
+    selected_.push_back(keyOf(selected[i]));
+  }
+
+  current_ = keyOf(view_->currentIndex());
+  top_ = keyOf(view_->indexAt(QPoint(0, 0)));
+}
+
+void TreeState::restore()
+{
+  for (int i = 0; i < expanded_.size(); i++) {
+    QModelIndex index = find(expanded_[i]);
+    if (index.isValid()) {
+      view_->setExpanded(index, true);
+    }
+  }
+
+  QItemSelection selection;
+  for (int i = 0; i < selected_.size(); i++) {
+    QModelIndex index = find(selected_[i]);
+    if (index.isValid()) {
+      selection.select(index, index);
+    }
+  }
+  view_->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+
+  QModelIndex current = find(current_);
+  if (current.isValid()) {
+    view_->selectionModel()->setCurrentIndex(current, QItemSelectionModel::NoUpdate);
+  }
+  QModelIndex top = find(top_);
+  if (top.isValid()) {
+    view_->scrollTo(top, QAbstractItemView::PositionAtTop);
+  }
+}
+
+} // end namespace topological_rviz_tools
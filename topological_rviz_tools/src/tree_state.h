@@ -0,0 +1,52 @@
+#ifndef TREE_STATE_H
+#define TREE_STATE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QModelIndex>
+#include <QObject>
+
+class QTreeView;
+
+namespace topological_rviz_tools
+{
+
+class TopmapItemModel;
+
+/** @brief Keeps the expanded and selected rows of a view on a
+ * TopmapItemModel, and the row it is scrolled to, across model resets.
+ *
+ * Rows are remembered by node name and edge_id rather than by position, so
+ * they are found again in the new map even if rows were added or removed
+ * around them. Incremental updates don't need this, as the view keeps its
+ * state through them by itself. */
+class TreeState: public QObject
+{
+Q_OBJECT
+public:
+  TreeState(QTreeView* view, TopmapItemModel* model);
+
+private Q_SLOTS:
+  void save();
+  void restore();
+
+private:
+  // node name, and edge_id for edge rows or empty for node rows
+  typedef std::pair<std::string, std::string> Key;
+
+  Key keyOf(const QModelIndex& index) const;
+  QModelIndex find(const Key& key) const;
+
+  QTreeView* view_;
+  TopmapItemModel* model_;
+  std::vector<Key> expanded_;
+  std::vector<Key> selected_;
+  Key current_;
+  Key top_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // TREE_STATE_H
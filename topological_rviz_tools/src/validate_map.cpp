@@ -0,0 +1,54 @@
+// Command line check of topological map files, for use without rviz or a
+// running map manager, e.g. in CI:
+//
+//   rosrun topological_rviz_tools validate_topological_map map.tmap [...]
+//
+// Prints every problem found and exits with 1 if there were any, or 2 if a
+// file could not be read.
+
+#include <iostream>
+
+#include <yaml-cpp/yaml.h>
+
+#include "map_file.h"
+#include "map_validator.h"
+
+using namespace topological_rviz_tools;
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " MAP_FILE..." << std::endl;
+    return 2;
+  }
+
+  int status = 0;
+  for (int i = 1; i < argc; i++) {
+    strands_navigation_msgs::TopologicalMap::Ptr map;
+    try {
+      map = readMapFile(argv[i]);
+    } catch (const YAML::Exception& e) {
+      std::cerr << argv[i] << ": " << e.what() << std::endl;
+      status = 2;
+      continue;
+    }
+
+    TopmapSnapshot::ConstPtr snapshot(new TopmapSnapshot(map, 1));
+    MapValidator validator;
+    validator.update(snapshot, TopmapSnapshot::diff(NULL, *snapshot));
+
+    std::vector<MapValidator::Issue> issues = validator.getIssues();
+    for (int j = 0; j < issues.size(); j++) {
+      std::cout << argv[i] << ": " << issues[j].node;
+      if (!issues[j].edge_id.empty()) {
+	std::cout << " [" << issues[j].edge_id << "]";
+      }
+      std::cout << ": " << MapValidator::ruleName(issues[j].rule) << ": " << issues[j].message << std::endl;
+    }
+    std::cout << argv[i] << ": " << snapshot->numNodes() << " nodes, " << issues.size() << " problems" << std::endl;
+    if (!issues.empty() && status == 0) {
+      status = 1;
+    }
+  }
+  return status;
+}
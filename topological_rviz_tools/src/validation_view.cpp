@@ -0,0 +1,71 @@
+#include "validation_view.h"
+
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+
+namespace topological_rviz_tools
+{
+
+ValidationView::ValidationView(QWidget* parent)
+  : QWidget(parent)
+  , validator_(NULL)
+{
+  tree_ = new QTreeWidget();
+  tree_->setColumnCount(4);
+  tree_->setHeaderLabels(QStringList() << "Node" << "Problem" << "Edge" << "Detail");
+  tree_->setRootIsDecorated(false);
+  tree_->setUniformRowHeights(true);
+
+  QVBoxLayout* main_layout = new QVBoxLayout;
+  main_layout->setContentsMargins(0,0,0,0);
+  main_layout->addWidget(tree_);
+  setLayout(main_layout);
+
+  connect(tree_, SIGNAL(itemActivated(QTreeWidgetItem*, int)), this, SLOT(onItemActivated(QTreeWidgetItem*)));
+}
+
+void ValidationView::setValidator(const MapValidator* validator)
+{
+  validator_ = validator;
+  refresh();
+}
+
+void ValidationView::refresh()
+{
+  std::vector<MapValidator::Issue> issues;
+  if (validator_) {
+    issues = validator_->getIssues();
+  }
+
+  // Both lists are sorted, so walk them together, dropping rows which are no
+  // longer there and inserting the new ones in place.
+  int row = 0;
+  int i = 0;
+  while (row < shown_.size() || i < issues.size()) {
+    if (row < shown_.size() && i < issues.size() && shown_[row] == issues[i]) {
+      row++;
+      i++;
+    } else if (row < shown_.size() && (i == issues.size() || !(issues[i] < shown_[row]))) {
+      delete tree_->takeTopLevelItem(row);
+      shown_.erase(shown_.begin() + row);
+    } else {
+      const MapValidator::Issue& issue = issues[i];
+      tree_->insertTopLevelItem(row, new QTreeWidgetItem(QStringList()
+							  << QString::fromStdString(issue.node)
+							  << MapValidator::ruleName(issue.rule)
+							  << QString::fromStdString(issue.edge_id)
+							  << QString::fromStdString(issue.message)));
+      shown_.insert(shown_.begin() + row, issue);
+      row++;
+      i++;
+    }
+  }
+}
+
+void ValidationView::onItemActivated(QTreeWidgetItem* item)
+{
+  Q_EMIT selectNodes(QStringList() << item->text(0));
+}
+
+} // end namespace topological_rviz_tools
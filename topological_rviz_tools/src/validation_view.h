@@ -0,0 +1,52 @@
+#ifndef VALIDATION_VIEW_H
+#define VALIDATION_VIEW_H
+
+#include <vector>
+
+#include <QStringList>
+#include <QWidget>
+
+#include "map_validator.h"
+
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace topological_rviz_tools
+{
+
+/** @brief Lists the problems found by a MapValidator. Activating a problem
+ * asks for its node to be selected. */
+class ValidationView: public QWidget
+{
+Q_OBJECT
+public:
+  ValidationView(QWidget* parent = 0);
+
+  /** @brief Set the validator to display. It must outlive the view. */
+  void setValidator(const MapValidator* validator);
+
+  int numIssues() const { return shown_.size(); }
+
+public Q_SLOTS:
+  /** @brief Bring the list in line with the validator. Rows for problems
+   * which are still there are kept, so the selection and scroll position
+   * survive. */
+  void refresh();
+
+Q_SIGNALS:
+  /** @brief Emitted when the user asks to select the nodes in @a nodes. */
+  void selectNodes(const QStringList& nodes);
+
+private Q_SLOTS:
+  void onItemActivated(QTreeWidgetItem* item);
+
+private:
+  const MapValidator* validator_;
+  QTreeWidget* tree_;
+  // issues in the order of the rows
+  std::vector<MapValidator::Issue> shown_;
+};
+
+} // end namespace topological_rviz_tools
+
+#endif // VALIDATION_VIEW_H
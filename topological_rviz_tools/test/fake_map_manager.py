@@ -0,0 +1,28 @@
+#!/usr/bin/env python
+"""Stand-in for the map manager's removal service, for measuring throughput.
+
+Every call sleeps for ~delay seconds before answering, which is roughly what
+the real map manager spends writing to the database. Like the real one it
+is a rospy service, which serves each connection on its own thread.
+
+"""
+
+import rospy
+from strands_navigation_msgs.srv import RmvNode, RmvNodeResponse
+
+
+class FakeMapManager(object):
+
+    def __init__(self):
+        rospy.init_node("topological_map_manager")
+        self.delay = rospy.get_param("~delay", 0.05)
+        self.remove_srv = rospy.Service("~remove_topological_node", RmvNode, self.remove_node)
+
+    def remove_node(self, req):
+        rospy.sleep(self.delay)
+        return RmvNodeResponse(True)
+
+
+if __name__ == '__main__':
+    FakeMapManager()
+    rospy.spin()
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+
+#include "edge_index.h"
+
+using namespace topological_rviz_tools;
+
+namespace
+{
+typedef strands_navigation_msgs::TopologicalMap Map;
+
+strands_navigation_msgs::TopologicalNode makeNode(const std::string& name)
+{
+  strands_navigation_msgs::TopologicalNode node;
+  node.name = name;
+  return node;
+}
+
+void addEdge(strands_navigation_msgs::TopologicalNode* node, const std::string& to, const std::string& edge_id)
+{
+  strands_navigation_msgs::Edge edge;
+  edge.edge_id = edge_id;
+  edge.node = to;
+  node->edges.push_back(edge);
+}
+
+/** @brief Check that @a index finds every edge of @a snapshot and nothing
+ * else, and lists the same incoming edges. */
+void expectIndexes(const EdgeIndex& index, const TopmapSnapshot& snapshot)
+{
+  std::set<std::string> ids;
+  for (int i = 0; i < snapshot.numNodes(); i++) {
+    const strands_navigation_msgs::TopologicalNode& node = snapshot.nodeAt(i);
+    for (int j = 0; j < node.edges.size(); j++) {
+      const std::string& edge_id = node.edges[j].edge_id;
+      ids.insert(edge_id);
+      std::string found_node;
+      int position;
+      ASSERT_TRUE(index.find(edge_id, &found_node, &position)) << edge_id;
+      // with a shared ID, any of the edges will do, as long as it has the ID
+      int found = snapshot.findNode(found_node);
+      ASSERT_GE(found, 0) << edge_id;
+      ASSERT_LT(position, snapshot.nodeAt(found).edges.size()) << edge_id;
+      EXPECT_EQ(edge_id, snapshot.nodeAt(found).edges[position].edge_id);
+    }
+  }
+  EXPECT_EQ(ids.size(), index.size());
+
+  EdgeIndex full;
+  full.update(NULL, snapshot, TopmapSnapshot::diff(NULL, snapshot));
+  for (int i = 0; i < snapshot.numNodes(); i++) {
+    const std::string& name = snapshot.nodeAt(i).name;
+    std::vector<EdgeIndex::IncomingEdge> expected = full.incoming(name);
+    std::vector<EdgeIndex::IncomingEdge> actual = index.incoming(name);
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual) << name;
+  }
+}
+}
+
+TEST(EdgeIndex, KeepsSharedIdWhenOneOwnerGoes)
+{
+  Map::Ptr map(new Map);
+  map->nodes.push_back(makeNode("a"));
+  map->nodes.push_back(makeNode("b"));
+  map->nodes.push_back(makeNode("c"));
+  addEdge(&map->nodes[0], "c", "shared");
+  addEdge(&map->nodes[1], "c", "shared");
+  TopmapSnapshot::ConstPtr before(new TopmapSnapshot(map, 1));
+  EdgeIndex index;
+  index.update(NULL, *before, TopmapSnapshot::diff(NULL, *before));
+
+  // remove whichever node the index found last
+  std::string owner;
+  ASSERT_TRUE(index.find("shared", &owner, NULL));
+  Map::Ptr next(new Map(*map));
+  next->nodes.erase(next->nodes.begin() + (owner == "a" ? 0 : 1));
+  TopmapSnapshot::ConstPtr after(new TopmapSnapshot(next, 2));
+  index.update(before.get(), *after, TopmapSnapshot::diff(before.get(), *after));
+
+  std::string remaining;
+  int position;
+  ASSERT_TRUE(index.find("shared", &remaining, &position));
+  EXPECT_NE(owner, remaining);
+  EXPECT_EQ(0, position);
+  EXPECT_EQ(1u, index.incoming("c").size());
+}
+
+TEST(EdgeIndex, IncrementalMatchesMap)
+{
+  srand(2);
+  const int num_nodes = 300;
+  Map::Ptr map(new Map);
+  for (int i = 0; i < num_nodes; i++) {
+    char name[32];
+    sprintf(name, "WayPoint%d", i);
+    map->nodes.push_back(makeNode(name));
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    for (int j = 0; j < 2; j++) {
+      char edge_id[32];
+      // a small pool of IDs, so that many are shared
+      sprintf(edge_id, "edge%d", rand() % (num_nodes / 2));
+      addEdge(&map->nodes[i], map->nodes[rand() % num_nodes].name, edge_id);
+    }
+  }
+
+  unsigned int revision = 1;
+  TopmapSnapshot::ConstPtr snapshot(new TopmapSnapshot(map, revision++));
+  EdgeIndex index;
+  index.update(NULL, *snapshot, TopmapSnapshot::diff(NULL, *snapshot));
+
+  for (int step = 0; step < 200; step++) {
+    Map::Ptr next(new Map(*map));
+    int node = rand() % next->nodes.size();
+    switch (rand() % 3) {
+    case 0:
+      next->nodes.erase(next->nodes.begin() + node);
+      break;
+    case 1:
+      next->nodes[node].name += "r";
+      break;
+    default:
+      char edge_id[32];
+      sprintf(edge_id, "edge%d", rand() % (num_nodes / 2));
+      addEdge(&next->nodes[node], next->nodes[rand() % next->nodes.size()].name, edge_id);
+      if (rand() % 2) {
+	next->nodes[node].edges.erase(next->nodes[node].edges.begin());
+      }
+    }
+
+    TopmapSnapshot::ConstPtr next_snapshot(new TopmapSnapshot(next, revision++));
+    index.update(snapshot.get(), *next_snapshot, TopmapSnapshot::diff(snapshot.get(), *next_snapshot));
+    SCOPED_TRACE(step);
+    expectIndexes(index, *next_snapshot);
+    if (HasFailure()) {
+      return;
+    }
+
+    map = next;
+    snapshot = next_snapshot;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "map_diff.h"
+
+using namespace topological_rviz_tools;
+
+namespace
+{
+typedef strands_navigation_msgs::TopologicalMap Map;
+
+Map::Ptr makeMap(int num_nodes)
+{
+  Map::Ptr map(new Map);
+  for (int i = 0; i < num_nodes; i++) {
+    strands_navigation_msgs::TopologicalNode node;
+    char name[32];
+    sprintf(name, "WayPoint%d", i);
+    node.name = name;
+    node.pointset = "before";
+    node.pose.position.x = rand() % 200;
+    node.pose.position.y = rand() % 200;
+    map->nodes.push_back(node);
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    for (int j = 0; j < 3; j++) {
+      strands_navigation_msgs::Edge edge;
+      edge.node = map->nodes[rand() % num_nodes].name;
+      edge.edge_id = map->nodes[i].name + "_" + edge.node;
+      map->nodes[i].edges.push_back(edge);
+    }
+  }
+  return map;
+}
+
+MapDiff::Source makeSource(const Map::Ptr& map, unsigned int revision)
+{
+  MapDiff::Source source;
+  source.snapshot.reset(new TopmapSnapshot(map, revision));
+  source.has_tags = true;
+  return source;
+}
+
+void expectSame(const MapDiff& incremental, const MapDiff& full)
+{
+  std::vector<MapDiff::NodeChange> inc = incremental.getChanges();
+  std::vector<MapDiff::NodeChange> all = full.getChanges();
+  ASSERT_EQ(all.size(), inc.size());
+  for (int i = 0; i < all.size(); i++) {
+    EXPECT_EQ(all[i].name, inc[i].name);
+    EXPECT_EQ(all[i].kind, inc[i].kind);
+    EXPECT_EQ(all[i].fields, inc[i].fields);
+    EXPECT_EQ(all[i].edges.size(), inc[i].edges.size());
+    EXPECT_EQ(all[i].added_tags, inc[i].added_tags);
+    EXPECT_EQ(all[i].removed_tags, inc[i].removed_tags);
+  }
+}
+}
+
+TEST(MapDiff, FindsChangesInSmallMap)
+{
+  srand(1);
+  Map::Ptr before = makeMap(10);
+  Map::Ptr after(new Map(*before));
+  after->nodes[1].pose.position.x += 1;
+  after->nodes[2].edges[0].action = "door_passing";
+  after->nodes.erase(after->nodes.begin() + 3);
+  after->nodes.push_back(after->nodes[0]);
+  after->nodes.back().name = "Extra";
+
+  MapDiff::Source from = makeSource(before, 1);
+  MapDiff::Source to = makeSource(after, 2);
+  from.tags["WayPoint4"].push_back("no_go");
+  MapDiff diff;
+  diff.compare(from, to);
+
+  MapDiff::Summary summary = diff.getSummary();
+  EXPECT_EQ(1, summary.nodes[MapDiff::ADDED]);
+  EXPECT_EQ(1, summary.nodes[MapDiff::REMOVED]);
+  EXPECT_EQ(3, summary.nodes[MapDiff::MODIFIED]);
+  EXPECT_EQ(1, summary.removed_tags);
+  ASSERT_TRUE(diff.findChange("WayPoint1"));
+  EXPECT_EQ(TopmapDelta::POSE, diff.findChange("WayPoint1")->fields);
+  EXPECT_EQ(MapDiff::EDGE_ACTION, diff.findChange("WayPoint2")->edges[0].fields);
+  EXPECT_EQ(MapDiff::REMOVED, diff.findChange("WayPoint3")->kind);
+  EXPECT_EQ(MapDiff::TAGS, diff.findChange("WayPoint4")->fields);
+  EXPECT_EQ(MapDiff::ADDED, diff.findChange("Extra")->kind);
+  EXPECT_FALSE(diff.findChange("WayPoint5"));
+}
+
+// Comparing two pointsets of 50,000 nodes from scratch, then following random
+// edits of the second one, which must leave the same changes as comparing the
+// result from scratch. The time of the full comparison is recorded.
+TEST(MapDiff, LargeMapIncrementalMatchesFullCompare)
+{
+  srand(1);
+  const int num_nodes = 50000;
+  Map::Ptr before = makeMap(num_nodes);
+  Map::Ptr after(new Map(*before));
+  for (int i = 0; i < num_nodes; i++) {
+    after->nodes[i].pointset = "after";
+  }
+  for (int i = 0; i < 500; i++) {
+    after->nodes[rand() % num_nodes].pose.position.x += 1;
+    after->nodes[rand() % num_nodes].edges[0].action = "door_passing";
+  }
+  after->nodes.erase(after->nodes.begin() + 100, after->nodes.begin() + 300);
+
+  unsigned int revision = 1;
+  MapDiff::Source from = makeSource(before, revision++);
+  MapDiff::Source to = makeSource(after, revision++);
+  MapDiff diff;
+  std::clock_t start = std::clock();
+  diff.compare(from, to);
+  double milliseconds = 1000.0 * (std::clock() - start) / CLOCKS_PER_SEC;
+  printf("Full comparison of %d nodes took %.1f ms\n", num_nodes, milliseconds);
+  RecordProperty("full_compare_ms", static_cast<int>(milliseconds + 0.5));
+  EXPECT_EQ(200, diff.getSummary().nodes[MapDiff::REMOVED]);
+
+  for (int step = 0; step < 10; step++) {
+    Map::Ptr edited(new Map(*after));
+    int ind = rand() % edited->nodes.size();
+    switch (rand() % 3) {
+    case 0:
+      edited->nodes[ind].pose.position.x += 3;
+      break;
+    case 1:
+      edited->nodes.erase(edited->nodes.begin() + ind);
+      break;
+    default:
+      edited->nodes[ind].name += "_renamed";
+      break;
+    }
+    TopmapSnapshot::ConstPtr snapshot(new TopmapSnapshot(edited, revision++));
+    diff.update(snapshot, TopmapSnapshot::diff(to.snapshot.get(), *snapshot), MapDiff::TagChanges());
+    to.snapshot = snapshot;
+    after = edited;
+
+    MapDiff full;
+    full.compare(from, to);
+    expectSame(diff, full);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "map_statistics.h"
+
+using namespace topological_rviz_tools;
+
+namespace
+{
+typedef strands_navigation_msgs::TopologicalMap Map;
+
+strands_navigation_msgs::TopologicalNode makeNode(const std::string& name, double x, double y)
+{
+  strands_navigation_msgs::TopologicalNode node;
+  node.name = name;
+  node.pose.position.x = x;
+  node.pose.position.y = y;
+  return node;
+}
+
+void addEdge(strands_navigation_msgs::TopologicalNode* node, const std::string& to)
+{
+  strands_navigation_msgs::Edge edge;
+  edge.edge_id = node->name + "_" + to;
+  edge.node = to;
+  node->edges.push_back(edge);
+}
+
+void expectSame(const MapStatistics& incremental, const MapStatistics& full)
+{
+  EXPECT_EQ(full.numNodes(), incremental.numNodes());
+  EXPECT_EQ(full.numEdges(), incremental.numEdges());
+  EXPECT_EQ(full.numUnidirectional(), incremental.numUnidirectional());
+  EXPECT_EQ(full.numDangling(), incremental.numDangling());
+  EXPECT_EQ(full.getDegrees(), incremental.getDegrees());
+  EXPECT_EQ(full.getLengths(), incremental.getLengths());
+  EXPECT_NEAR(full.meanLength(), incremental.meanLength(), 1e-6);
+}
+}
+
+TEST(MapStatistics, CountsSmallMap)
+{
+  Map::Ptr map(new Map);
+  map->nodes.push_back(makeNode("a", 0, 0));
+  map->nodes.push_back(makeNode("b", 3, 4));
+  map->nodes.push_back(makeNode("c", 3, 0));
+  addEdge(&map->nodes[0], "b");
+  addEdge(&map->nodes[1], "a");
+  addEdge(&map->nodes[0], "c");
+  addEdge(&map->nodes[2], "missing");
+
+  TopmapSnapshot::ConstPtr snapshot(new TopmapSnapshot(map, 1));
+  MapStatistics stats;
+  stats.update(snapshot, TopmapSnapshot::diff(NULL, *snapshot));
+
+  EXPECT_EQ(3, stats.numNodes());
+  EXPECT_EQ(4, stats.numEdges());
+  // a -> c and c -> missing have no edge back
+  EXPECT_EQ(2, stats.numUnidirectional());
+  EXPECT_EQ(1, stats.numDangling());
+  // a -> b and b -> a are 5 m, a -> c is 3 m
+  EXPECT_NEAR(13.0 / 3, stats.meanLength(), 1e-9);
+  EXPECT_EQ(1, stats.getDegrees().find(2)->second);
+  EXPECT_EQ(2, stats.getDegrees().find(1)->second);
+}
+
+// Random edits applied as deltas must leave the same numbers as counting the
+// resulting map from scratch.
+TEST(MapStatistics, IncrementalMatchesFullCount)
+{
+  srand(1);
+  const int num_nodes = 500;
+  Map::Ptr map(new Map);
+  for (int i = 0; i < num_nodes; i++) {
+    char name[32];
+    sprintf(name, "WayPoint%d", i);
+    map->nodes.push_back(makeNode(name, rand() % 100, rand() % 100));
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    for (int j = 0; j < 3; j++) {
+      addEdge(&map->nodes[i], map->nodes[rand() % num_nodes].name);
+    }
+  }
+
+  unsigned int revision = 1;
+  TopmapSnapshot::ConstPtr snapshot(new TopmapSnapshot(map, revision++));
+  MapStatistics incremental;
+  incremental.update(snapshot, TopmapSnapshot::diff(NULL, *snapshot));
+
+  for (int step = 0; step < 300; step++) {
+    Map::Ptr next(new Map(*map));
+    int node = rand() % next->nodes.size();
+    switch (rand() % 4) {
+    case 0:
+      next->nodes[node].pose.position.x += 3;
+      break;
+    case 1:
+      next->nodes.erase(next->nodes.begin() + node);
+      break;
+    case 2:
+      // renaming leaves the edges to the old name dangling
+      next->nodes[node].name += "r";
+      break;
+    default:
+      addEdge(&next->nodes[node], next->nodes[rand() % next->nodes.size()].name);
+      if (rand() % 2) {
+	next->nodes[node].edges.erase(next->nodes[node].edges.begin());
+      }
+    }
+
+    TopmapSnapshot::ConstPtr next_snapshot(new TopmapSnapshot(next, revision++));
+    incremental.update(next_snapshot, TopmapSnapshot::diff(snapshot.get(), *next_snapshot));
+    MapStatistics full;
+    full.update(next_snapshot, TopmapSnapshot::diff(NULL, *next_snapshot));
+    SCOPED_TRACE(step);
+    expectSame(incremental, full);
+    if (HasFailure()) {
+      return;
+    }
+
+    map = next;
+    snapshot = next_snapshot;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include "topmap_item_model.h"
+
+using namespace topological_rviz_tools;
+
+namespace
+{
+typedef strands_navigation_msgs::TopologicalMap Map;
+
+void addNode(Map* map, const std::string& name, double x)
+{
+  strands_navigation_msgs::TopologicalNode node;
+  node.name = name;
+  node.pose.position.x = x;
+  map->nodes.push_back(node);
+}
+
+std::vector<int> allNodes(const TopmapSnapshot& snapshot)
+{
+  std::vector<int> nodes(snapshot.numNodes());
+  for (int i = 0; i < nodes.size(); i++) {
+    nodes[i] = i;
+  }
+  return nodes;
+}
+
+/** @brief Check that the rows of @a model are the nodes at @a nodes, in
+ * order, and that each can be found again from its display index. */
+void expectRows(const TopmapItemModel& model, const std::vector<int>& nodes)
+{
+  ASSERT_EQ((int)nodes.size(), model.rowCount());
+  for (int row = 0; row < nodes.size(); row++) {
+    QModelIndex index = model.index(row, 0);
+    EXPECT_EQ(nodes[row], model.nodeOf(index));
+    EXPECT_EQ(row, model.nodeIndex(nodes[row]).row());
+  }
+}
+}
+
+TEST(TopmapItemModel, FollowsDeltas)
+{
+  Map::Ptr map(new Map);
+  addNode(map.get(), "c", 0);
+  addNode(map.get(), "a", 1);
+  addNode(map.get(), "b", 2);
+  TopmapSnapshot::ConstPtr before(new TopmapSnapshot(map, 1));
+  TopmapItemModel model;
+  model.setSnapshot(before, TopmapSnapshot::diff(NULL, *before));
+  expectRows(model, allNodes(*before));
+
+  Map::Ptr edited(new Map(*map));
+  edited->nodes.erase(edited->nodes.begin() + 1);
+  addNode(edited.get(), "d", 3);
+  TopmapSnapshot::ConstPtr after(new TopmapSnapshot(edited, 2));
+  std::vector<int> shown = allNodes(*after);
+  model.setSnapshot(after, TopmapSnapshot::diff(before.get(), *after), &shown);
+  expectRows(model, shown);
+}
+
+// The map manager does not stop two nodes from having the same name. Each
+// copy must keep a row of its own when the map changes around them.
+TEST(TopmapItemModel, KeepsDuplicateNamesApart)
+{
+  Map::Ptr map(new Map);
+  addNode(map.get(), "a", 0);
+  addNode(map.get(), "b", 1);
+  addNode(map.get(), "b", 2);
+  addNode(map.get(), "b", 3);
+  addNode(map.get(), "c", 4);
+  TopmapSnapshot::ConstPtr first(new TopmapSnapshot(map, 1));
+  TopmapItemModel model;
+  std::vector<int> shown = allNodes(*first);
+  model.setSnapshot(first, TopmapSnapshot::diff(NULL, *first), &shown);
+  expectRows(model, shown);
+
+  // one copy of b goes, and the rows of the other two must stay apart
+  Map::Ptr fewer(new Map(*map));
+  fewer->nodes.erase(fewer->nodes.begin() + 2);
+  TopmapSnapshot::ConstPtr second(new TopmapSnapshot(fewer, 2));
+  shown = allNodes(*second);
+  model.setSnapshot(second, TopmapSnapshot::diff(first.get(), *second), &shown);
+  expectRows(model, shown);
+
+  // only the copies of b, and then another one of them
+  std::vector<int> copies;
+  copies.push_back(1);
+  copies.push_back(2);
+  model.setFilter(&copies);
+  expectRows(model, copies);
+
+  Map::Ptr more(new Map(*fewer));
+  addNode(more.get(), "b", 5);
+  TopmapSnapshot::ConstPtr third(new TopmapSnapshot(more, 3));
+  copies.push_back(3);
+  model.setSnapshot(third, TopmapSnapshot::diff(second.get(), *third), &copies);
+  expectRows(model, copies);
+  EXPECT_EQ(3, third->findMatch(*first, 3));
+  EXPECT_EQ(-1, second->findMatch(*first, 3));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}